@@ -31,11 +31,15 @@ int NANDfs_core_create(FileHandle_t *handle);
 int NANDfs_core_open(int fileid, FileHandle_t *file);
 int NANDfs_core_write(FileHandle_t *file, int size, void *buf);
 int NANDfs_core_read(FileHandle_t *file, int size, void *buf);
+int NANDfs_core_seek(FileHandle_t *file, uint32_t offset);
 int NANDfs_core_close_rdonly(FileHandle_t *file);
 int NANDfs_core_close_wronly(FileHandle_t *file);
 int NANDfs_core_delete(uint32_t inodeid);
 int NANDfs_core_erase(inode_t *inode);
 int NANDfs_Core_opendir(DirHandle_t *dir);
 int NANDfs_Core_nextdir(DirHandle_t *dir);
+uint32_t NANDfs_core_mount_time();
+int NANDfs_core_erase_ahead(int reclaim);
+void NANDfs_core_erase_stats(NANDfs_erase_stats_t *stats);
 
 #endif /* NAND_CORE_H_ */
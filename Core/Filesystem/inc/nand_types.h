@@ -13,6 +13,14 @@
 
 #define MAGIC 0x50BAB10C
 
+/*
+ * Layout of the file system on flash, recorded in every inode and checkpoint.
+ * Version 2 added the page metadata in the spare area, files spanning
+ * continuation blocks and the checkpoint block. Inodes written before it
+ * read back 0xff and are erased when the file system is mounted.
+ */
+#define NANDFS_VERSION 2
+
 #include "nand_m79a_lld.h"
 
 typedef struct {
@@ -22,14 +30,50 @@ typedef struct {
     uint16_t start_block;
     uint8_t isfirst;
     uint8_t *file_name;
+    uint32_t parent; // id of the file this one was derived from, like a thumbnail, 0 for none
+    uint32_t raw_size; // bytes before coding, file_size is the bytes stored
+    uint8_t codec;     // NAND_CODEC_*
+    uint32_t burst;    // id of the burst the file was captured in, 0 for none
+    uint8_t version;   // NANDFS_VERSION the file was written with
 } inode_t;
 
+/*
+ * How a file's data is coded. Files written before the codec was recorded
+ * read back 0xff and are treated as NAND_CODEC_NONE.
+ */
+#define NAND_CODEC_NONE 0
+#define NAND_CODEC_RLE 1          // rle_stream
+#define NAND_CODEC_LOCO_BAYER8 2  // loco, ISP RAW
+#define NAND_CODEC_LOCO_YUV422 3  // loco, YUYV
+#define NAND_CODEC_MAX NAND_CODEC_LOCO_YUV422
+
 typedef inode_t DIRENT;
 
+/*
+ * Stored in the spare area of every page the file system programs. The first
+ * block of a file keeps the inode in page 0, data pages carry no header.
+ */
+#define SPARE_META_OFFSET 4 // Leave the bad block marker alone
+#define META_INODE 0x01     // Page holds the file's inode
+
+typedef struct {
+    uint32_t id;   // inode id of the file that owns the page
+    uint16_t seq;  // block number within the file, 0 for the first block
+    uint8_t page;  // page number within the block
+    uint8_t flags; // META_*
+    uint32_t crc;  // CRC of the fields above
+} page_meta_t;
+
 typedef struct {
     uint8_t open; // 0 is not open
     uint8_t readonly;
     PhysicalAddrs seek;
+    uint32_t offset;   // file offset of the page at seek
+    uint16_t seq;      // block number within the file at seek
+    uint8_t *wbuf;      // page buffer of a file open for writing
+    uint8_t *wbuf_next; // second page buffer, NULL to program a page at a time
+    uint16_t buffered;  // bytes waiting in wbuf
+    uint8_t aborted;    // a write failed and the file was dropped, close only releases the handle
     inode_t node;
 } FileHandle_t;
 
@@ -44,4 +88,10 @@ typedef struct {
 
 typedef DirHandle_t NAND_DIR;
 
+typedef struct {
+    uint32_t hits;     // block taken from the erase-ahead pool
+    uint32_t misses;   // block had to be erased synchronously
+    uint32_t stall_ms; // time spent in synchronous erases
+} NANDfs_erase_stats_t;
+
 #endif /* NAND_TYPES_H_ */
@@ -18,7 +18,8 @@
  *      Author: Robert Taylor
  */
 
-// The first page of a block stores the inode of the file contained in that block (63 pages)
+// The first page of a file's first block stores its inode (63 data pages), the following blocks are all data
+// The spare area of every page records the file id, block sequence and page number (page_meta_t)
 // The inodes are not rewriteable. Once a file handle is closed, the file is no longer changeable
 // Files are stored in purely sequential blocks
 // When attempting to write a file that extends past a block, if the next block contains a file, it will be erased
@@ -64,10 +65,31 @@ int NANDfs_closedir(NAND_DIR *dir);
 
 int NANDfs_read(NAND_FILE *fd, int size, void *buf);
 
+// Moves a file open for reading to a byte offset, the next read starts there
+int NANDfs_seek(NAND_FILE *fd, uint32_t offset);
+
+// A failed write drops the file, later writes fail and close only releases the handle
 int NANDfs_write(NAND_FILE *fd, int size, void *buf);
 
+// Codes everything written to a new file with codec, line is the image's line length in bytes for the LOCO codecs
+int NANDfs_set_codec(NAND_FILE *fd, uint8_t codec, uint16_t line);
+
+// Makes reads of a file open for reading return its data decoded, node.raw_size bytes of it. EBUSY while another
+// file is coded or a file is being written uncoded
+int NANDfs_decode(NAND_FILE *fd);
+
 int NANDfs_format(void);
 
+// Time taken by NANDfs_init to mount the file system, in ms
+uint32_t NANDfs_mount_time(void);
+
+// Erases one block ahead of the next write, and writes the checkpoint if a
+// block went bad since the last one. Call when idle. Once the flash has
+// wrapped this erases the oldest file when it is next and no file is open,
+// so old files go up to 8 blocks before the captures would overwrite them.
+int NANDfs_erase_ahead(void);
+void NANDfs_erase_stats(NANDfs_erase_stats_t *stats);
+
 #ifdef __cplusplus
 }
 #endif
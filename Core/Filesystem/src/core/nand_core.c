@@ -18,6 +18,7 @@
  *      Author: Robert Taylor
  */
 #include <stdint.h>
+#include <stddef.h>
 #include <string.h>
 #include "nandfs.h"
 #include "nand_core.h"
@@ -26,124 +27,567 @@
 #include "nand_errno.h"
 #include "debug.h"
 
+extern CRC_HandleTypeDef hcrc;
+
 static inode_t lowest_inode;
 static inode_t highest_inode;
+static uint32_t mount_time_ms;
 
 static void _increment_seek(PhysicalAddrs *addr, int size);
 static void _increment_block(PhysicalAddrs *addr);
 static void find_good_block(PhysicalAddrs *addr);
+uint16_t _next_free_block(inode_t *inode);
+int _find_lowest_inode(inode_t *inode);
+NAND_ReturnType _NANDfs_core_erase_block(int block);
+static int _pool_take(uint16_t block);
+static void _pool_add(uint16_t block);
+static int _reclaim_file(inode_t *node);
+static void _inode_fixup(inode_t *node);
+static int _format(int first);
 
-#define RESERVED_BLOCK_CNT 2
+/* Blocks 0 and 1 hold the log, block 2 holds the mount checkpoints */
+#define RESERVED_BLOCK_CNT 3
+#define CHECKPOINT_BLOCK 2
+#define CHECKPOINT_MAGIC 0xC4EC4B07
 
-uint16_t _next_free_block(inode_t *inode) {
-    if (inode->magic != MAGIC) {
-        // freshly formatted file system, i.e. no files yet
-        return RESERVED_BLOCK_CNT;
-    }
+/*
+ * Snapshot of the mount state, appended to the next two free pages of
+ * CHECKPOINT_BLOCK whenever the file layout changes: this header, then the
+ * file map. The last programmed header is the current checkpoint.
+ */
+typedef struct {
+    uint32_t magic;
+    uint32_t version; // NANDFS_VERSION
+    inode_t lowest;
+    inode_t highest;
+    uint16_t next_free_block;
+    uint16_t bad_blocks;
+    uint8_t bad_block_table[BAD_BLOCK_TABLE_SIZE];
+    uint32_t map_crc; // CRC of the file map in the next page
+    uint32_t crc;
+} checkpoint_t;
 
-    uint16_t seek_block = inode->start_block;
-    int remaining_data = inode->file_size;
-    // There is always one inode page per block
-    int bytes_per_block = BLOCK_SIZE - PAGE_DATA_SIZE;
-    int file_blocks = 0;
-    while (remaining_data >= bytes_per_block) {
-        remaining_data -= bytes_per_block;
-        ++file_blocks; // completely filled blocks
+static uint8_t checkpoint_page;  // next free header page in CHECKPOINT_BLOCK
+static uint8_t checkpoint_dirty; // a block was marked bad since the last checkpoint
+
+/* The first block of a file spends page 0 on the inode, the rest are all data */
+#define FIRST_BLOCK_DATA_SIZE (BLOCK_SIZE - PAGE_DATA_SIZE)
+
+/*
+ * Erase-ahead pool. Files are written to consecutive good blocks, so the pool
+ * holds erased blocks among the ERASE_POOL_SIZE good blocks the next writes
+ * will use. It is filled from idle time by NANDfs_core_erase_ahead and by the
+ * erase of an old file in the way, and create/write fall back to erasing
+ * synchronously when the block they need is not in the pool.
+ */
+#define ERASE_POOL_SIZE 8
+
+static uint16_t pool[ERASE_POOL_SIZE];
+static uint8_t pool_count;
+static uint8_t writing; // a file is open for writing, the frontier is moving
+static NANDfs_erase_stats_t erase_stats;
+
+/*
+ * Files are written one at a time, so the open one gets this page buffer.
+ * The caller can lend a second one in the handle's wbuf_next, then one is
+ * filled while the page in the other is being programmed.
+ */
+static uint8_t write_buffer[PAGE_DATA_SIZE];
+static uint8_t program_pending; // the last page programmed may still be busy
+
+/*
+ * Map of the files on flash. Files are written back to back in the circular
+ * buffer with ids counting up, so the n-th live file after the oldest starts
+ * at the n-th marked block after the oldest's start block. Every file takes
+ * at least one block, so the ids from the oldest file to the newest span
+ * fewer than NUM_BLOCKS and a file's id is marked at id % NUM_BLOCKS. The
+ * map is saved with every checkpoint, so it covers every file from mount on.
+ */
+#define MAP_WORDS (NUM_BLOCKS / 32)
+#define ID_BIT(id) ((id) % NUM_BLOCKS)
+
+typedef struct {
+    uint32_t starts[MAP_WORDS]; // blocks holding the inode of a live file
+    uint32_t ids[MAP_WORDS];    // ids of the live files
+} file_map_t;
+
+static file_map_t file_map;
+
+/*
+ * Sizes and codec of the files closed or opened last, which is all opening a
+ * file needs besides its start block. Other files read their inode page.
+ */
+#define INODE_CACHE_SIZE 16
+
+typedef struct {
+    uint32_t id; // 0 for an empty slot
+    uint32_t file_size;
+    uint32_t raw_size : 28; // the flash holds 256 MB
+    uint32_t codec : 3;
+} inode_cache_t;
+
+static inode_cache_t inode_cache[INODE_CACHE_SIZE];
+
+static int _map_test(const uint32_t *map, uint32_t bit) { return (map[bit / 32] >> (bit % 32)) & 1; }
+
+static void _map_add(inode_t *node) {
+    file_map.starts[node->start_block / 32] |= 1u << (node->start_block % 32);
+    file_map.ids[ID_BIT(node->id) / 32] |= 1u << (ID_BIT(node->id) % 32);
+}
+
+static void _map_remove(inode_t *node) {
+    file_map.starts[node->start_block / 32] &= ~(1u << (node->start_block % 32));
+    file_map.ids[ID_BIT(node->id) / 32] &= ~(1u << (ID_BIT(node->id) % 32));
+}
+
+/*
+ * Counts the bits set in map from bit from on for n bits, wrapping at
+ * NUM_BLOCKS
+ */
+static uint32_t _map_count(const uint32_t *map, uint32_t from, uint32_t n) {
+    uint32_t count = 0;
+
+    while (n > 0) {
+        uint32_t bits = 32 - from % 32;
+        uint32_t word = map[from / 32] >> (from % 32);
+        if (bits > n) {
+            bits = n;
+            word &= (1u << bits) - 1;
+        }
+        count += __builtin_popcount(word);
+        n -= bits;
+        from = (from + bits) % NUM_BLOCKS;
     }
-    if (remaining_data > 0) { // partially filled blocks
-        ++file_blocks;
+    return count;
+}
+
+/*
+ * @Return: the bit n set bits past from in map, wrapping at NUM_BLOCKS, so
+ * n = 0 is the first set bit at or after from. -1 if there are not that many.
+ */
+static int _map_nth(const uint32_t *map, uint32_t from, uint32_t n) {
+    for (uint32_t left = NUM_BLOCKS; left > 0;) {
+        uint32_t bits = 32 - from % 32;
+        uint32_t word = map[from / 32] >> (from % 32);
+        if (bits > left) {
+            bits = left;
+            word &= (1u << bits) - 1;
+        }
+        uint32_t count = __builtin_popcount(word);
+        if (n < count) {
+            while (!(word & 1) || n-- > 0) {
+                word >>= 1;
+                from++;
+            }
+            return from;
+        }
+        n -= count;
+        left -= bits;
+        from = (from + bits) % NUM_BLOCKS;
     }
+    return -1;
+}
 
-    seek_block += file_blocks;
-    if (seek_block >= NUM_BLOCKS) {
-        seek_block = (seek_block - NUM_BLOCKS) + RESERVED_BLOCK_CNT;
+/*
+ * @Return: start block of file id, -1 if it is not on flash
+ */
+static int _map_start(uint32_t id) {
+    if (lowest_inode.magic != MAGIC || id < lowest_inode.id || id > highest_inode.id ||
+        !_map_test(file_map.ids, ID_BIT(id))) {
+        return -1;
     }
-    return seek_block;
+    uint32_t before = _map_count(file_map.ids, ID_BIT(lowest_inode.id), id - lowest_inode.id);
+    return _map_nth(file_map.starts, lowest_inode.start_block, before);
 }
 
 /*
- * Finds the PhysicalAddr of the first block of an inode by its ID
+ * @Return: id of the first file on flash after id, 0 if there is none
  */
-static int _find_inode(int inodeid, inode_t *inode, PhysicalAddrs *paddr) {
-    PhysicalAddrs search = {0};
-    inode_t snode = {0};
+static uint32_t _map_next_id(uint32_t id) {
+    if (id >= highest_inode.id) {
+        return 0;
+    }
+    int bit = _map_nth(file_map.ids, ID_BIT(id + 1), 0);
+    if (bit < 0) {
+        return 0;
+    }
+    uint32_t next = id + 1 + (bit + NUM_BLOCKS - ID_BIT(id + 1)) % NUM_BLOCKS;
+    return (next <= highest_inode.id) ? next : 0;
+}
 
-    for (int i = RESERVED_BLOCK_CNT; i < NUM_BLOCKS; i++) {
-        search.block = i;
-        if (NAND_is_Bad_Block(search.block)) {
-            continue;
-        }
-        if (NAND_Page_Read(&search, sizeof(snode), (uint8_t *)&snode) != Ret_Success) {
-            continue; // Might have hit a bad block, not really sure
+/*
+ * @Return: id of the last file on flash before id, 0 if there is none
+ */
+static uint32_t _map_prev_id(uint32_t id) {
+    while (lowest_inode.magic == MAGIC && id > lowest_inode.id) {
+        id--;
+        if (_map_test(file_map.ids, ID_BIT(id))) {
+            return id;
         }
+    }
+    return 0;
+}
 
-        if (snode.id == inodeid && snode.isfirst) {
-            *inode = snode;
-            *paddr = search;
-            return 0;
-        }
+static void _cache_put(inode_t *node) {
+    inode_t fixed = *node;
+    inode_cache_t *slot = &inode_cache[node->id % INODE_CACHE_SIZE];
+
+    _inode_fixup(&fixed);
+    slot->id = fixed.id;
+    slot->file_size = fixed.file_size;
+    slot->raw_size = fixed.raw_size;
+    slot->codec = fixed.codec;
+}
+
+static void _cache_drop(uint32_t id) {
+    if (inode_cache[id % INODE_CACHE_SIZE].id == id) {
+        inode_cache[id % INODE_CACHE_SIZE].id = 0;
     }
-    return -1;
 }
 
-int _find_lowest_inode(inode_t *inode) {
-    uint32_t lowest = UINT32_MAX;
+/*
+ * Fills node with the whole inode of file id, which is on flash. The oldest
+ * and newest files are kept in RAM, others cost a read of the inode page.
+ * @Return: 0 on success, -1 if it could not be read
+ */
+static int _load_inode(uint32_t id, inode_t *node) {
+    if (id == highest_inode.id) {
+        *node = highest_inode;
+        return 0;
+    }
+    if (id == lowest_inode.id) {
+        *node = lowest_inode;
+        return 0;
+    }
+    PhysicalAddrs addr = {.block = _map_start(id)};
+    if (NAND_Page_Read(&addr, sizeof(inode_t), (uint8_t *)node) != Ret_Success || node->magic != MAGIC ||
+        node->id != id) {
+#if NAND_DEBUG
+        iris_log("no inode for file %d at block %d\r\n", id, addr.block);
+#endif
+        nand_errno = NAND_EIO;
+        return -1;
+    }
+    return 0;
+}
+
+/*
+ * Single pass over every block that finds the lowest and highest inodes and
+ * marks every file in the map
+ * @Return: the number of files written with another NANDFS_VERSION, left out
+ */
+static int _scan_inodes() {
     PhysicalAddrs search = {0};
     inode_t node = {0};
-    NAND_ReturnType status = Ret_Failed;
-    int found_valid_file = 0; // Sanity check, if no files found, we will return 0;
+    int stale = 0;
+
+    memset(&lowest_inode, 0, sizeof(lowest_inode));
+    memset(&highest_inode, 0, sizeof(highest_inode));
+    memset(&file_map, 0, sizeof(file_map));
+    memset(inode_cache, 0, sizeof(inode_cache));
     for (uint16_t i = RESERVED_BLOCK_CNT; i < NUM_BLOCKS; i++) {
         search.block = i;
-        status = NAND_Page_Read(&search, sizeof(node), (uint8_t *)&node);
-        if (status != Ret_Success) {
-            continue; // Might have hit a bad block, not really sure
+        if (NAND_is_Bad_Block(i)) {
+            continue;
         }
-        if (node.magic != MAGIC) {
+        if (NAND_Page_Read(&search, sizeof(node), (uint8_t *)&node) != Ret_Success) {
             continue;
         }
-        found_valid_file = 1;
-        if (node.id < lowest) {
-            lowest = node.id;
-            *inode = node;
+        if (node.magic != MAGIC || !node.isfirst) {
+            continue;
+        }
+        if (node.version != NANDFS_VERSION) {
+            stale++;
+            continue;
+        }
+        _map_add(&node);
+        if (inode_cache[node.id % INODE_CACHE_SIZE].id < node.id) {
+            _cache_put(&node);
+        }
+        if (lowest_inode.magic != MAGIC || node.id < lowest_inode.id) {
+            lowest_inode = node;
+        }
+        if (node.id > highest_inode.id) {
+            highest_inode = node;
         }
     }
-    if (found_valid_file) {
 #if NAND_DEBUG
-        iris_log("lowest inode id %d, start %d\r\n", inode->id, inode->start_block);
+    iris_log("scan: lowest %d, highest %d\r\n", lowest_inode.id, highest_inode.id);
 #endif
-        return lowest;
+    return stale;
+}
+
+/*
+ * Sets lowest_inode to the oldest remaining file after the old one was erased
+ */
+static void _refresh_lowest_inode() {
+    uint32_t id = _map_next_id(lowest_inode.id);
+    if (id == 0 || _load_inode(id, &lowest_inode)) {
+        memset(&lowest_inode, 0, sizeof(lowest_inode));
+    }
+}
+
+static uint32_t _checkpoint_crc(checkpoint_t *cp) {
+    return HAL_CRC_Calculate(&hcrc, (uint32_t *)cp, offsetof(checkpoint_t, crc));
+}
+
+/*
+ * Appends the current mount state to CHECKPOINT_BLOCK, erasing it when full.
+ * The header goes first, so a checkpoint cut short has no file map and is
+ * not used.
+ */
+static int _checkpoint_write() {
+    PhysicalAddrs addr = {.block = CHECKPOINT_BLOCK};
+    checkpoint_t cp = {0};
+
+    if (checkpoint_page >= NUM_PAGES_PER_BLOCK) {
+        if (NAND_Block_Erase(&addr) != Ret_Success) {
+            nand_errno = NAND_EIO;
+            return -1;
+        }
+        checkpoint_page = 0;
+    }
+    cp.magic = CHECKPOINT_MAGIC;
+    cp.version = NANDFS_VERSION;
+    cp.lowest = lowest_inode;
+    cp.highest = highest_inode;
+    cp.next_free_block = _next_free_block(&highest_inode);
+    cp.bad_blocks = NAND_Bad_Block_Count();
+    memcpy(cp.bad_block_table, NAND_Get_Bad_Block_Table(), sizeof(cp.bad_block_table));
+    cp.map_crc = HAL_CRC_Calculate(&hcrc, (uint32_t *)&file_map, sizeof(file_map));
+    cp.crc = _checkpoint_crc(&cp);
+
+    addr.page = checkpoint_page;
+    checkpoint_page += 2;
+    if (NAND_Page_Program(&addr, sizeof(cp), (uint8_t *)&cp) != Ret_Success) {
+        nand_errno = NAND_EIO;
+        return -1;
+    }
+    addr.page++;
+    if (NAND_Page_Program(&addr, sizeof(file_map), (uint8_t *)&file_map) != Ret_Success) {
+        nand_errno = NAND_EIO;
+        return -1;
+    }
+    checkpoint_dirty = 0;
+    return 0;
+}
+
+/*
+ * The checkpoint keeps a copy of the bad block table, so a new bad block
+ * makes it stale until the next checkpoint is written
+ */
+static void _mark_bad_block(uint16_t block) {
+    NAND_Mark_Bad_Block(block);
+    checkpoint_dirty = 1;
+}
+
+/*
+ * Finds the most recent checkpoint and loads its file map. Checkpoints are
+ * programmed in page order, so the first blank header page is found with a
+ * binary search.
+ * @Return: 0 if a checkpoint with good CRCs was found, -1 otherwise
+ */
+static int _checkpoint_load(checkpoint_t *cp) {
+    PhysicalAddrs addr = {.block = CHECKPOINT_BLOCK};
+    int lo = 0;
+    int hi = NUM_PAGES_PER_BLOCK / 2;
+
+    while (lo < hi) {
+        int mid = (lo + hi) / 2;
+        addr.page = mid * 2;
+        if (NAND_Page_Read(&addr, sizeof(*cp), (uint8_t *)cp) != Ret_Success) {
+            checkpoint_page = NUM_PAGES_PER_BLOCK; // Start over on the next write
+            return -1;
+        }
+        if (cp->magic == CHECKPOINT_MAGIC) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    checkpoint_page = lo * 2;
+    if (lo == 0) {
+        // No checkpoints yet. The block may still hold file data from before
+        // it was reserved, so it is erased before the first write.
+        checkpoint_page = NUM_PAGES_PER_BLOCK;
+        return -1;
+    }
+
+    addr.page = (lo - 1) * 2;
+    if (NAND_Page_Read(&addr, sizeof(*cp), (uint8_t *)cp) != Ret_Success) {
+        return -1;
+    }
+    if (cp->magic != CHECKPOINT_MAGIC || cp->crc != _checkpoint_crc(cp) || cp->version != NANDFS_VERSION) {
+        return -1;
+    }
+    addr.page++;
+    if (NAND_Page_Read(&addr, sizeof(file_map), (uint8_t *)&file_map) != Ret_Success) {
+        return -1;
+    }
+    if (cp->map_crc != HAL_CRC_Calculate(&hcrc, (uint32_t *)&file_map, sizeof(file_map))) {
+        return -1;
+    }
+    return 0;
+}
+
+/*
+ * Checks that the flash still looks the way the checkpoint says: the oldest
+ * and newest files are where it expects them and nothing newer follows.
+ */
+static int _checkpoint_validate(checkpoint_t *cp) {
+    PhysicalAddrs addr = {0};
+    inode_t node = {0};
+
+    if (cp->lowest.magic == MAGIC) {
+        if (!_map_test(file_map.starts, cp->lowest.start_block) || !_map_test(file_map.ids, ID_BIT(cp->lowest.id))) {
+            return -1;
+        }
+        addr.block = cp->lowest.start_block;
+        if (NAND_Page_Read(&addr, sizeof(node), (uint8_t *)&node) != Ret_Success || node.magic != MAGIC ||
+            node.id != cp->lowest.id) {
+            return -1;
+        }
+        // The newest file may have been erased, then its block is blank
+        addr.block = cp->highest.start_block;
+        if (_map_test(file_map.ids, ID_BIT(cp->highest.id)) &&
+            (NAND_Page_Read(&addr, sizeof(node), (uint8_t *)&node) != Ret_Success || node.magic != MAGIC ||
+             node.id != cp->highest.id)) {
+            return -1;
+        }
+    }
+    addr.block = cp->next_free_block;
+    if (NAND_Page_Read(&addr, sizeof(node), (uint8_t *)&node) != Ret_Success) {
+        return -1;
+    }
+    if (node.magic == MAGIC && node.id > cp->highest.id) {
+        return -1;
     }
-    memset(inode, 0, sizeof(inode_t));
     return 0;
 }
 
-int _find_highest_inode(inode_t *inode) {
-    uint32_t highest = 0;
+static uint32_t _meta_crc(page_meta_t *meta) {
+    return HAL_CRC_Calculate(&hcrc, (uint32_t *)meta, offsetof(page_meta_t, crc));
+}
+
+static void _meta_fill(page_meta_t *meta, uint32_t id, uint16_t seq, uint8_t page, uint8_t flags) {
+    meta->id = id;
+    meta->seq = seq;
+    meta->page = page;
+    meta->flags = flags;
+    meta->crc = _meta_crc(meta);
+}
+
+/*
+ * @Return: 0 if meta was written by the file system, -1 for blank or corrupt
+ */
+static int _meta_check(page_meta_t *meta) {
+    if (meta->id == UINT32_MAX || meta->crc != _meta_crc(meta)) {
+        return -1;
+    }
+    return 0;
+}
+
+/*
+ * Inodes written before the codec and burst were recorded have erased bytes
+ * there, and an uncoded file's raw size is its size
+ */
+static void _inode_fixup(inode_t *node) {
+    if (node->codec > NAND_CODEC_MAX) {
+        node->codec = NAND_CODEC_NONE;
+    }
+    if (node->burst == UINT32_MAX) {
+        node->burst = 0;
+    }
+    if (node->codec == NAND_CODEC_NONE) {
+        node->raw_size = node->file_size;
+    }
+}
+
+uint16_t _next_free_block(inode_t *inode) {
+    if (inode->magic != MAGIC) {
+        // freshly formatted file system, i.e. no files yet
+        return RESERVED_BLOCK_CNT;
+    }
+
+    uint16_t seek_block = inode->start_block;
+    int remaining_data = inode->file_size;
+    // Only the first block has an inode page
+    int file_blocks = 1;
+    if (remaining_data > FIRST_BLOCK_DATA_SIZE) {
+        remaining_data -= FIRST_BLOCK_DATA_SIZE;
+        file_blocks += (remaining_data + BLOCK_SIZE - 1) / BLOCK_SIZE;
+    }
+
+    // Files skip over bad blocks the same way writes do
+    PhysicalAddrs addr = {.block = seek_block};
+    for (int i = 0; i < file_blocks; i++) {
+        find_good_block(&addr);
+    }
+    return addr.block;
+}
+
+/*
+ * Finds the PhysicalAddr of the first block of an inode by its ID. Files in
+ * the cache are found without a flash access, their node has the sizes and
+ * codec but not the name, parent or burst.
+ */
+static int _find_inode(int inodeid, inode_t *inode, PhysicalAddrs *paddr) {
+    inode_cache_t *slot = &inode_cache[inodeid % INODE_CACHE_SIZE];
+    int block = _map_start(inodeid);
+
+    if (block < 0) {
+        return -1;
+    }
+    memset(paddr, 0, sizeof(PhysicalAddrs));
+    paddr->block = block;
+    if (slot->id == (uint32_t)inodeid && inodeid != (int)highest_inode.id) {
+        memset(inode, 0, sizeof(inode_t));
+        inode->magic = MAGIC;
+        inode->id = inodeid;
+        inode->file_size = slot->file_size;
+        inode->start_block = block;
+        inode->isfirst = 1;
+        inode->raw_size = slot->raw_size;
+        inode->codec = slot->codec;
+        inode->version = NANDFS_VERSION;
+        return 0;
+    }
+    if (_load_inode(inodeid, inode)) {
+        return -1;
+    }
+    _cache_put(inode);
+    return 0;
+}
+
+int _find_lowest_inode(inode_t *inode) {
+    uint32_t lowest = UINT32_MAX;
     PhysicalAddrs search = {0};
     inode_t node = {0};
     NAND_ReturnType status = Ret_Failed;
     int found_valid_file = 0; // Sanity check, if no files found, we will return 0;
     for (uint16_t i = RESERVED_BLOCK_CNT; i < NUM_BLOCKS; i++) {
         search.block = i;
+        if (NAND_is_Bad_Block(i)) {
+            continue;
+        }
         status = NAND_Page_Read(&search, sizeof(node), (uint8_t *)&node);
         if (status != Ret_Success) {
             continue; // Might have hit a bad block, not really sure
         }
-        if (node.magic != MAGIC) {
+        if (node.magic != MAGIC || !node.isfirst) {
             continue;
         }
-
         found_valid_file = 1;
-        if (node.id > highest) {
-            highest = node.id;
+        if (node.id < lowest) {
+            lowest = node.id;
             *inode = node;
         }
     }
     if (found_valid_file) {
 #if NAND_DEBUG
-        iris_log("highest inode id %d, start %d\r\n", inode->id, inode->start_block);
+        iris_log("lowest inode id %d, start %d\r\n", inode->id, inode->start_block);
 #endif
-        return highest;
+        return lowest;
     }
     memset(inode, 0, sizeof(inode_t));
     return 0;
@@ -174,46 +618,101 @@ static int _find_blank(inode_t *next_inode) {
     return search.block;
 }
 
+/*
+ * CHECKPOINT_BLOCK held file data before it was reserved. A file that started
+ * there is dropped, since its inode page is where the checkpoints go. Its
+ * other blocks have no inode and are erased when the write frontier reaches
+ * them.
+ */
+static void _checkpoint_claim() {
+    PhysicalAddrs addr = {.block = CHECKPOINT_BLOCK};
+    inode_t node;
+
+    if (checkpoint_page < NUM_PAGES_PER_BLOCK) {
+        return; // The block already holds checkpoints
+    }
+    if (NAND_Page_Read(&addr, sizeof(node), (uint8_t *)&node) == Ret_Success && node.magic == MAGIC &&
+        node.isfirst) {
+        iris_log("dropping file %d, block %d now holds the checkpoints\r\n", node.id, CHECKPOINT_BLOCK);
+    }
+}
+
 int NANDfs_Core_Init() {
+    checkpoint_t cp;
+    int mounted = 0;
+    uint32_t start = HAL_GetTick();
+
     NAND_Init();
 
-    _find_lowest_inode(&lowest_inode);
-    _find_highest_inode(&highest_inode);
+    if (_checkpoint_load(&cp) == 0) {
+        // The saved table saves reading the marker of every block
+        NAND_Load_Bad_Block_Table(cp.bad_block_table);
+        if (_checkpoint_validate(&cp) == 0) {
+            lowest_inode = cp.lowest;
+            highest_inode = cp.highest;
+            memset(inode_cache, 0, sizeof(inode_cache));
+            mounted = 1;
+        }
+    }
+    if (!mounted) {
+        int stale = _scan_inodes();
+        if (stale) {
+            // Files of the old layout can't be read or erased by this code.
+            // The log blocks are kept, and a format cut short leaves stale
+            // inodes behind, so the next mount picks it up again.
+            iris_log("%d files have an old format, erasing the file system\r\n", stale);
+            _format(CHECKPOINT_BLOCK);
+        } else {
+            _checkpoint_claim();
+            _checkpoint_write();
+        }
+    }
+
+    mount_time_ms = HAL_GetTick() - start;
+    iris_log("mounted from %s in %d ms\r\n", mounted ? "checkpoint" : "scan", mount_time_ms);
     return 0;
 }
 
+uint32_t NANDfs_core_mount_time() { return mount_time_ms; }
+
 int NANDfs_core_create(FileHandle_t *handle) {
     inode_t node;
     int rc;
     PhysicalAddrs addr = {0};
 
-    // First, find a blank space for the file
-    int start_block = _find_blank(&node);
-
-    if (start_block == -1) {
-        // We can't even determine what the start block should be
+    if (writing) {
+        // Only one file can be written at a time
+        nand_errno = NAND_EBUSY;
         return -1;
     }
-    if (start_block == 0) {
-        /* _find_blank found an inode at the next file. That should mean that
-         * we have wrapped around and are encountering old files. Erase the
-         * block and reuse its starting block.
-         */
-        iris_log("erasing file %d at block %d\r\n", node.id, node.start_block);
 
-        addr.block = node.start_block;
-        if ((rc = NANDfs_core_erase(&node))) {
-            return rc;
-        }
-        if (node.id == lowest_inode.id) {
-            // Just deleted the oldest file. Fine the new oldest file.
-            _find_lowest_inode(&lowest_inode);
-        }
-    } else {
-        addr.block = start_block;
-        if (NAND_Block_Erase(&addr) != Ret_Success) {
+    addr.block = _next_free_block(&highest_inode);
+    if (!_pool_take(addr.block)) {
+        uint32_t stall_start = HAL_GetTick();
+
+        // First, find a blank space for the file
+        int start_block = _find_blank(&node);
+
+        if (start_block == -1) {
+            // We can't even determine what the start block should be
             return -1;
         }
+        if (start_block == 0) {
+            /* _find_blank found an inode at the next file. That should mean that
+             * we have wrapped around and are encountering old files. Erase the
+             * block and reuse its starting block.
+             */
+            addr.block = node.start_block;
+            if ((rc = _reclaim_file(&node))) {
+                return rc;
+            }
+        } else {
+            addr.block = start_block;
+            if (NAND_Block_Erase(&addr) != Ret_Success) {
+                return -1;
+            }
+        }
+        erase_stats.stall_ms += HAL_GetTick() - stall_start;
     }
 
     node.magic = MAGIC;
@@ -221,14 +720,27 @@ int NANDfs_core_create(FileHandle_t *handle) {
     node.isfirst = 1;
     node.start_block = addr.block;
     node.file_size = 0; // Set it to 0 now so the writes are accurate
+    node.file_name = NULL;
+    node.parent = 0;
+    node.burst = 0;
+    node.raw_size = 0;
+    node.codec = NAND_CODEC_NONE;
+    node.version = NANDFS_VERSION;
 
     _increment_seek(&addr, PAGE_DATA_SIZE); // Data starts on the next page
 
     handle->seek = addr;
+    handle->offset = 0;
+    handle->seq = 0;
+    handle->wbuf = write_buffer;
+    handle->wbuf_next = NULL;
+    handle->buffered = 0;
     handle->node = node;
     handle->open = 1;
 
+    _map_add(&node);
     highest_inode = node;
+    writing = 1;
     if (lowest_inode.id == 0) {
         // This is the first file created, so it is both lowest and highest inode.
         lowest_inode = node;
@@ -239,6 +751,117 @@ int NANDfs_core_create(FileHandle_t *handle) {
     return 0;
 }
 
+/*
+ * Takes block from the erase-ahead pool if it's there. The rest of the pool
+ * stays, the frontier reaches those blocks later.
+ * @Return: 1 if the block is already erased, 0 if the caller must erase it
+ */
+static int _pool_take(uint16_t block) {
+    for (int i = 0; i < pool_count; i++) {
+        if (pool[i] == block) {
+            pool[i] = pool[--pool_count];
+            erase_stats.hits++;
+            return 1;
+        }
+    }
+    erase_stats.misses++;
+    return 0;
+}
+
+/*
+ * Puts an erased block in the pool if the next writes will get to it soon
+ */
+static void _pool_add(uint16_t block) {
+    PhysicalAddrs addr = {.block = _next_free_block(&highest_inode)};
+
+    if (pool_count >= ERASE_POOL_SIZE) {
+        return;
+    }
+    for (int i = 0; i < pool_count; i++) {
+        if (pool[i] == block) {
+            return;
+        }
+    }
+    if (NAND_is_Bad_Block(addr.block)) {
+        find_good_block(&addr);
+    }
+    for (int i = 0; i < ERASE_POOL_SIZE; i++) {
+        if (addr.block == block) {
+            pool[pool_count++] = block;
+            return;
+        }
+        find_good_block(&addr);
+    }
+}
+
+/*
+ * Erases an old file in the way of the circular buffer and drops it from the
+ * index
+ */
+static int _reclaim_file(inode_t *node) {
+    int rc;
+    iris_log("erasing file %d at block %d\r\n", node->id, node->start_block);
+    if ((rc = NANDfs_core_erase(node))) {
+        return rc;
+    }
+    _map_remove(node);
+    _cache_drop(node->id);
+    if (node->id == lowest_inode.id) {
+        // Just deleted the oldest file. Fine the new oldest file.
+        _refresh_lowest_inode();
+    }
+    return 0;
+}
+
+/*
+ * Erases one block of the next ERASE_POOL_SIZE the writes will use. Once the
+ * flash has wrapped the oldest file is next: with reclaim set it is erased
+ * now rather than by the write that reaches it, otherwise nothing is done.
+ * The file map tells where files start, so a full or stuck pool costs no
+ * flash access.
+ */
+int NANDfs_core_erase_ahead(int reclaim) {
+    PhysicalAddrs addr = {.block = _next_free_block(&highest_inode)};
+
+    if (writing) {
+        return 0;
+    }
+    if (checkpoint_dirty) {
+        _checkpoint_write();
+    }
+    if (NAND_is_Bad_Block(addr.block)) {
+        find_good_block(&addr);
+    }
+    for (int i = 0; i < ERASE_POOL_SIZE && pool_count < ERASE_POOL_SIZE; i++, find_good_block(&addr)) {
+        int pooled = 0;
+        for (int j = 0; j < pool_count; j++) {
+            pooled |= pool[j] == addr.block;
+        }
+        if (pooled) {
+            continue;
+        }
+        if (highest_inode.magic == MAGIC && addr.block == highest_inode.start_block) {
+            break; // Wrapped all the way around to the newest file
+        }
+        if (_map_test(file_map.starts, addr.block)) {
+            if (!reclaim || addr.block != lowest_inode.start_block || lowest_inode.id == highest_inode.id) {
+                break;
+            }
+            inode_t oldest = lowest_inode;
+            if (_reclaim_file(&oldest) || _checkpoint_write()) {
+                return -1;
+            }
+        } else if (_NANDfs_core_erase_block(addr.block) != Ret_Success) {
+            return pool_count; // Marked bad, the next call moves past it
+        }
+        _pool_add(addr.block);
+        break;
+    }
+    return pool_count;
+}
+
+void NANDfs_core_erase_stats(NANDfs_erase_stats_t *stats) { *stats = erase_stats; }
+
 NAND_ReturnType _NANDfs_core_erase_block(int block) {
     PhysicalAddrs addr = {0};
     addr.block = block;
@@ -250,41 +873,49 @@ NAND_ReturnType _NANDfs_core_erase_block(int block) {
 #if NAND_DEBUG
         iris_log("failed to erase block %d, ret:%d\r\n", addr.block, ret);
 #endif
-        NAND_Mark_Bad_Block(block);
+        _mark_bad_block(block);
         return Ret_EraseFailed;
     }
     return ret;
 }
 
-int NANDfs_core_format() {
-    for (int i = 0; i < NUM_BLOCKS; i++) {
+/*
+ * Erases every block from first on and starts an empty file system
+ */
+static int _format(int first) {
+    for (int i = first; i < NUM_BLOCKS; i++) {
         _NANDfs_core_erase_block(i);
     }
     memset(&lowest_inode, 0, sizeof(lowest_inode));
     memset(&highest_inode, 0, sizeof(highest_inode));
     lowest_inode.start_block = RESERVED_BLOCK_CNT;
     highest_inode.start_block = RESERVED_BLOCK_CNT;
+    memset(&file_map, 0, sizeof(file_map));
+    memset(inode_cache, 0, sizeof(inode_cache));
+    checkpoint_page = 0;
+    pool_count = 0;
 
-    return 0;
+    return _checkpoint_write();
 }
 
+int NANDfs_core_format() { return _format(0); }
+
 int NANDfs_core_erase(inode_t *inode) {
     PhysicalAddrs addr = {.block = inode->start_block};
-    inode_t fnode = {0};
+    page_meta_t meta = {0};
     do {
-        _NANDfs_core_erase_block(addr.block);
-        addr.block++;
-        if (addr.block >= NUM_BLOCKS) {
-            addr.block = RESERVED_BLOCK_CNT;
-        }
-        if (NAND_is_Bad_Block(addr.block)) {
-            continue;
+        // The start block is what the caller is after, the rest can be kept
+        if (_NANDfs_core_erase_block(addr.block) == Ret_Success && addr.block != inode->start_block) {
+            _pool_add(addr.block);
         }
-        NAND_ReturnType status = NAND_Page_Read(&addr, sizeof(inode_t), (uint8_t *)&fnode);
+        find_good_block(&addr);
+        // Continuation blocks are recognised by the metadata of their first page
+        NAND_ReturnType status = NAND_Spare_Read(&addr, SPARE_META_OFFSET, sizeof(meta), (uint8_t *)&meta);
         if (status != Ret_Success) {
+            nand_errno = NAND_EIO;
             return -1;
         }
-    } while (fnode.magic == MAGIC && fnode.id == inode->id);
+    } while (_meta_check(&meta) == 0 && meta.id == inode->id && meta.seq > 0);
 
     return 0;
 }
@@ -297,85 +928,182 @@ int NANDfs_core_delete(uint32_t inodeid) {
         nand_errno = NAND_EINVAL;
         return -1;
     }
-    return NANDfs_core_erase(&node);
+    if ((ret = _reclaim_file(&node))) {
+        return ret;
+    }
+    return _checkpoint_write();
 }
 
 /*
- * Writes happen in sizes of PAGE_DATA_SIZE unless it's the last partial page
+ * Waits for the page program started by _write_page. Any other NAND call
+ * waits for it too, but only this reports whether it passed.
  */
-int NANDfs_core_write(FileHandle_t *file, int size, void *buf) {
-    if (file->open == 0) {
-        nand_errno = NAND_EINVAL;
-        return -1;
-    }
-    if (file->readonly) {
-        nand_errno = NAND_EROFS;
-        return -1;
+static int _write_wait(void) {
+    if (program_pending) {
+        program_pending = 0;
+        if (NAND_Async_Complete() != Ret_Success) {
+            nand_errno = NAND_EIO;
+            return -1;
+        }
     }
-    if (size == 0) {
-        nand_errno = NAND_EINVAL;
-        return -1;
+    return 0;
+}
+
+/*
+ * Drops the file being written after a write to it failed. Nothing points at
+ * it until its inode is programmed at close, so the frontier goes back to the
+ * end of the file before it and the next file reuses its blocks. The handle
+ * stays open so the caller's close releases it.
+ */
+static void _write_abort(FileHandle_t *file) {
+    int err = nand_errno;
+
+    _write_wait(); // the file is gone, so is the result
+    nand_errno = err;
+    iris_log("dropping file %d after a failed write\r\n", file->node.id);
+    _map_remove(&file->node);
+    uint32_t prev = _map_prev_id(file->node.id);
+    if (lowest_inode.id == file->node.id) {
+        memset(&lowest_inode, 0, sizeof(lowest_inode));
     }
-    int pages_to_write = size / PAGE_DATA_SIZE;
-    if (pages_to_write == 0) {
-        pages_to_write = 1;
+    if (prev == 0) {
+        memset(&highest_inode, 0, sizeof(highest_inode));
+    } else if (_load_inode(prev, &highest_inode)) {
+        _scan_inodes();
     }
+    file->aborted = 1;
+    writing = 0;
+}
+
+/*
+ * Starts programming the handle's page buffer to the page at seek, moving to
+ * the next block first if the page is the start of one. With a second buffer
+ * the handle gets that one right away, otherwise this waits until the page
+ * is loaded into the device. Either way the program runs while the caller
+ * fills the buffer, and is only waited for before the next page.
+ */
+static int _write_page(FileHandle_t *file, int size) {
     PhysicalAddrs *seek = &(file->seek);
 
-    for (int i = 0; i < pages_to_write; i++) {
-        // If we reached the end of a block, page will be set to 0,
-        // This means we must delete the file that's in the way and add our own inode
-        if (seek->page == 0) {
-            inode_t node;
-            NAND_ReturnType status;
+    if (_write_wait()) {
+        return -1;
+    }
+
+    // If we reached the end of a block, page will be set to 0,
+    // This means we must delete the file that's in the way
+    if (seek->page == 0) {
+        inode_t node;
+        NAND_ReturnType status;
+
+        if (seek->block == file->node.start_block) { // Oh no, we hit our tail
+            nand_errno = NAND_EFBIG;
+            return -1;
+        }
+        if (!_pool_take(seek->block)) {
+            uint32_t stall_start = HAL_GetTick();
 
             if ((status = NAND_Page_Read(seek, sizeof(node), (uint8_t *)&node))) {
                 nand_errno = NAND_EIO;
                 return -1;
             }
-            if (node.magic == MAGIC) {          // This is a valid inode
-                if (node.id == file->node.id) { // Oh no, we hit our tail
-                    nand_errno = NAND_EFBIG;
+            if (node.magic == MAGIC && node.isfirst) { // This is a valid inode
+                if (_reclaim_file(&node)) {
                     return -1;
                 }
-                NANDfs_core_erase(&node);
                 if (NAND_is_Bad_Block(seek->block))
                     find_good_block(seek);
             } else { // Erase for good measure
                 NAND_ReturnType status = _NANDfs_core_erase_block(seek->block);
                 if ((status == Ret_EraseFailed)) {
-                    NAND_Mark_Bad_Block(seek->block);
+                    // Already marked bad
                     find_good_block(seek);
                 }
             }
-            // Now, write our inode to the first page
-            node = file->node;
-            node.isfirst = 0;
+            erase_stats.stall_ms += HAL_GetTick() - stall_start;
+        }
+        file->seq++;
 #if NAND_DEBUG
-            iris_log("writing intermediate inode %d at <%d,%d>\r\n", node.id, seek->block, seek->page);
+        iris_log("file %d block %d starts at <%d,%d>\r\n", file->node.id, file->seq, seek->block, seek->page);
 #endif
-            status = NAND_Page_Program(seek, sizeof(inode_t), (uint8_t *)&node);
-            if (status == Ret_Failed) {
-                nand_errno = NAND_EIO;
-                return -1;
+    }
+
+    // The owner of every page is recorded in its spare area
+    page_meta_t meta;
+    _meta_fill(&meta, file->node.id, file->seq, seek->page, 0);
+    if (NAND_Page_Program_Spare_Async(seek, size, file->wbuf, SPARE_META_OFFSET, sizeof(meta), (uint8_t *)&meta,
+                                      NULL, NULL) != Ret_Success) {
+        nand_errno = NAND_EIO;
+        return -1;
+    }
+    program_pending = 1;
+    file->node.file_size += size;
+    _increment_seek(seek, size);
+    if (file->wbuf_next) {
+        uint8_t *next = file->wbuf_next;
+        file->wbuf_next = file->wbuf;
+        file->wbuf = next;
+    } else {
+        // One buffer, it is free once the device has the data
+        uint32_t start = HAL_GetTick();
+        while (!NAND_Async_Execute()) {
+            if (HAL_GetTick() - start > NAND_SPI_TIMEOUT) {
+                return _write_wait(); // aborts the stuck transfer
             }
-            _increment_seek(seek, PAGE_DATA_SIZE);
-#if NAND_DEBUG
-            iris_log("first seek of new block: <%d,%d>\r\n", seek->block, seek->page);
-#endif
         }
+    }
+    return 0;
+}
 
-        if (NAND_Page_Program(seek, size, (uint8_t *)buf) == Ret_Failed) {
-            nand_errno = NAND_EIO;
-            return -1;
+/*
+ * Appends size bytes to the file. Data is collected in the handle's page
+ * buffer and only whole pages are programmed; close writes the tail. buf is
+ * free again on return, even though the last page may still be programming.
+ */
+int NANDfs_core_write(FileHandle_t *file, int size, void *buf) {
+    if (file->open == 0) {
+        nand_errno = NAND_EINVAL;
+        return -1;
+    }
+    if (file->readonly) {
+        nand_errno = NAND_EROFS;
+        return -1;
+    }
+    if (size <= 0) {
+        nand_errno = NAND_EINVAL;
+        return -1;
+    }
+    if (file->aborted) {
+        nand_errno = NAND_EIO;
+        return -1;
+    }
+    if (program_pending) {
+        NAND_Async_Execute(); // starts the last page's program if its data is loaded, never waits
+    }
+    const uint8_t *src = (const uint8_t *)buf;
+
+    while (size > 0) {
+        int len = PAGE_DATA_SIZE - file->buffered;
+        if (len > size) {
+            len = size;
+        }
+        memcpy(file->wbuf + file->buffered, src, len);
+        file->buffered += len;
+        src += len;
+        size -= len;
+        if (file->buffered == PAGE_DATA_SIZE) {
+            if (_write_page(file, PAGE_DATA_SIZE)) {
+                _write_abort(file);
+                return -1;
+            }
+            file->buffered = 0;
         }
-        file->node.file_size += size;
-        _increment_seek(seek, size);
     }
     return 0;
 }
 /*
- * READS happen in PAGE_DATA_SIZE right now except for the last partial page read
+ * READS happen in PAGE_DATA_SIZE right now except for the last partial page read.
+ * Pages are read with the device's cache read sequence, so the next page of the
+ * file is loaded from the array while the current one is clocked out.
  */
 int NANDfs_core_read(FileHandle_t *file, int size, void *buf) {
     // TODO: Add some sort of size checking
@@ -387,43 +1115,118 @@ int NANDfs_core_read(FileHandle_t *file, int size, void *buf) {
         nand_errno = NAND_EINVAL;
         return -1;
     }
-    int pages_to_read = size / PAGE_DATA_SIZE;
-    if (pages_to_read == 0) {
-        pages_to_read = 1;
-    }
     PhysicalAddrs *seek = &(file->seek);
+    uint8_t *dst = (uint8_t *)buf;
+
+    while (size > 0) {
+        int len = PAGE_DATA_SIZE - seek->column;
+        if (len > size) {
+            len = size;
+        }
+        int done = seek->column + len == PAGE_DATA_SIZE;
+
+        // Start loading the following page unless this is the end of the file
+        // or the next read picks up in this page again
+        PhysicalAddrs next = *seek;
+        next.column = 0;
+        _increment_seek(&next, PAGE_DATA_SIZE);
+        int more = done && file->offset + PAGE_DATA_SIZE < file->node.file_size;
 
-    for (int i = 0; i < pages_to_read; i++) {
-        // If we reached the end of a block, page will be set to 0,
-        // This means we must ensure we don't start reading a different file
-        if (seek->page == 0) {
-            inode_t node;
-            NAND_ReturnType status = NAND_Page_Read(seek, sizeof(node), (uint8_t *)&node);
-            if (status != Ret_Success) {
+        NAND_ReturnType ret = NAND_Page_Read_Sequential(seek, more ? &next : NULL, len, dst);
+        if (ret != Ret_Success) {
+            nand_errno = NAND_EIO;
+            return -1;
+        }
+
+        // If we entered a new block, page will be set to 0,
+        // This means we must ensure we didn't start reading a different file
+        if (seek->page == 0 && seek->column == 0) {
+            page_meta_t meta;
+            if (NAND_Spare_Read_Cache(seek, SPARE_META_OFFSET, sizeof(meta), (uint8_t *)&meta) != Ret_Success) {
                 nand_errno = NAND_EIO;
                 return -1;
             }
-            if (node.magic != MAGIC) { // This is a valid inode
+            if (_meta_check(&meta) || meta.id != file->node.id || meta.seq != file->seq) {
                 nand_errno = NAND_EINVAL;
                 return -1;
             }
-            if (node.id != file->node.id) {
-                nand_errno = NAND_EINVAL;
-                return -1;
+        }
+        if (done) {
+            *seek = next;
+            file->offset += PAGE_DATA_SIZE;
+            if (seek->page == 0) {
+                file->seq++;
             }
+        } else {
+            seek->column += len;
+        }
+        dst += len;
+        size -= len;
+    }
+    return 0;
+}
+
+/*
+ * Moves a file open for reading to offset. The page is worked out from the
+ * file's start block and the layout: the first block holds the inode and
+ * NUM_PAGES_PER_BLOCK - 1 data pages, every following good block holds
+ * NUM_PAGES_PER_BLOCK. Bad blocks are skipped with the bad block table in
+ * RAM, so the only flash access is the spare area read that confirms the
+ * page belongs to the file.
+ */
+int NANDfs_core_seek(FileHandle_t *file, uint32_t offset) {
+    if (file->open == 0) {
+        nand_errno = NAND_EINVAL;
+        return -1;
+    }
+    if (file->readonly == 0) {
+        // Files are written strictly sequentially
+        nand_errno = NAND_EPERM;
+        return -1;
+    }
+    if (offset > file->node.file_size) {
+        nand_errno = NAND_EINVAL;
+        return -1;
+    }
 
-            _increment_seek(seek, PAGE_DATA_SIZE);
+    uint32_t data_page = offset / PAGE_DATA_SIZE;
+    uint16_t seq = 0;
+    PhysicalAddrs addr = {.block = file->node.start_block, .column = offset % PAGE_DATA_SIZE};
+    if (data_page < NUM_PAGES_PER_BLOCK - 1) {
+        addr.page = data_page + 1; // skip the inode page
+    } else {
+        data_page -= NUM_PAGES_PER_BLOCK - 1;
+        seq = 1 + data_page / NUM_PAGES_PER_BLOCK;
+        addr.page = data_page % NUM_PAGES_PER_BLOCK;
+        for (int i = 0; i < seq; i++) {
+            find_good_block(&addr);
         }
-        NAND_ReturnType ret = NAND_Page_Read(seek, size, (uint8_t *)buf);
-        if (ret != Ret_Success) {
+    }
+
+    // Seeking to the end of a file may land on a page that was never written
+    if (offset < file->node.file_size) {
+        page_meta_t meta;
+        if (NAND_Spare_Read(&addr, SPARE_META_OFFSET, sizeof(meta), (uint8_t *)&meta) != Ret_Success) {
             nand_errno = NAND_EIO;
             return -1;
         }
-        _increment_seek(seek, size);
+        if (_meta_check(&meta) || meta.id != file->node.id || meta.seq != seq || meta.page != addr.page) {
+            nand_errno = NAND_EINVAL;
+            return -1;
+        }
     }
+
+    file->seek = addr;
+    file->offset = offset - addr.column;
+    file->seq = seq;
     return 0;
 }
 
+/*
+ * Opens a file for reading. Indexed files open without a flash access, the
+ * node then has the sizes and codec but not the name, parent or burst, which
+ * the directory entries read from the inode.
+ */
 int NANDfs_core_open(int fileid, FileHandle_t *file) {
     PhysicalAddrs addr = {0};
     inode_t node = {0};
@@ -444,8 +1247,11 @@ int NANDfs_core_open(int fileid, FileHandle_t *file) {
         nand_errno = NAND_ENOENT;
         return -1;
     }
+    _inode_fixup(&node);
     file->readonly = 1;
     file->open = 1;
+    file->offset = 0;
+    file->seq = 0;
     file->node = node;
     if (node.start_block != addr.block) {
 #if NAND_DEBUG
@@ -473,15 +1279,23 @@ int NANDfs_core_close_rdonly(FileHandle_t *file) {
     return 0;
 }
 
-int NANDfs_core_close_wronly(FileHandle_t *file) {
-    if (file->open == 0) {
-        nand_errno = NAND_EBADF;
-        return -1;
+/*
+ * Writes out the rest of a file and programs its inode
+ */
+static int _write_inode(FileHandle_t *file) {
+    // Write out whatever is left in the page buffer
+    if (file->buffered > 0) {
+        if (_write_page(file, file->buffered)) {
+            return -1;
+        }
+        file->buffered = 0;
     }
-    if (file->readonly == 1) {
-        nand_errno = NAND_EBADF;
+    if (_write_wait()) {
         return -1;
     }
+    if (file->node.codec == NAND_CODEC_NONE) {
+        file->node.raw_size = file->node.file_size;
+    }
 
     // We are closing a file that was just created. Update its first inode with the information.
     PhysicalAddrs addr = {.block = file->node.start_block};
@@ -489,11 +1303,41 @@ int NANDfs_core_close_wronly(FileHandle_t *file) {
     iris_log("closing file %d at block %d\r\n", file->node.id, addr.block);
 #endif
 
-    NAND_ReturnType status = NAND_Page_Program(&addr, sizeof(inode_t), (uint8_t *)&file->node);
+    page_meta_t meta;
+    _meta_fill(&meta, file->node.id, 0, 0, META_INODE);
+    NAND_ReturnType status = NAND_Page_Program_Spare(&addr, sizeof(inode_t), (uint8_t *)&file->node,
+                                                     SPARE_META_OFFSET, sizeof(meta), (uint8_t *)&meta);
     if (status != Ret_Success) {
         nand_errno = NAND_EIO;
         return -1;
     }
+    return 0;
+}
+
+/*
+ * Stores the file and releases the handle, also when that fails
+ */
+int NANDfs_core_close_wronly(FileHandle_t *file) {
+    if (file->open == 0) {
+        nand_errno = NAND_EBADF;
+        return -1;
+    }
+    if (file->readonly == 1) {
+        nand_errno = NAND_EBADF;
+        return -1;
+    }
+    if (file->aborted) {
+        memset(file, 0, sizeof(FileHandle_t));
+        nand_errno = NAND_EIO;
+        return -1;
+    }
+    if (_write_inode(file)) {
+        _write_abort(file);
+        memset(file, 0, sizeof(FileHandle_t));
+        return -1;
+    }
+    _cache_put(&file->node);
+    writing = 0;
 
     if (file->node.id == highest_inode.id) {
         // Update highest inode with size, etc.
@@ -511,7 +1355,7 @@ int NANDfs_core_close_wronly(FileHandle_t *file) {
     }
 
     memset(file, 0, sizeof(FileHandle_t));
-    return 0;
+    return _checkpoint_write();
 }
 
 int NANDfs_Core_opendir(DirHandle_t *dir) {
@@ -530,6 +1374,7 @@ int NANDfs_Core_opendir(DirHandle_t *dir) {
 
     dir->first = lowest_inode;
     dir->current = lowest_inode;
+    _inode_fixup(&dir->current);
     dir->open = 1;
 
     return 0;
@@ -546,26 +1391,20 @@ int NANDfs_Core_nextdir(DirHandle_t *dir) {
         return 0;
     }
 
-    /* addr should be the inode of the next file */
-    PhysicalAddrs addr = {.block = _next_free_block(&dir->current)};
 #if NAND_DEBUG
-    iris_log("nextdir: id %d, block %d, size %d; next inode at %d\r\n", dir->current.id, dir->current.start_block,
-             dir->current.file_size, addr.block);
+    iris_log("nextdir: id %d, block %d, size %d\r\n", dir->current.id, dir->current.start_block,
+             dir->current.file_size);
 #endif
     inode_t node = {0};
-    NAND_ReturnType status = NAND_Page_Read(&addr, sizeof(inode_t), (uint8_t *)&node);
-    if (status != Ret_Success) {
-        nand_errno = NAND_EIO;
-        return -1;
+    uint32_t id = _map_next_id(dir->current.id);
+    if (id == 0) {
+        return 0; // The files after it were erased
     }
-    if (node.magic != MAGIC || !node.isfirst) {
-#if NAND_DEBUG
-        iris_log("no inode at %d, magic %x\r\n", addr.block, node.magic);
-#endif
-        nand_errno = NAND_EFUBAR;
+    if (_load_inode(id, &node)) {
         return -1;
     }
 
+    _inode_fixup(&node);
     dir->current = node;
     return node.id;
 }
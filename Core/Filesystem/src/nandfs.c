@@ -27,12 +27,43 @@ extern "C" {
 #include "nand_errno.h"
 #include "nand_m79a_lld.h"
 #include "nand_core.h"
+#include "rle_stream.h"
+#include "loco.h"
+
+#define CODEC_IN_SIZE 64 // coded bytes read ahead when decoding, the page stays loaded in the NAND between reads
 
 int nand_errno = 0;
 
 FileHandle_t handles[FILEHANDLE_COUNT] = {0};
 DirHandle_t dir_handles[DIRHANDLE_COUNT] = {0};
 
+/*
+ * The one file being coded as it is written or decoded as it is read. The
+ * coder states are too big to keep one per handle. While no file is coded,
+ * the file being written borrows page as its second page buffer.
+ */
+static struct {
+    FileHandle_t *owner;
+    FileHandle_t *lent; // file writing into page
+    union {
+        rle_stream_t rle;
+        rle_decoder_t rle_dec;
+        loco_t loco;
+        uint8_t page[PAGE_DATA_SIZE];
+    } c;
+    uint8_t *dst;                       // buffer of the read in progress
+    int room;                           // bytes it still wants
+    uint8_t pending[2 * LOCO_OUT_SIZE]; // decoded bytes past the end of the last read
+    uint16_t pend_pos;
+    uint16_t pend_len;
+    uint8_t in[CODEC_IN_SIZE];
+    uint8_t in_pos;
+    uint8_t in_len;
+    uint32_t coded_left; // coded bytes not read from flash yet
+    uint8_t held;        // the decoder stopped with output held back
+    uint8_t finished;    // the end of the stream was decoded
+} codec;
+
 /*
  * Private function. Returns pointer to unopened file handle
  */
@@ -61,6 +92,134 @@ static DirHandle_t *_get_dir_handle() {
     return 0;
 }
 
+static int _codec_write_sink(const uint8_t *data, uint32_t len, void *arg) {
+    return NANDfs_core_write((FileHandle_t *)arg, len, (void *)data);
+}
+
+static int _codec_encode(FileHandle_t *file, int size, void *buf) {
+    int ret;
+
+    if (size <= 0) {
+        nand_errno = NAND_EINVAL;
+        return -1;
+    }
+    if (file->node.codec == NAND_CODEC_RLE) {
+        ret = rle_stream_feed(&codec.c.rle, buf, size);
+    } else {
+        ret = loco_encode(&codec.c.loco, buf, size);
+    }
+    return (ret < 0) ? -1 : 0;
+}
+
+/*
+ * Writes the end of the stream and records how big the data was
+ */
+static int _codec_encode_finish(FileHandle_t *file) {
+    int ret;
+
+    if (file->node.codec == NAND_CODEC_RLE) {
+        ret = rle_stream_finish(&codec.c.rle);
+        file->node.raw_size = codec.c.rle.in_bytes;
+    } else {
+        ret = loco_encoder_finish(&codec.c.loco);
+        file->node.raw_size = codec.c.loco.in_bytes;
+    }
+    return (ret < 0) ? -1 : 0;
+}
+
+/*
+ * Takes decoded bytes into the read in progress, and what doesn't fit into
+ * pending for the next read. Asks the decoder to stop once the read is full.
+ */
+static int _codec_read_sink(const uint8_t *data, uint32_t len, void *arg) {
+    (void)arg;
+    uint32_t n = (len < (uint32_t)codec.room) ? len : (uint32_t)codec.room;
+
+    memcpy(codec.dst, data, n);
+    codec.dst += n;
+    codec.room -= n;
+    if (n < len) {
+        if (codec.pend_pos == codec.pend_len) {
+            codec.pend_pos = 0;
+            codec.pend_len = 0;
+        }
+        if (codec.pend_len + len - n > sizeof(codec.pending)) {
+            return -1;
+        }
+        memcpy(codec.pending + codec.pend_len, data + n, len - n);
+        codec.pend_len += len - n;
+    }
+    return codec.room == 0;
+}
+
+static int _codec_decode(FileHandle_t *file, const uint8_t *in, uint32_t len) {
+    if (file->node.codec == NAND_CODEC_RLE) {
+        return rle_decoder_feed(&codec.c.rle_dec, in, len);
+    }
+    return loco_decode(&codec.c.loco, in, len);
+}
+
+static int _codec_decode_finish(FileHandle_t *file) {
+    if (file->node.codec == NAND_CODEC_RLE) {
+        return rle_decoder_finish(&codec.c.rle_dec);
+    }
+    return loco_decoder_finish(&codec.c.loco);
+}
+
+/*
+ * Reads size decoded bytes. Coded bytes are read from flash a block at a
+ * time but fed to the decoder one at a time, so the decoder stops within a
+ * sink call of the read being full and the overshoot fits in pending: a
+ * coded byte decodes to at most one block, the end of a stream to two.
+ */
+static int _decoded_read(FileHandle_t *file, int size, void *buf) {
+    if (size <= 0) {
+        nand_errno = NAND_EINVAL;
+        return -1;
+    }
+    codec.dst = (uint8_t *)buf;
+    codec.room = size;
+
+    int n = codec.pend_len - codec.pend_pos;
+    if (n > codec.room) {
+        n = codec.room;
+    }
+    memcpy(codec.dst, codec.pending + codec.pend_pos, n);
+    codec.pend_pos += n;
+    codec.dst += n;
+    codec.room -= n;
+
+    while (codec.room > 0) {
+        int ret;
+
+        if (codec.held) {
+            ret = codec.finished ? _codec_decode_finish(file) : _codec_decode(file, NULL, 0);
+        } else if (codec.in_pos < codec.in_len) {
+            ret = _codec_decode(file, &codec.in[codec.in_pos++], 1);
+        } else if (codec.coded_left > 0) {
+            codec.in_pos = 0;
+            codec.in_len = (codec.coded_left < CODEC_IN_SIZE) ? codec.coded_left : CODEC_IN_SIZE;
+            if (NANDfs_core_read(file, codec.in_len, codec.in)) {
+                codec.in_len = 0;
+                return -1;
+            }
+            codec.coded_left -= codec.in_len;
+            continue;
+        } else if (!codec.finished) {
+            codec.finished = 1;
+            ret = _codec_decode_finish(file);
+        } else {
+            ret = -1; // the stream holds less than the inode's raw size
+        }
+        if (ret < 0) {
+            nand_errno = NAND_EIO;
+            return -1;
+        }
+        codec.held = ret > 0;
+    }
+    return 0;
+}
+
 int NANDfs_init() { return NANDfs_Core_Init(); }
 
 int NANDfs_delete(int fileid) { return NANDfs_core_delete(fileid); }
@@ -75,6 +234,10 @@ NAND_FILE *NANDfs_create() {
     if (ret == -1) {
         return 0;
     }
+    if (!codec.owner) {
+        handle->wbuf_next = codec.c.page;
+        codec.lent = handle;
+    }
     return handle;
 }
 
@@ -85,11 +248,31 @@ NAND_FILE *NANDfs_create() {
  */
 int NANDfs_close(NAND_FILE *file) {
     FileHandle_t *fd = (FileHandle_t *)file;
-    if (file->readonly) {
-        return NANDfs_core_close_rdonly(fd);
+    int ret = 0;
+    int err = 0;
+    int rc;
+
+    if (codec.lent == fd) {
+        codec.lent = NULL;
+    }
+    if (codec.owner == fd) {
+        codec.owner = NULL;
+        if (!fd->readonly && _codec_encode_finish(fd)) {
+            ret = -1;
+            err = nand_errno;
+        }
+    }
+    // The handle is released whatever happened, the first error is returned
+    if (fd->readonly) {
+        rc = NANDfs_core_close_rdonly(fd);
     } else {
-        return NANDfs_core_close_wronly(fd);
+        rc = NANDfs_core_close_wronly(fd);
     }
+    if (ret) {
+        nand_errno = err;
+        return ret;
+    }
+    return rc;
 }
 
 /*
@@ -138,16 +321,126 @@ int NANDfs_closedir(NAND_DIR *dir) {
 
 int NANDfs_read(NAND_FILE *fd, int size, void *buf) {
     FileHandle_t *file = fd;
+    if (codec.owner == file) {
+        return _decoded_read(file, size, buf);
+    }
     return NANDfs_core_read(file, size, buf);
 }
 
+int NANDfs_seek(NAND_FILE *fd, uint32_t offset) {
+    FileHandle_t *file = fd;
+    if (codec.owner == file) {
+        // A coded stream only decodes from its start
+        nand_errno = NAND_EPERM;
+        return -1;
+    }
+    return NANDfs_core_seek(file, offset);
+}
+
 int NANDfs_write(NAND_FILE *fd, int size, void *buf) {
     FileHandle_t *file = (FileHandle_t *)fd;
+    if (codec.owner == file) {
+        return _codec_encode(file, size, buf);
+    }
     return NANDfs_core_write(file, size, buf);
 }
 
+/*
+ * Codes a new file's data with codec_id as it is written. Must come before
+ * the first write. The stream is finished at close, which records the codec
+ * and the raw size in the inode. line is the image's line length in bytes,
+ * used by the LOCO codecs.
+ *
+ * Only one file can be coded or decoded at a time.
+ */
+int NANDfs_set_codec(NAND_FILE *fd, uint8_t codec_id, uint16_t line) {
+    FileHandle_t *file = (FileHandle_t *)fd;
+
+    if (file->open == 0 || file->readonly || file->node.file_size || file->buffered || codec_id == NAND_CODEC_NONE ||
+        codec_id > NAND_CODEC_MAX) {
+        nand_errno = NAND_EINVAL;
+        return -1;
+    }
+    if (codec.owner) {
+        nand_errno = NAND_EBUSY;
+        return -1;
+    }
+    if (codec.lent == file) {
+        // Nothing is buffered yet, so the file can go back to one page buffer
+        file->wbuf_next = NULL;
+        codec.lent = NULL;
+    }
+    if (codec_id == NAND_CODEC_RLE) {
+        rle_stream_init(&codec.c.rle, _codec_write_sink, file);
+    } else {
+        loco_layout_t layout = (codec_id == NAND_CODEC_LOCO_BAYER8) ? LOCO_BAYER8 : LOCO_YUV422;
+        if (loco_encoder_init(&codec.c.loco, layout, line, _codec_write_sink, file)) {
+            nand_errno = NAND_EINVAL; // lines too long for the coder's ring
+            return -1;
+        }
+    }
+    file->node.codec = codec_id;
+    codec.owner = file;
+    return 0;
+}
+
+/*
+ * Makes the reads of a file open for reading return its data decoded, so
+ * node.raw_size bytes can be read. Must come before the first read, and
+ * seeks are refused after. Uncoded files read as they are.
+ *
+ * Only one file can be coded or decoded at a time, and not while a file is
+ * written uncoded.
+ */
+int NANDfs_decode(NAND_FILE *fd) {
+    FileHandle_t *file = (FileHandle_t *)fd;
+
+    if (file->open == 0 || !file->readonly || file->offset || file->seek.column) {
+        nand_errno = NAND_EINVAL;
+        return -1;
+    }
+    if (file->node.codec == NAND_CODEC_NONE) {
+        return 0;
+    }
+    if (codec.owner || codec.lent) {
+        nand_errno = NAND_EBUSY;
+        return -1;
+    }
+    if (file->node.codec == NAND_CODEC_RLE) {
+        rle_decoder_init(&codec.c.rle_dec, _codec_read_sink, NULL);
+    } else {
+        loco_decoder_init(&codec.c.loco, _codec_read_sink, NULL);
+    }
+    codec.pend_pos = 0;
+    codec.pend_len = 0;
+    codec.in_pos = 0;
+    codec.in_len = 0;
+    codec.coded_left = file->node.file_size;
+    codec.held = 0;
+    codec.finished = 0;
+    codec.owner = file;
+    return 0;
+}
+
 int NANDfs_format() { return NANDfs_core_format(); }
 
+uint32_t NANDfs_mount_time() { return NANDfs_core_mount_time(); }
+
+/*
+ * Once the flash has wrapped, the oldest file is reclaimed from here only
+ * while no file is open, so a file being read or written keeps its blocks.
+ */
+int NANDfs_erase_ahead() {
+    for (int i = 0; i < FILEHANDLE_COUNT; i++) {
+        if (handles[i].open) {
+            return NANDfs_core_erase_ahead(0);
+        }
+    }
+    return NANDfs_core_erase_ahead(1);
+}
+
+void NANDfs_erase_stats(NANDfs_erase_stats_t *stats) { NANDfs_core_erase_stats(stats); }
+
 #ifdef __cplusplus
 }
 #endif
@@ -242,10 +242,100 @@ int pattern_with_filesystem_test(int page_cnt) {
         }
     }
 
+    // Walk the pages backwards with seek, starting half way into each one
+    for (count = page_cnt - 1; count >= 0; count--) {
+        uint32_t offset = count * PAGE_DATA_SIZE + PAGE_DATA_SIZE / 2;
+        if ((rc = NANDfs_seek(fd, offset))) {
+            iris_log("seek to %d failed: %d\r\n", offset, nand_errno);
+            NANDfs_close(fd);
+            return -3;
+        }
+        memset(page, 0xff, PAGE_DATA_SIZE);
+        int len = (count + 1 < page_cnt) ? PAGE_DATA_SIZE : PAGE_DATA_SIZE / 2;
+        NANDfs_read(fd, len, page);
+        for (int i = 0; i < len; i++) {
+            uint8_t expect = (i < PAGE_DATA_SIZE / 2) ? count : count + 1;
+            if (page[i] != expect) {
+                iris_log("seek %d: bad byte %x at offset %d\r\n", offset, page[i], i);
+                break;
+            }
+        }
+    }
+
     NANDfs_close(fd);
     return 0;
 }
 
+/*
+ * Writes a RAW-like pattern, smooth lines with flat stretches, through each
+ * codec and reads it back decoded in reads that straddle the decoder's blocks
+ */
+int coded_with_filesystem_test(int page_cnt) {
+    const uint8_t codecs[] = {NAND_CODEC_RLE, NAND_CODEC_LOCO_BAYER8};
+    const int line = 640;
+    int rc = 0;
+
+    for (int c = 0; c < 2 && rc == 0; c++) {
+        NAND_FILE *fd = NANDfs_create();
+        if (!fd) {
+            iris_log("create failed: %d\r\n", nand_errno);
+            return -1;
+        }
+        if (NANDfs_set_codec(fd, codecs[c], line)) {
+            iris_log("codec %d refused: %d\r\n", codecs[c], nand_errno);
+            NANDfs_close(fd);
+            return -1;
+        }
+        for (int count = 0; count < page_cnt; count++) {
+            for (int i = 0; i < PAGE_DATA_SIZE; i++) {
+                int x = (count * PAGE_DATA_SIZE + i) % line;
+                page[i] = (x < line / 4) ? 0x10 : (uint8_t)(x / 3 + count);
+            }
+            if ((rc = NANDfs_write(fd, PAGE_DATA_SIZE, page))) {
+                iris_log("write page %d failed\r\n", count);
+                break;
+            }
+        }
+        int file_id = fd->node.id;
+        NANDfs_close(fd);
+
+        fd = NANDfs_open(file_id);
+        if (!fd || NANDfs_decode(fd)) {
+            iris_log("open file %d decoded failed: %d\r\n", file_id, nand_errno);
+            return -1;
+        }
+        iris_log("codec %d: %d bytes stored as %d\r\n", fd->node.codec, fd->node.raw_size, fd->node.file_size);
+        if (fd->node.raw_size != PAGE_DATA_SIZE * page_cnt || NANDfs_seek(fd, 0) == 0) {
+            iris_log("wrong raw size %d, or seek allowed\r\n", fd->node.raw_size);
+            rc = -2;
+        }
+
+        uint32_t offset = 0;
+        for (int len = 1; offset < fd->node.raw_size && rc == 0; len = len * 5 % PAGE_DATA_SIZE + 1) {
+            if (len > fd->node.raw_size - offset) {
+                len = fd->node.raw_size - offset;
+            }
+            if (NANDfs_read(fd, len, page)) {
+                iris_log("decoded read at %d failed: %d\r\n", offset, nand_errno);
+                rc = -3;
+                break;
+            }
+            for (int i = 0; i < len; i++, offset++) {
+                int count = offset / PAGE_DATA_SIZE;
+                int x = offset % line;
+                uint8_t expect = (x < line / 4) ? 0x10 : (uint8_t)(x / 3 + count);
+                if (page[i] != expect) {
+                    iris_log("codec %d: bad byte %x at offset %d\r\n", codecs[c], page[i], offset);
+                    rc = -4;
+                    break;
+                }
+            }
+        }
+        NANDfs_close(fd);
+    }
+    return rc;
+}
+
 int read_from_block(uint8_t block, uint16_t page) {
     PhysicalAddrs addr = {0};
     uint8_t buffer[PAGE_DATA_SIZE];
@@ -39,6 +39,9 @@ typedef struct {
     uint32_t file_id;
     uint8_t *file_name;
     uint32_t file_size;
+    uint32_t thumb_id;   // file id of the image's thumbnail, 0 for none
+    uint32_t thumb_size; // JPEG bytes of the thumbnail
+    uint32_t burst;      // id of the burst the image was captured in, 0 for none
 } FileInfo_t;
 
 #define SENSORS_OFF 0
@@ -46,11 +49,17 @@ typedef struct {
 
 #define MAX_IMAGE_FILES 20        // Maximum images that can be stored on NAND
 #define CAPTURE_TIMESTAMP_SIZE 33 // In bytes
+#define BURST_FRAMES_MAX 7        // ARDUCHIP_FRAMES is frames - 1, 7 there means continuous capture
+#define THUMBNAIL_WIDTH 320       // 320x240, a few KB as JPEG
 
 void get_housekeeping(housekeeping_packet_t *hk);
-void take_image();
+int take_image(uint8_t *vis_timestamp, uint8_t *nir_timestamp);
+int take_burst(uint8_t frames);
+int take_thumbnails();
+void get_capture_latency(uint16_t *vis_ms, uint16_t *nir_ms);
 void get_image_count(uint8_t *cnt);
 int get_image_length(uint32_t *image_length, uint8_t index);
+void get_thumbnail_length(uint32_t *thumb_length, uint8_t index);
 void turn_off_sensors();
 void turn_on_sensors();
 void set_configurations(Iris_config *config);
@@ -60,7 +69,9 @@ void set_rtc_time(uint32_t obc_unix_time);
 void get_rtc_time(Iris_Timestamp *timestamp);
 int transfer_image_to_nand(uint8_t sensor, uint8_t *file_timestamp);
 int delete_image_file_from_queue(uint16_t index);
+int ack_image_file_in_queue(uint32_t file_id, uint8_t first);
 NAND_FILE *get_image_file_from_queue(uint8_t index);
+NAND_FILE *get_thumbnail_file_from_queue(uint8_t index);
 void set_capture_timestamp(uint8_t *file_timestamp, uint8_t sensor);
 int store_file_infos_in_buffer();
 void flood_cam_spi();
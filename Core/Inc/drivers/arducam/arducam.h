@@ -17,6 +17,16 @@
 #define OV5642_CHIPID_HIGH 0x300a
 #define OV5642_CHIPID_LOW 0x300b
 
+#define REG_SYS_CTL0 0x3008 /* System Control */
+#define REG_DVPHO_HI 0x3808 /* DVP output horizontal width */
+#define REG_DVPHO_LO 0x3809
+#define REG_DVPVO_HI 0x380a /* DVP output vertical height */
+#define REG_DVPVO_LO 0x380b
+#define REG_FORMAT_CTL 0x4300
+
+#define OV5642_RESET_SETTLE_MS 10 // software reset to the first register write
+#define OV5642_MODE_SETTLE_MS 270 // two frames at 7.5 fps for a new window to reach the FIFO
+
 #define OV5642_320x240 0   // 320x240
 #define OV5642_640x480 1   // 640x480
 #define OV5642_1024x768 2  // 1024x768
@@ -53,11 +63,17 @@ struct sensor_reg {
     uint16_t val;
 };
 
+#define REG_LIST_END 0xffff
+#define REG_DELAY 0xfffe // table entry waiting val ms before the next write
+
 void program_sensor(int m_fmt, int sensor);
+void program_sensors(int m_fmt, const uint8_t *sensors, int count);
 bool arducam_wait_for_ready(uint8_t sensor);
+bool arducam_calibrate_spi(uint8_t sensor);
 void arducam_raw_init(int width, int depth, uint8_t sensor);
 void arducam_get_resolution(int *width, int *depth, uint8_t sensor);
 int arducam_set_resolution(int format, int width, uint8_t sensor);
+int arducam_set_resolutions(int format, int width, const uint8_t *sensors, int count);
 int arducam_get_saturation(uint8_t sensor);
 void arducam_set_saturation(int saturation, uint8_t sensor);
 uint8_t get_bit(uint8_t addr, uint8_t bit, uint8_t sensor);
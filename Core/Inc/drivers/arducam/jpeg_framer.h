@@ -0,0 +1,34 @@
+/*
+ * jpeg_framer.h
+ *
+ * Streaming JPEG framer for the Arducam FIFO. The FIFO holds the JPEG with
+ * padding and stale data around it, the framer passes on only the bytes from
+ * SOI (FFD8) up to and including EOI (FFD9), a chunk at a time. A burst
+ * capture leaves several JPEGs in the FIFO, each is framed by starting a new
+ * framer where the last one stopped.
+ */
+#ifndef INC_DRIVERS_ARDUCAM_JPEG_FRAMER_H_
+#define INC_DRIVERS_ARDUCAM_JPEG_FRAMER_H_
+
+#include <stdint.h>
+
+typedef enum { JPEG_FRAMER_SEEK, JPEG_FRAMER_BODY, JPEG_FRAMER_DONE } jpeg_framer_state_t;
+
+typedef struct {
+    jpeg_framer_state_t state;
+    uint8_t prev;    // last byte seen, markers can straddle chunks
+    uint32_t length; // JPEG bytes passed on so far
+    uint32_t used;   // bytes of the last chunk fed that were looked at
+} jpeg_framer_t;
+
+/*
+ * Receives the JPEG bytes of a chunk, returns < 0 to stop the framer
+ */
+typedef int (*jpeg_sink_t)(const uint8_t *data, uint32_t len, void *arg);
+
+void jpeg_framer_init(jpeg_framer_t *framer);
+int jpeg_framer_feed(jpeg_framer_t *framer, const uint8_t *chunk, uint32_t len, jpeg_sink_t sink, void *arg);
+
+static inline int jpeg_framer_done(const jpeg_framer_t *framer) { return framer->state == JPEG_FRAMER_DONE; }
+
+#endif /* INC_DRIVERS_ARDUCAM_JPEG_FRAMER_H_ */
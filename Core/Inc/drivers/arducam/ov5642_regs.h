@@ -3,21 +3,16 @@
 #include "arducam.h"
 //#include <avr/pgmspace.h>
 
-#define OV5642_CHIPID_HIGH 0x300a
-#define OV5642_CHIPID_LOW 0x300b
-
-#define REG_SYS_CTL0 0x3008 /* System Control */
-#define REG_DVPHO_HI 0x3808 /* DVP output horizontal width */
-#define REG_DVPHO_LO 0x3809
-#define REG_DVPVO_HI 0x380a /* DVP output vertical height */
-#define REG_DVPVO_LO 0x380b
-#define REG_FORMAT_CTL 0x4300
-
-#define REG_LIST_END 0xffff
+/*
+ * Source of the OV5642 register tables. The firmware uses the run encoded
+ * copies in ov5642_regs_packed.h, regenerate them with host/ov5642_pack
+ * after changing a table here.
+ */
 
 const struct sensor_reg OV5642_RAW_Init_start[] = {
     {0x3103, 0x03},       // PCLK Clock Select - from pre-divider
     {REG_SYS_CTL0, 0x82}, // System Ctl - Software reset
+    {REG_DELAY, OV5642_RESET_SETTLE_MS},
     {0x3017, 0x7f},       // PAD output enable 1 - enable all
     {0x3018, 0xfc},       // PAD output enable 2 - enable all except GPIO
     {0x3810, 0xc2},       // Timing Horizontal and Vertical Offset
@@ -166,12 +161,12 @@ const struct sensor_reg ov5642_320x240[] = {
 };
 
 const struct sensor_reg ov5642_640x480[] = {
-    {0x3800, 0x1},       {0x3801, 0xa8},       {0x3802, 0x0},  {0x3803, 0xA},       {0x3804, 0xA},
+    {0x3800, 0x1},       {0x3801, 0xb0},       {0x3802, 0x0},  {0x3803, 0xA},       {0x3804, 0xA},
     {0x3805, 0x20},      {0x3806, 0x7},        {0x3807, 0x98}, {REG_DVPHO_HI, 0x2}, {REG_DVPHO_LO, 0x80},
     {REG_DVPVO_HI, 0x1}, {REG_DVPVO_LO, 0xe0}, {0x380c, 0xc},  {0x380d, 0x80},      {0x380e, 0x7},
     {0x380f, 0xd0},      {0x5001, 0x7f},       {0x5680, 0x0},  {0x5681, 0x0},       {0x5682, 0xA},
     {0x5683, 0x20},      {0x5684, 0x0},        {0x5685, 0x0},  {0x5686, 0x7},       {0x5687, 0x98},
-    {0x3801, 0xb0},      {REG_LIST_END, 0xff},
+    {REG_LIST_END, 0xff},
 };
 
 const struct sensor_reg ov5642_1280x960[] = {
@@ -320,7 +315,8 @@ const struct sensor_reg ov5642_2592x1944[]  =
 
 #endif
 const struct sensor_reg OV5642_QVGA_Preview[] = {
-    {0x3103, 0x93},       {REG_SYS_CTL0, 0x82}, {0x3017, 0x7f},       {0x3018, 0xfc},         {0x3810, 0xc2},
+    {0x3103, 0x93},       {REG_SYS_CTL0, 0x82}, {REG_DELAY, OV5642_RESET_SETTLE_MS},
+    {0x3017, 0x7f},       {0x3018, 0xfc},       {0x3810, 0xc2},
     {0x3615, 0xf0},       {0x3000, 0x00},       {0x3001, 0x00},       {0x3002, 0x5c},         {0x3003, 0x00},
     {0x3004, 0xff},       {0x3005, 0xff},       {0x3006, 0x43},       {0x3007, 0x37},         {0x3011, 0x08},
     {0x3010, 0x10},       {0x460c, 0x22},       {0x3815, 0x04},       {0x370c, 0xa0},         {0x3602, 0xfc},
@@ -474,6 +470,18 @@ const struct sensor_reg OV5642_JPEG_Capture_QSXGA[] = {
 
 };
 
+// Applied after OV5642_JPEG_Capture_QSXGA and the 320x240 window
+const struct sensor_reg OV5642_JPEG_Finish[] = {
+    {0x3818, 0xa8}, // Timing Ctl
+    {0x3621, 0x10}, // Array Ctl 01
+    {0x3801, 0xb0}, // Horizontal start
+    {0x4407, 0x08}, // JPEG quality
+    {0x5888, 0x00},
+    {0x5000, 0xFF}, // enable lens correction
+    {REG_DELAY, OV5642_MODE_SETTLE_MS},
+    {REG_LIST_END, 0xff},
+};
+
 const struct sensor_reg ov5642_2592x1944[] = {
     {0x3800, 0x1},  {0x3801, 0xB0}, {0x3802, 0x0},  {0x3803, 0xA},  {0x3804, 0xA},  {0x3805, 0x20}, {0x3806, 0x7},
     {0x3807, 0x98}, {0x3808, 0xA},  {0x3809, 0x20}, {0x380a, 0x7},  {0x380b, 0x98}, {0x380c, 0xc},  {0x380d, 0x80},
@@ -0,0 +1,164 @@
+/*
+ * ov5642_regs_packed.h
+ *
+ * Generated by host/ov5642_pack from ov5642_regs.h, do not edit.
+ * Run encoded for sccb_write_packed(), the format is in sccb_table.h.
+ */
+#ifndef OV5642_REGS_PACKED_H
+#define OV5642_REGS_PACKED_H
+
+#include <stdint.h>
+
+// 584 entries, 2340 bytes as sensor_reg
+const uint8_t OV5642_QVGA_Preview_packed[989] = {
+    0x01, 0x31, 0x03, 0x93, 0x01, 0x30, 0x08, 0x82, 0x80, 0x0a, 0x42, 0x17, 0x7f, 0xfc, 0x01, 0x38,
+    0x10, 0xc2, 0x01, 0x36, 0x15, 0xf0, 0x08, 0x30, 0x00, 0x00, 0x00, 0x5c, 0x00, 0xff, 0xff, 0x43,
+    0x37, 0x41, 0x11, 0x08, 0x41, 0x10, 0x10, 0x01, 0x46, 0x0c, 0x22, 0x01, 0x38, 0x15, 0x04, 0x01,
+    0x37, 0x0c, 0xa0, 0x01, 0x36, 0x02, 0xfc, 0x41, 0x12, 0xff, 0x41, 0x34, 0xc0, 0x41, 0x13, 0x00,
+    0x41, 0x05, 0x7c, 0x42, 0x21, 0x09, 0x60, 0x41, 0x04, 0x40, 0x41, 0x03, 0xa7, 0x41, 0x03, 0x27,
+    0x01, 0x40, 0x00, 0x21, 0x41, 0x1d, 0x22, 0x01, 0x36, 0x00, 0x54, 0x42, 0x05, 0x04, 0x3f, 0x01,
+    0x3c, 0x01, 0x80, 0x01, 0x50, 0x00, 0x4f, 0x41, 0x20, 0x04, 0x02, 0x51, 0x81, 0x79, 0x00, 0x41,
+    0x85, 0x22, 0x41, 0x97, 0x01, 0x01, 0x50, 0x01, 0xff, 0x01, 0x55, 0x00, 0x0a, 0x42, 0x04, 0x00,
+    0x7f, 0x01, 0x50, 0x80, 0x08, 0x01, 0x30, 0x0e, 0x18, 0x01, 0x46, 0x10, 0x00, 0x01, 0x47, 0x1d,
+    0x05, 0x41, 0x08, 0x06, 0x04, 0x38, 0x08, 0x02, 0x80, 0x01, 0xe0, 0x42, 0x0e, 0x07, 0xd0, 0x01,
+    0x50, 0x1f, 0x00, 0x41, 0x00, 0x4f, 0x01, 0x43, 0x00, 0x30, 0x01, 0x35, 0x03, 0x07, 0x42, 0x01,
+    0x73, 0x80, 0x41, 0x0b, 0x00, 0x41, 0x03, 0x07, 0x01, 0x38, 0x24, 0x11, 0x02, 0x35, 0x01, 0x1e,
+    0x80, 0x41, 0x0b, 0x7f, 0x04, 0x38, 0x0c, 0x0c, 0x80, 0x03, 0xe8, 0x02, 0x3a, 0x0d, 0x04, 0x03,
+    0x01, 0x38, 0x18, 0xc1, 0x01, 0x37, 0x05, 0xdb, 0x41, 0x0a, 0x81, 0x01, 0x38, 0x01, 0x80, 0x01,
+    0x36, 0x21, 0x87, 0x01, 0x38, 0x01, 0x50, 0x41, 0x03, 0x08, 0x41, 0x27, 0x08, 0x41, 0x10, 0x40,
+    0x42, 0x04, 0x05, 0x00, 0x02, 0x56, 0x82, 0x05, 0x00, 0x02, 0x38, 0x06, 0x03, 0xc0, 0x02, 0x56,
+    0x86, 0x03, 0xbc, 0x01, 0x3a, 0x00, 0x78, 0x41, 0x1a, 0x05, 0x41, 0x13, 0x30, 0x42, 0x18, 0x00,
+    0x7c, 0x44, 0x08, 0x12, 0xc0, 0x0f, 0xa0, 0x02, 0x35, 0x0c, 0x07, 0xd0, 0x43, 0x00, 0x00, 0x00,
+    0x00, 0x42, 0x0a, 0x00, 0x00, 0x41, 0x03, 0x00, 0x07, 0x52, 0x8a, 0x02, 0x04, 0x08, 0x08, 0x08,
+    0x10, 0x10, 0x4e, 0x92, 0x00, 0x02, 0x00, 0x02, 0x00, 0x02, 0x00, 0x02, 0x00, 0x02, 0x00, 0x02,
+    0x00, 0x02, 0x01, 0x30, 0x30, 0x0b, 0x03, 0x3a, 0x02, 0x00, 0x7d, 0x00, 0x43, 0x14, 0x00, 0x7d,
+    0x00, 0x41, 0x00, 0x78, 0x44, 0x08, 0x09, 0x60, 0x07, 0xd0, 0x42, 0x0d, 0x08, 0x06, 0x01, 0x51,
+    0x93, 0x70, 0x01, 0x58, 0x9b, 0x04, 0x41, 0x9a, 0xc5, 0x01, 0x40, 0x1e, 0x20, 0x41, 0x01, 0x42,
+    0x41, 0x1c, 0x04, 0x07, 0x52, 0x8a, 0x01, 0x04, 0x08, 0x10, 0x20, 0x28, 0x30, 0x4e, 0x92, 0x00,
+    0x01, 0x00, 0x04, 0x00, 0x08, 0x00, 0x10, 0x00, 0x20, 0x00, 0x28, 0x00, 0x30, 0x41, 0x82, 0x00,
+    0x04, 0x53, 0x00, 0x00, 0x20, 0x00, 0x7c, 0x46, 0x0c, 0x00, 0x0c, 0x20, 0x80, 0x20, 0x80, 0x42,
+    0x08, 0x20, 0x40, 0x44, 0x04, 0x00, 0x30, 0x00, 0x80, 0x42, 0x14, 0x08, 0x20, 0x41, 0x19, 0x30,
+    0x43, 0x16, 0x10, 0x00, 0x02, 0x02, 0x54, 0x02, 0x3f, 0x00, 0x01, 0x34, 0x06, 0x00, 0x1f, 0x51,
+    0x80, 0xff, 0x52, 0x11, 0x14, 0x25, 0x24, 0x06, 0x08, 0x08, 0x7c, 0x60, 0xb2, 0xb2, 0x44, 0x3d,
+    0x58, 0x46, 0xf8, 0x04, 0x70, 0xf0, 0xf0, 0x03, 0x01, 0x04, 0x12, 0x04, 0x00, 0x06, 0x82, 0x00,
+    0x01, 0x50, 0x25, 0x80, 0x02, 0x55, 0x83, 0x40, 0x40, 0x41, 0x80, 0x02, 0x01, 0x50, 0x00, 0xcf,
+    0x01, 0x37, 0x10, 0x10, 0x01, 0x36, 0x32, 0x51, 0x03, 0x37, 0x02, 0x10, 0xb2, 0x18, 0x41, 0x0b,
+    0x40, 0x41, 0x0d, 0x03, 0x02, 0x36, 0x31, 0x01, 0x52, 0x41, 0x06, 0x24, 0x41, 0x20, 0x96, 0x01,
+    0x57, 0x85, 0x07, 0x01, 0x3a, 0x13, 0x30, 0x01, 0x36, 0x00, 0x52, 0x41, 0x04, 0x48, 0x41, 0x06,
+    0x1b, 0x01, 0x37, 0x0d, 0x0b, 0x41, 0x0f, 0xc0, 0x41, 0x09, 0x01, 0x01, 0x38, 0x23, 0x00, 0x01,
+    0x50, 0x07, 0x00, 0x41, 0x09, 0x00, 0x41, 0x11, 0x00, 0x41, 0x13, 0x00, 0x01, 0x51, 0x9e, 0x00,
+    0x04, 0x50, 0x86, 0x00, 0x00, 0x00, 0x00, 0x01, 0x30, 0x2b, 0x00, 0x04, 0x38, 0x08, 0x01, 0x40,
+    0x00, 0xf0, 0x01, 0x3a, 0x00, 0x78, 0x01, 0x50, 0x01, 0xff, 0x02, 0x55, 0x83, 0x50, 0x50, 0x41,
+    0x80, 0x02, 0x01, 0x3c, 0x01, 0x80, 0x41, 0x00, 0x04, 0x3f, 0x58, 0x00, 0x48, 0x31, 0x21, 0x1b,
+    0x1a, 0x1e, 0x29, 0x38, 0x26, 0x17, 0x11, 0x0e, 0x0d, 0x0e, 0x13, 0x1a, 0x15, 0x0d, 0x08, 0x05,
+    0x04, 0x05, 0x09, 0x0d, 0x11, 0x0a, 0x04, 0x00, 0x00, 0x01, 0x06, 0x09, 0x12, 0x0b, 0x04, 0x00,
+    0x00, 0x01, 0x06, 0x0a, 0x17, 0x0f, 0x09, 0x06, 0x05, 0x06, 0x0a, 0x0e, 0x28, 0x1a, 0x11, 0x0e,
+    0x0e, 0x0f, 0x15, 0x1d, 0x6e, 0x39, 0x27, 0x1f, 0x1e, 0x23, 0x2f, 0x7f, 0x3f, 0x41, 0x0e, 0x0c,
+    0x0d, 0x0c, 0x0c, 0x0c, 0x0c, 0x0c, 0x0d, 0x0e, 0x0e, 0x0a, 0x0e, 0x0e, 0x10, 0x10, 0x11, 0x0a,
+    0x0f, 0x0e, 0x10, 0x10, 0x10, 0x0a, 0x0e, 0x0e, 0x0f, 0x0f, 0x0f, 0x0a, 0x09, 0x0d, 0x0c, 0x0b,
+    0x0d, 0x07, 0x17, 0x14, 0x18, 0x18, 0x16, 0x12, 0x1b, 0x1a, 0x16, 0x16, 0x18, 0x1f, 0x1c, 0x16,
+    0x10, 0x0f, 0x13, 0x1c, 0x1e, 0x17, 0x11, 0x11, 0x14, 0x1e, 0x1c, 0x1c, 0x4a, 0x7e, 0x1a, 0x1a,
+    0x1b, 0x1f, 0x14, 0x1a, 0x1d, 0x1e, 0x1a, 0x1a, 0x1f, 0x51, 0x80, 0xff, 0x52, 0x11, 0x14, 0x25,
+    0x24, 0x14, 0x14, 0x14, 0x69, 0x60, 0xa2, 0x9c, 0x36, 0x34, 0x54, 0x4c, 0xf8, 0x04, 0x70, 0xf0,
+    0xf0, 0x03, 0x01, 0x05, 0x2f, 0x04, 0x00, 0x06, 0xa0, 0xa0, 0x07, 0x52, 0x8a, 0x00, 0x01, 0x04,
+    0x08, 0x10, 0x20, 0x30, 0x4e, 0x92, 0x00, 0x00, 0x00, 0x01, 0x00, 0x04, 0x00, 0x08, 0x00, 0x10,
+    0x00, 0x20, 0x00, 0x30, 0x41, 0x82, 0x00, 0x04, 0x53, 0x00, 0x00, 0x20, 0x00, 0x7c, 0x46, 0x0c,
+    0x00, 0x10, 0x20, 0x80, 0x20, 0x80, 0x42, 0x08, 0x20, 0x40, 0x44, 0x04, 0x00, 0x30, 0x00, 0x80,
+    0x42, 0x14, 0x08, 0x20, 0x41, 0x19, 0x30, 0x43, 0x16, 0x10, 0x00, 0x02, 0x55, 0x80, 0x01, 0x00,
+    0x00, 0x1f, 0x00, 0x06, 0x00, 0x00, 0x00, 0xe1, 0x00, 0x2b, 0x00, 0x00, 0x00, 0x10, 0x00, 0xb3,
+    0x00, 0xa6, 0x08, 0x38, 0x54, 0x80, 0x0c, 0x18, 0x2f, 0x55, 0x64, 0x71, 0x7d, 0x87, 0x91, 0x9a,
+    0xaa, 0xb8, 0xcd, 0xdd, 0xea, 0x1d, 0x05, 0x00, 0x04, 0x20, 0x03, 0x60, 0x02, 0xb8, 0x02, 0x86,
+    0x02, 0x5b, 0x02, 0x3b, 0x02, 0x1c, 0x02, 0x04, 0x01, 0xed, 0x01, 0xc5, 0x01, 0xa5, 0x01, 0x6c,
+    0x01, 0x41, 0x01, 0x20, 0x00, 0x16, 0x01, 0x20, 0x00, 0x10, 0x00, 0xf0, 0x00, 0xdf, 0x42, 0x02,
+    0x3f, 0x00, 0x01, 0x55, 0x00, 0x10, 0x44, 0x02, 0x00, 0x06, 0x00, 0x7f, 0x01, 0x50, 0x25, 0x80,
+    0x02, 0x3a, 0x0f, 0x30, 0x28, 0x41, 0x1b, 0x30, 0x41, 0x1e, 0x28, 0x41, 0x11, 0x61, 0x41, 0x1f,
+    0x10, 0x08, 0x56, 0x88, 0xfd, 0xdf, 0xfe, 0xef, 0xfe, 0xef, 0xaa, 0xaa, 0x00,
+};
+
+// 67 entries, 272 bytes as sensor_reg
+const uint8_t OV5642_JPEG_Capture_QSXGA_packed[168] = {
+    0x01, 0x35, 0x03, 0x07, 0x04, 0x30, 0x00, 0x00, 0x00, 0x00, 0x00, 0x43, 0x05, 0xff, 0xff, 0x3f,
+    0x02, 0x35, 0x0c, 0x07, 0xd0, 0x01, 0x36, 0x02, 0xe4, 0x42, 0x12, 0xac, 0x44, 0x43, 0x21, 0x27,
+    0x08, 0x22, 0x41, 0x04, 0x60, 0x01, 0x37, 0x05, 0xda, 0x41, 0x0a, 0x80, 0x01, 0x38, 0x01, 0x8a,
+    0x4e, 0x03, 0x0a, 0x0a, 0x20, 0x07, 0x98, 0x0a, 0x20, 0x07, 0x98, 0x0c, 0x80, 0x07, 0xd0, 0xc2,
+    0x41, 0x15, 0x44, 0x41, 0x18, 0xc8, 0x41, 0x24, 0x01, 0x41, 0x27, 0x0a, 0x01, 0x3a, 0x00, 0x78,
+    0x42, 0x0d, 0x10, 0x0d, 0x41, 0x10, 0x32, 0x41, 0x1b, 0x3c, 0x41, 0x1e, 0x32, 0x41, 0x11, 0x80,
+    0x41, 0x1f, 0x20, 0x41, 0x00, 0x78, 0x01, 0x46, 0x0b, 0x35, 0x01, 0x47, 0x1d, 0x00, 0x41, 0x13,
+    0x03, 0x41, 0x1c, 0x50, 0x02, 0x56, 0x82, 0x0a, 0x20, 0x42, 0x86, 0x07, 0x98, 0x01, 0x50, 0x01,
+    0x4f, 0x01, 0x58, 0x9b, 0x00, 0x41, 0x9a, 0xc0, 0x01, 0x44, 0x07, 0x04, 0x01, 0x58, 0x9b, 0x00,
+    0x41, 0x9a, 0xc0, 0x01, 0x30, 0x02, 0x0c, 0x41, 0x02, 0x00, 0x01, 0x35, 0x03, 0x00, 0x02, 0x30,
+    0x10, 0x10, 0x08, 0x01, 0x50, 0x00, 0xff, 0x00,
+};
+
+// 7 entries, 32 bytes as sensor_reg
+const uint8_t OV5642_JPEG_Finish_packed[27] = {
+    0x01, 0x38, 0x18, 0xa8, 0x01, 0x36, 0x21, 0x10, 0x01, 0x38, 0x01, 0xb0, 0x01, 0x44, 0x07, 0x08,
+    0x01, 0x58, 0x88, 0x00, 0x01, 0x50, 0x00, 0xff, 0x81, 0x0e, 0x00,
+};
+
+// 26 entries, 108 bytes as sensor_reg
+const uint8_t ov5642_320x240_packed[39] = {
+    0x10, 0x38, 0x00, 0x01, 0xa8, 0x00, 0x0a, 0x0a, 0x20, 0x07, 0x98, 0x01, 0x40, 0x00, 0xf0, 0x0c,
+    0x80, 0x07, 0xd0, 0x01, 0x50, 0x01, 0x7f, 0x08, 0x56, 0x80, 0x00, 0x00, 0x0a, 0x20, 0x00, 0x00,
+    0x07, 0x98, 0x01, 0x30, 0x11, 0x0f, 0x00,
+};
+
+// 25 entries, 104 bytes as sensor_reg
+const uint8_t ov5642_640x480_packed[35] = {
+    0x10, 0x38, 0x00, 0x01, 0xb0, 0x00, 0x0a, 0x0a, 0x20, 0x07, 0x98, 0x02, 0x80, 0x01, 0xe0, 0x0c,
+    0x80, 0x07, 0xd0, 0x01, 0x50, 0x01, 0x7f, 0x08, 0x56, 0x80, 0x00, 0x00, 0x0a, 0x20, 0x00, 0x00,
+    0x07, 0x98, 0x00,
+};
+
+// 25 entries, 104 bytes as sensor_reg
+const uint8_t ov5642_1024x768_packed[35] = {
+    0x10, 0x38, 0x00, 0x01, 0xb0, 0x00, 0x0a, 0x0a, 0x20, 0x07, 0x98, 0x04, 0x00, 0x03, 0x00, 0x0c,
+    0x80, 0x07, 0xd0, 0x01, 0x50, 0x01, 0x7f, 0x08, 0x56, 0x80, 0x00, 0x00, 0x0a, 0x20, 0x00, 0x00,
+    0x07, 0x98, 0x00,
+};
+
+// 25 entries, 104 bytes as sensor_reg
+const uint8_t ov5642_1280x960_packed[35] = {
+    0x10, 0x38, 0x00, 0x01, 0xb0, 0x00, 0x0a, 0x0a, 0x20, 0x07, 0x98, 0x05, 0x00, 0x03, 0xc0, 0x0c,
+    0x80, 0x07, 0xd0, 0x01, 0x50, 0x01, 0x7f, 0x08, 0x56, 0x80, 0x00, 0x00, 0x0a, 0x20, 0x00, 0x00,
+    0x07, 0x98, 0x00,
+};
+
+// 25 entries, 104 bytes as sensor_reg
+const uint8_t ov5642_2592x1944_packed[35] = {
+    0x10, 0x38, 0x00, 0x01, 0xb0, 0x00, 0x0a, 0x0a, 0x20, 0x07, 0x98, 0x0a, 0x20, 0x07, 0x98, 0x0c,
+    0x80, 0x07, 0xd0, 0x01, 0x50, 0x01, 0x7f, 0x08, 0x56, 0x80, 0x00, 0x00, 0x0a, 0x20, 0x00, 0x00,
+    0x07, 0x98, 0x00,
+};
+
+// 46 entries, 188 bytes as sensor_reg
+const uint8_t OV5642_RAW_Init_start_packed[148] = {
+    0x01, 0x31, 0x03, 0x03, 0x01, 0x30, 0x08, 0x82, 0x80, 0x0a, 0x42, 0x17, 0x7f, 0xfc, 0x01, 0x38,
+    0x10, 0xc2, 0x01, 0x36, 0x15, 0xf0, 0x04, 0x30, 0x00, 0x00, 0x00, 0x00, 0x00, 0x41, 0x11, 0x08,
+    0x41, 0x10, 0x30, 0x01, 0x36, 0x04, 0x60, 0x41, 0x22, 0x08, 0x41, 0x21, 0x17, 0x01, 0x37, 0x09,
+    0x00, 0x01, 0x40, 0x00, 0x21, 0x41, 0x1d, 0x02, 0x01, 0x36, 0x00, 0x54, 0x42, 0x05, 0x04, 0x3f,
+    0x01, 0x3c, 0x01, 0x80, 0x01, 0x30, 0x0d, 0x21, 0x01, 0x36, 0x23, 0x22, 0x01, 0x50, 0x00, 0xcf,
+    0x41, 0x20, 0x04, 0x02, 0x51, 0x81, 0x79, 0x00, 0x41, 0x85, 0x22, 0x41, 0x97, 0x01, 0x01, 0x55,
+    0x00, 0x0a, 0x42, 0x04, 0x00, 0x7f, 0x01, 0x50, 0x80, 0x08, 0x01, 0x30, 0x0e, 0x18, 0x01, 0x46,
+    0x10, 0x00, 0x01, 0x47, 0x1d, 0x05, 0x41, 0x08, 0x06, 0x01, 0x37, 0x10, 0x10, 0x41, 0x0d, 0x06,
+    0x01, 0x36, 0x32, 0x41, 0x01, 0x37, 0x02, 0x40, 0x01, 0x36, 0x20, 0x37, 0x41, 0x31, 0x01, 0x01,
+    0x37, 0x0c, 0xa0, 0x00,
+};
+
+// 61 entries, 248 bytes as sensor_reg
+const uint8_t OV5642_RAW_Init_finish_packed[153] = {
+    0x04, 0x38, 0x0c, 0x0c, 0x80, 0x07, 0xd0, 0x01, 0x50, 0x00, 0x06, 0x41, 0x1f, 0x03, 0x01, 0x35,
+    0x03, 0x07, 0x42, 0x01, 0x73, 0x80, 0x41, 0x0b, 0x00, 0x01, 0x38, 0x01, 0x8a, 0x01, 0x3a, 0x00,
+    0x78, 0x41, 0x1a, 0x04, 0x41, 0x13, 0x30, 0x42, 0x18, 0x00, 0x7c, 0x44, 0x08, 0x12, 0xc0, 0x0f,
+    0xa0, 0x01, 0x30, 0x04, 0xff, 0x02, 0x35, 0x0c, 0x07, 0xd0, 0x02, 0x3a, 0x0d, 0x08, 0x06, 0x03,
+    0x35, 0x00, 0x00, 0x00, 0x00, 0x42, 0x0a, 0x00, 0x00, 0x41, 0x03, 0x00, 0x01, 0x30, 0x30, 0x2b,
+    0x03, 0x3a, 0x02, 0x00, 0x7d, 0x00, 0x43, 0x14, 0x00, 0x7d, 0x00, 0x41, 0x00, 0x78, 0x44, 0x08,
+    0x09, 0x60, 0x07, 0xd0, 0x42, 0x0d, 0x10, 0x0d, 0x01, 0x36, 0x20, 0x57, 0x02, 0x37, 0x03, 0x98,
+    0x1c, 0x01, 0x58, 0x9b, 0x00, 0x41, 0x9a, 0xc0, 0x01, 0x36, 0x33, 0x07, 0x03, 0x37, 0x02, 0x10,
+    0xb2, 0x18, 0x41, 0x0b, 0x40, 0x41, 0x0d, 0x02, 0x01, 0x36, 0x20, 0x52, 0x02, 0x50, 0x00, 0x06,
+    0x01, 0x41, 0x05, 0x00, 0x01, 0x38, 0x01, 0xb4, 0x00,
+};
+
+// 1664 bytes, 3604 as sensor_reg
+
+#endif /* OV5642_REGS_PACKED_H */
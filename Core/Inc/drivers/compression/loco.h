@@ -0,0 +1,68 @@
+/*
+ * loco.h
+ *
+ * Lossless predictive coder for RAW captures, after LOCO-I (JPEG-LS). Each
+ * byte is predicted from its left, upper and upper left neighbours of the
+ * same colour with the MED predictor, and the prediction error is Golomb-
+ * Rice coded with a parameter adapted per context. Contexts are the local
+ * gradient and the colour. Only shifts and adds, no multiplies or divides.
+ *
+ * Works a chunk at a time over a ring of the last one or two lines. The
+ * stream starts with a header: 'L', 'I', the layout and the line length in
+ * bytes (big endian), and is padded to a byte with 1 bits at the end.
+ */
+#ifndef INC_DRIVERS_COMPRESSION_LOCO_H_
+#define INC_DRIVERS_COMPRESSION_LOCO_H_
+
+#include <stdint.h>
+
+#define LOCO_HISTORY 2568  // ring of previous bytes, two 1280 byte Bayer lines or one 1280 pixel YUV line
+#define LOCO_OUT_SIZE 64   // output block handed to the sink
+#define LOCO_HEADER_SIZE 5
+#define LOCO_CONTEXTS 32   // 4 colours by 8 gradient classes
+
+typedef enum {
+    LOCO_BAYER8,  // ISP RAW, one byte a pixel, colours repeat every 2 bytes and 2 lines
+    LOCO_YUV422,  // YUYV, Y every 2 bytes, U and V every 4, one line apart
+} loco_layout_t;
+
+/*
+ * Receives the next bytes of output, returns < 0 to stop the coder
+ */
+typedef int (*loco_sink_t)(const uint8_t *data, uint32_t len, void *arg);
+
+typedef struct {
+    uint16_t a; // sum of error magnitudes
+    uint8_t n;  // samples seen, halved with a at LOCO_RESET
+} loco_context_t;
+
+typedef struct {
+    loco_sink_t sink;
+    void *arg;
+    uint8_t layout;
+    uint16_t line;            // bytes a line
+    uint16_t size;            // bytes of the ring in use
+    uint16_t pos;             // ring index of the next byte
+    uint16_t x;               // byte within the line
+    uint8_t lines;            // lines done, saturates at 2
+    uint8_t odd;              // the line number is odd
+    uint32_t bits;            // bit accumulator
+    uint8_t nbits;            // bits waiting in it
+    uint8_t header;           // header bytes still to read, decoder only
+    loco_context_t contexts[LOCO_CONTEXTS];
+    uint8_t out[LOCO_OUT_SIZE];
+    uint8_t fill;
+    uint32_t in_bytes;
+    uint32_t out_bytes;
+    uint8_t ring[LOCO_HISTORY];
+} loco_t;
+
+int loco_encoder_init(loco_t *l, loco_layout_t layout, uint16_t line, loco_sink_t sink, void *arg);
+int loco_encode(loco_t *l, const uint8_t *in, uint32_t len);
+int loco_encoder_finish(loco_t *l);
+
+void loco_decoder_init(loco_t *l, loco_sink_t sink, void *arg);
+int loco_decode(loco_t *l, const uint8_t *in, uint32_t len);
+int loco_decoder_finish(loco_t *l);
+
+#endif /* INC_DRIVERS_COMPRESSION_LOCO_H_ */
@@ -0,0 +1,67 @@
+/*
+ * rle_stream.h
+ *
+ * Streaming RLE coder for RAW captures. The codes are RLE_Compress's, but
+ * the input arrives a chunk at a time and the output leaves through a sink
+ * in small blocks, so no image sized buffer and no heap is needed.
+ *
+ * RLE_Compress picks its marker from a histogram of the whole input. The
+ * stream coder picks it from the last RLE_STREAM_WINDOW input bytes instead,
+ * and switches markers in band with an end code, the old marker followed by
+ * a long count of 0 (which RLE_Compress never writes), and the new marker:
+ *
+ *   marker codes... [marker 0x80 0x00 new_marker codes...]...
+ *
+ * The stream ends where the file does.
+ */
+#ifndef INC_DRIVERS_COMPRESSION_RLE_STREAM_H_
+#define INC_DRIVERS_COMPRESSION_RLE_STREAM_H_
+
+#include <stdint.h>
+
+#define RLE_STREAM_OUT_SIZE 64   // output block handed to the sink
+#define RLE_STREAM_WINDOW 2048   // input bytes between marker choices, a NAND page
+#define RLE_STREAM_MAX_RUN 32768 // longest run one code holds, as in RLE_Compress
+
+/*
+ * Receives the next bytes of output, returns < 0 to stop the coder. A
+ * decoder's sink returns > 0 to have the rest of a run held back.
+ */
+typedef int (*rle_sink_t)(const uint8_t *data, uint32_t len, void *arg);
+
+typedef struct {
+    rle_sink_t sink;
+    void *arg;
+    uint8_t started;         // a marker was written
+    uint8_t marker;
+    uint8_t symbol;          // byte of the pending run
+    uint16_t count;          // length of the pending run, 0 none
+    uint16_t window;         // input bytes counted in histogram
+    uint8_t histogram[256];  // saturating counts of the window
+    uint8_t out[RLE_STREAM_OUT_SIZE];
+    uint8_t fill;            // bytes waiting in out
+    uint32_t in_bytes;
+    uint32_t out_bytes;
+} rle_stream_t;
+
+typedef struct {
+    rle_sink_t sink;
+    void *arg;
+    uint8_t state;  // where in a code the last byte left off
+    uint8_t marker;
+    uint16_t count; // run length being decoded, or left of a held run
+    uint8_t symbol; // byte of a held run
+    uint8_t out[RLE_STREAM_OUT_SIZE];
+    uint8_t fill;
+    uint32_t out_bytes;
+} rle_decoder_t;
+
+void rle_stream_init(rle_stream_t *s, rle_sink_t sink, void *arg);
+int rle_stream_feed(rle_stream_t *s, const uint8_t *in, uint32_t len);
+int rle_stream_finish(rle_stream_t *s);
+
+void rle_decoder_init(rle_decoder_t *d, rle_sink_t sink, void *arg);
+int rle_decoder_feed(rle_decoder_t *d, const uint8_t *in, uint32_t len);
+int rle_decoder_finish(rle_decoder_t *d);
+
+#endif /* INC_DRIVERS_COMPRESSION_RLE_STREAM_H_ */
@@ -0,0 +1,57 @@
+/*
+ * sccb_table.h
+ *
+ * Register table loader for the OV5642. Runs of consecutive register
+ * addresses in a table go out as one auto-increment SCCB write, REG_DELAY
+ * entries wait only where the sensor needs to settle, and several sensors
+ * can be loaded from the same table with their writes interleaved so they
+ * share every delay. Tables are either sensor_reg arrays or the run encoded
+ * byte streams described below, which take a fraction of the flash.
+ *
+ * Every value written is kept in a per-sensor shadow, so registers that
+ * already hold the value are not written again and reads of them need no
+ * bus traffic.
+ */
+#ifndef INC_DRIVERS_I2C_SCCB_TABLE_H_
+#define INC_DRIVERS_I2C_SCCB_TABLE_H_
+
+#include "stm32l0xx_hal.h"
+#include "arducam.h"
+
+#define SCCB_BURST_MAX 32   // data bytes in one auto-increment write
+#define SCCB_WRITE_TIMEOUT 100
+
+/*
+ * Run encoded tables, as generated by host/ov5642_pack. A stream of
+ * records, each starting with an op byte:
+ *  - SCCB_PACKED_END ends the table
+ *  - 1..SCCB_PACKED_RUN_MAX: a run of that many consecutive registers,
+ *    the 16 bit start register (big endian) and one value per register
+ *  - SCCB_PACKED_PAGE | count: a run starting in the same 256 register page
+ *    as the previous run, only the low byte of the start register follows
+ *  - SCCB_PACKED_DELAY | ms[14:8], ms[7:0]: wait ms like a REG_DELAY entry
+ */
+#define SCCB_PACKED_END 0x00
+#define SCCB_PACKED_RUN_MAX 0x3f
+#define SCCB_PACKED_PAGE 0x40
+#define SCCB_PACKED_DELAY 0x80
+#define SCCB_PACKED_DELAY_MAX 0x7fff
+
+#define SCCB_SHADOW_SENSORS 2
+#define SCCB_SHADOW_SLOTS 128 // per sensor, direct mapped, power of 2
+
+typedef struct {
+    uint16_t writes;  // I2C writes issued
+    uint16_t skipped; // registers the shadow already held
+    uint16_t failed;  // writes the sensor did not acknowledge
+} sccb_stats_t;
+
+int sccb_write_table(I2C_HandleTypeDef *hi2c, const struct sensor_reg reglist[], const uint8_t *sensors, int count,
+                     sccb_stats_t *stats);
+int sccb_write_packed(I2C_HandleTypeDef *hi2c, const uint8_t *packed, const uint8_t *sensors, int count,
+                      sccb_stats_t *stats);
+int sccb_write_reg(I2C_HandleTypeDef *hi2c, uint8_t sensor, uint16_t reg, uint8_t val);
+int sccb_read_reg(I2C_HandleTypeDef *hi2c, uint8_t sensor, uint16_t reg, uint8_t *val);
+void sccb_shadow_invalidate(uint8_t sensor);
+
+#endif /* INC_DRIVERS_I2C_SCCB_TABLE_H_ */
@@ -85,6 +85,7 @@ typedef struct {
 
 #define BAD_BLOCK_BYTE PAGE_DATA_SIZE
 #define BAD_BLOCK_VALUE 0x00;
+#define BAD_BLOCK_TABLE_SIZE (NUM_BLOCKS / 8) /* One bit per block, set if bad */
 
 /*
 Page data only:
@@ -310,14 +311,30 @@ NAND_ReturnType NAND_Set_Features(RegisterAddr reg_addr, uint8_t reg);
 
 /* read operations */
 NAND_ReturnType NAND_Page_Read(PhysicalAddrs *addr, uint16_t length, uint8_t *buffer);
-// NAND_ReturnType NAND_Spare_Read(PhysicalAddrs *addr, uint8_t *buffer);
+NAND_ReturnType NAND_Page_Read_Sequential(PhysicalAddrs *addr, PhysicalAddrs *next, uint16_t length,
+                                          uint8_t *buffer);
+NAND_ReturnType NAND_Spare_Read(PhysicalAddrs *addr, uint16_t offset, uint16_t length, uint8_t *buffer);
+NAND_ReturnType NAND_Spare_Read_Cache(PhysicalAddrs *addr, uint16_t offset, uint16_t length, uint8_t *buffer);
 
 NAND_ReturnType NAND_Cache_Read(uint16_t, uint16_t length, uint8_t *buffer);
 NAND_ReturnType NAND_Page_Load(uint32_t paddr);
 
 /* write operations */
 NAND_ReturnType NAND_Page_Program(PhysicalAddrs *addr, uint16_t length, uint8_t *buffer);
-// NAND_ReturnType NAND_Spare_Program(PhysicalAddrs *addrs, uint8_t *buffer);
+NAND_ReturnType NAND_Page_Program_Spare(PhysicalAddrs *addr, uint16_t length, uint8_t *buffer, uint16_t spare_offset,
+                                        uint16_t spare_length, uint8_t *spare);
+
+/* asynchronous operations, the page data moves on DMA */
+NAND_ReturnType NAND_Page_Read_Async(PhysicalAddrs *addr, uint16_t length, uint8_t *buffer, NAND_SPI_Callback done,
+                                     void *arg);
+NAND_ReturnType NAND_Page_Program_Async(PhysicalAddrs *addr, uint16_t length, uint8_t *buffer,
+                                        NAND_SPI_Callback done, void *arg);
+NAND_ReturnType NAND_Page_Program_Spare_Async(PhysicalAddrs *addr, uint16_t length, uint8_t *buffer,
+                                              uint16_t spare_offset, uint16_t spare_length, uint8_t *spare,
+                                              NAND_SPI_Callback done, void *arg);
+bool NAND_Async_Busy(void);
+bool NAND_Async_Execute(void);
+NAND_ReturnType NAND_Async_Complete(void);
 
 /* erase operation */
 NAND_ReturnType NAND_Block_Erase(PhysicalAddrs *addr);
@@ -327,6 +344,11 @@ bool NAND_is_Bad_Block(int block);
 
 NAND_ReturnType NAND_Mark_Bad_Block(int block);
 
+NAND_ReturnType NAND_Build_Bad_Block_Table(void);
+void NAND_Load_Bad_Block_Table(const uint8_t *table);
+const uint8_t *NAND_Get_Bad_Block_Table(void);
+uint16_t NAND_Bad_Block_Count(void);
+
 NAND_ReturnType NAND_Copy_Block(PhysicalAddrs *src, PhysicalAddrs *dst);
 
 /* internal data move operations */
@@ -24,6 +24,7 @@
  */
 
 #include "stm32l0xx_hal.h"
+#include <stdbool.h>
 
 /******************************************************************************
  *          For reference only: NAND SPI HARDWARE SETTINGS
@@ -45,6 +46,7 @@
 
 #define DUMMY_BYTE 0x00
 #define NAND_SPI_TIMEOUT 1000 /* max time for a transaction. nCS pulls high after */
+#define NAND_SPI_DMA_MIN 16   /* shorter data phases are sent by polling */
 
 /* using custom return type to keep higher layers as platform-agnostic as possible */
 typedef enum { SPI_OK, SPI_Fail } NAND_SPI_ReturnType;
@@ -55,6 +57,9 @@ typedef struct {
     uint16_t length;
 } SPI_Params;
 
+/* Called from the DMA interrupt when an asynchronous transaction ends, with nCS already high */
+typedef void (*NAND_SPI_Callback)(NAND_SPI_ReturnType status, void *arg);
+
 /******************************************************************************
  *                              Internal Functions
  *****************************************************************************/
@@ -77,4 +82,12 @@ NAND_SPI_ReturnType NAND_SPI_Receive(SPI_Params *data_recv);
 
 NAND_SPI_ReturnType NAND_SPI_Send_Command_Data(SPI_Params *cmd_send, SPI_Params *data_send);
 
+/* Asynchronous versions, the data phase runs on DMA */
+NAND_SPI_ReturnType NAND_SPI_SendReceive_DMA(SPI_Params *data_send, SPI_Params *data_recv, NAND_SPI_Callback done,
+                                             void *arg);
+NAND_SPI_ReturnType NAND_SPI_Send_Command_Data_DMA(SPI_Params *cmd_send, SPI_Params *data_send,
+                                                   NAND_SPI_Callback done, void *arg);
+bool NAND_SPI_Busy(void);
+NAND_SPI_ReturnType NAND_SPI_Wait_DMA(void);
+
 /******************************************************************************/
@@ -49,16 +49,35 @@
 
 #define SPI_DELAY 1 // 32mhz clock / 1 prescaler = 32 per microsecond
 
+#define SPI_BURST_MAX_HZ 8000000 // fastest clock the Arducam SPI slave takes
+#define SPI_BURST_MIN_HALF_CYCLES ((SystemCoreClock + 2 * SPI_BURST_MAX_HZ - 1) / (2 * SPI_BURST_MAX_HZ))
+#define SPI_REG_HALF_CYCLES 32 // default register access half period, 1 us at 32 MHz
+
+/*
+ * Clock timing of one sensor, as SYSCLK cycles per clock half period. Burst
+ * FIFO reads and register accesses are timed separately, a burst half period
+ * of 0 runs the FIFO reads as fast as SPI_BURST_MAX_HZ allows. Both start at
+ * SPI_REG_HALF_CYCLES.
+ */
+typedef struct {
+    uint16_t reg_half_cycles;
+    uint16_t burst_half_cycles;
+} spi_timing_t;
+
 void _CS1_LOW();
 void _CS1_HIGH();
 void _CS2_LOW();
 void _CS2_HIGH();
 
 uint8_t read_spi_reg(uint8_t addr, uint8_t sensor);
+uint8_t read_spi_reg_burst(uint8_t addr, uint8_t sensor);
 bool write_spi_reg(uint8_t addr, uint8_t packet, uint8_t sensor);
 void spi_read_multiple_bytes(uint8_t addr, uint32_t length, uint8_t sensor);
 void delay_us(uint16_t us);
 uint8_t spi_read_burst(uint8_t sensor);
+void spi_read_burst_buf(uint8_t sensor, uint8_t *buf, uint32_t len);
+void spi_set_timing(uint8_t sensor, const spi_timing_t *timing);
+void spi_get_timing(uint8_t sensor, spi_timing_t *timing);
 void spi_init_burst(uint8_t sensor);
 void spi_deinit_burst(uint8_t sensor);
 uint8_t bit_read(uint8_t byte, int j);
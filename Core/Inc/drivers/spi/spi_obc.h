@@ -10,7 +10,14 @@
 
 #include <iris_system.h>
 
+#define OBC_BLOCK_CRC_SIZE 4         // CRC-32 sent after every response and transfer block
+#define OBC_CRC_CHUNK_SIZE 64        // Bytes fed to the CRC unit at a time while the block goes out
+#define OBC_BLOCK_RETRIES 3          // Resends of a transfer block the OBC doesn't ack
+#define OBC_BLOCK_REPLY_TIMEOUT 1000 // ms to wait for the OBC's reply to a transfer block
+
 HAL_StatusTypeDef obc_spi_transmit(uint8_t *tx_data, uint16_t data_length);
+HAL_StatusTypeDef obc_spi_transmit_block(uint8_t *tx_data, uint16_t data_length);
+HAL_StatusTypeDef obc_spi_transfer_block(uint8_t *tx_data, uint16_t data_length);
 HAL_StatusTypeDef obc_spi_receive(uint8_t *rx_data, uint16_t data_length);
 HAL_StatusTypeDef obc_spi_receive_blocking(uint8_t *rx_data, uint16_t data_length);
 void obc_enable_spi_rx();
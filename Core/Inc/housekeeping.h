@@ -20,6 +20,16 @@ typedef struct __attribute__((__packed__)) housekeeping_packet_s {
     uint16_t MAX_3V_power;
     uint16_t MIN_5V_voltage;
     uint16_t MIN_3V_voltage;
+    uint16_t mount_time_ms;
+    uint16_t erase_pool_hits;
+    uint16_t erase_pool_misses;
+    uint16_t erase_stall_ms;
+    uint8_t vis_spi_reg_half;
+    uint8_t vis_spi_burst_half;
+    uint8_t nir_spi_reg_half;
+    uint8_t nir_spi_burst_half;
+    uint16_t vis_capture_ms;
+    uint16_t nir_capture_ms;
 
 } housekeeping_packet_t;
 
@@ -13,9 +13,15 @@
 
 /* Iris commands */
 #define IRIS_TAKE_PIC 0x10
+#define IRIS_TAKE_BURST 0x11
 #define IRIS_GET_IMAGE_LENGTH 0x20
 #define IRIS_TRANSFER_IMAGE 0x31
+#define IRIS_GET_THUMBNAILS 0x32
+#define IRIS_TRANSFER_THUMBNAIL 0x33
 #define IRIS_TRANSFER_LOG 0x34
+#define IRIS_LIST_IMAGES 0x35
+#define IRIS_TRANSFER_WINDOW 0x36
+#define IRIS_DELETE_IMAGE 0x37
 #define IRIS_GET_IMAGE_COUNT 0x30
 #define IRIS_ON_SENSORS 0x40
 #define IRIS_OFF_SENSORS 0x41
@@ -25,19 +31,27 @@
 #define IRIS_SET_TIME 0x05
 #define IRIS_WDT_CHECK 0x80
 #define IRIS_UPDATE_CONFIG 0x90
+#define IRIS_SET_THUMBNAILS 0x91
 
 #define IRIS_IMAGE_TRANSFER_BLOCK_SIZE 512 // Will change once NAND flash is implemented
 #define IRIS_LOG_TRANSFER_BLOCK_SIZE 2048
 #define IRIS_IMAGE_SIZE_WIDTH 3 // Image size represented in 3 bytes
 #define IRIS_UNIX_TIME_SIZE 4
-#define IRIS_NUM_COMMANDS 13
+#define IRIS_NUM_COMMANDS 20
 #define IRIS_CONFIG_SIZE 6 // Number of bytes in below struct
+#define IRIS_THUMBNAIL_LIST_SIZE (1 + MAX_IMAGE_FILES * IRIS_IMAGE_SIZE_WIDTH) // count, then sizes
+#define IRIS_FILE_ID_SIZE 4
+#define IRIS_IMAGE_ENTRY_SIZE (2 * (IRIS_FILE_ID_SIZE + IRIS_IMAGE_SIZE_WIDTH)) // image id and size, thumbnail's
+#define IRIS_IMAGE_LIST_SIZE (1 + MAX_IMAGE_FILES * IRIS_IMAGE_ENTRY_SIZE)     // count, then entries
+#define IRIS_WINDOW_REQUEST_SIZE (IRIS_FILE_ID_SIZE + 4 + 4)                   // file id, byte offset, length
 
 int obc_verify_command(uint8_t cmd);
 int obc_handle_command(uint8_t cmd);
 
-void transfer_image_to_obc_direct_method();
+int transfer_image_to_obc_direct_method();
 int transfer_images_to_obc_nand_method(uint8_t image_index);
+int transfer_thumbnail_to_obc(uint8_t image_index);
+int transfer_window_to_obc(uint32_t file_id, uint32_t offset, uint32_t length);
 int transfer_log_to_obc();
 
 #endif /* INC_OBC_HANDLER_H_ */
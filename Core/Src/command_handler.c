@@ -14,6 +14,8 @@
 #include "iris_time.h"
 #include "time.h"
 #include "nandfs.h"
+#include "jpeg_framer.h"
+#include "sccb_table.h"
 #include "nand_types.h"
 #include "iris_system.h"
 #include "nand_errno.h"
@@ -33,6 +35,7 @@ extern const struct sensor_reg OV5642_QVGA_Preview[];
 
 extern uint8_t turn_off_logger_flag;
 extern uint8_t direct_method_flag;
+extern uint8_t thumbnail_flag;
 
 #ifdef UART_HANDLER
 // Only used for UART operations
@@ -57,13 +60,51 @@ uint8_t image_count = 0;
  */
 void get_housekeeping(housekeeping_packet_t *hk) { *(hk) = _get_housekeeping(); }
 
-/**
- * @brief Initialize appropriate sensors' registers and start capture
+#define CAPTURE_POLL_MIN_MS 1   // first CAP_DONE poll interval
+#define CAPTURE_POLL_MAX_MS 16  // poll interval doubles up to this
+#define CAPTURE_TIMEOUT_MS 5000 // a sensor not done by then is given up on
+#define CAPTURE_FRAME_MS 1000   // added to the timeout for every further frame of a burst
+
+typedef enum { CAPTURE_EXPOSING, CAPTURE_DONE, CAPTURE_FAILED } capture_state_t;
+
+typedef struct {
+    uint8_t sensor;
+    uint8_t *timestamp;
+    int thumb_of; // queue index of the image this is the thumbnail of, -1 for none
+    capture_state_t state;
+    uint32_t poll_at;  // HAL_GetTick of the next CAP_DONE poll
+    uint32_t interval; // current poll interval
+} capture_t;
+
+static uint16_t capture_latency_ms[2]; // trigger to CAP_DONE of the last capture, VIS then NIR
+static uint32_t burst_id;              // id of the last burst, in the inodes of its files
+static Iris_Timestamp burst_time;      // trigger time of the last burst
+static int stored_index[2] = {-1, -1}; // queue index of the last single image of each sensor, -1 for none
+
+static int transfer_burst_to_nand(uint8_t sensor, uint8_t frames);
+static int transfer_thumbnail_to_nand(uint8_t sensor, uint8_t index);
+
+/*
+ * Captures frames back to back on both sensors and stores them, a single
+ * frame under the name given for its sensor, if any, or as the thumbnail of
+ * the queued image given in thumb_of. Each sensor's CAP_DONE is polled on
+ * its own, backing off while it exposes, and its FIFO is drained as soon as
+ * it is done while the other keeps exposing.
  */
-void take_image() {
+static int _capture(uint8_t frames, uint8_t *vis_timestamp, uint8_t *nir_timestamp, const int *thumb_of) {
+    capture_t captures[2] = {
+        {.sensor = VIS_SENSOR, .timestamp = vis_timestamp, .thumb_of = thumb_of ? thumb_of[0] : -1},
+        {.sensor = NIR_SENSOR, .timestamp = nir_timestamp, .thumb_of = thumb_of ? thumb_of[1] : -1}};
+    uint32_t timeout = CAPTURE_TIMEOUT_MS + (frames - 1) * CAPTURE_FRAME_MS;
+    int pending = 2;
+    int ret = 0;
+
     write_reg(ARDUCHIP_TIM, VSYNC_LEVEL_MASK, VIS_SENSOR); // VSYNC is active HIGH
     write_reg(ARDUCHIP_TIM, VSYNC_LEVEL_MASK, NIR_SENSOR);
 
+    write_reg(ARDUCHIP_FRAMES, frames - 1, VIS_SENSOR);
+    write_reg(ARDUCHIP_FRAMES, frames - 1, NIR_SENSOR);
+
     flush_fifo(VIS_SENSOR);
     flush_fifo(NIR_SENSOR);
 
@@ -73,9 +114,153 @@ void take_image() {
     start_capture(VIS_SENSOR);
     start_capture(NIR_SENSOR);
 
-    while (!get_bit(ARDUCHIP_TRIG, CAP_DONE_MASK, VIS_SENSOR) &&
-           !get_bit(ARDUCHIP_TRIG, CAP_DONE_MASK, NIR_SENSOR)) {
+    uint32_t start = HAL_GetTick();
+    for (int i = 0; i < 2; i++) {
+        captures[i].state = CAPTURE_EXPOSING;
+        captures[i].poll_at = start;
+        captures[i].interval = CAPTURE_POLL_MIN_MS;
     }
+
+    while (pending > 0) {
+        for (int i = 0; i < 2; i++) {
+            capture_t *capture = &captures[i];
+            uint32_t now = HAL_GetTick();
+
+            if (capture->state != CAPTURE_EXPOSING || (int32_t)(now - capture->poll_at) < 0) {
+                continue;
+            }
+            if (get_bit(ARDUCHIP_TRIG, CAP_DONE_MASK, capture->sensor)) {
+                uint32_t latency = now - start;
+                capture_latency_ms[i] = (latency > 0xffff) ? 0xffff : latency;
+                iris_log("Camera %x: capture done in %d ms", capture->sensor, latency);
+                capture->state = CAPTURE_DONE;
+                pending--;
+                if (frames > 1) {
+                    ret |= transfer_burst_to_nand(capture->sensor, frames);
+                } else if (capture->thumb_of >= 0) {
+                    ret |= transfer_thumbnail_to_nand(capture->sensor, capture->thumb_of);
+                } else if (capture->timestamp && transfer_image_to_nand(capture->sensor, capture->timestamp) == 0) {
+                    stored_index[i] = image_count - 1;
+                } else if (capture->timestamp) {
+                    ret = -1;
+                }
+            } else if (now - start >= timeout) {
+                iris_log("Camera %x: capture timed out", capture->sensor);
+                capture_latency_ms[i] = 0xffff;
+                capture->state = CAPTURE_FAILED;
+                pending--;
+                ret = -1;
+            } else {
+                capture->poll_at = now + capture->interval;
+                if (capture->interval < CAPTURE_POLL_MAX_MS) {
+                    capture->interval *= 2;
+                }
+            }
+        }
+    }
+
+    if (frames > 1) {
+        write_reg(ARDUCHIP_FRAMES, 0, VIS_SENSOR);
+        write_reg(ARDUCHIP_FRAMES, 0, NIR_SENSOR);
+    }
+    return ret;
+}
+
+/**
+ * @brief Initialize appropriate sensors' registers, capture on both and
+ * 		  store the images
+ *
+ * A FIFO is only drained once its sensor is done, the other sensor keeps
+ * exposing meanwhile. The latency logged and kept for housekeeping is when
+ * the poll saw CAP_DONE, which for the second sensor can include the first
+ * one's transfer.
+ *
+ * @param vis_timestamp: File name of the VIS image, NULL to leave it in the FIFO
+ * @param nir_timestamp: File name of the NIR image, NULL to leave it in the FIFO
+ * @return 0 on success, -1 if a sensor timed out or an image was not stored
+ */
+int take_image(uint8_t *vis_timestamp, uint8_t *nir_timestamp) {
+    stored_index[0] = -1;
+    stored_index[1] = -1;
+    return _capture(1, vis_timestamp, nir_timestamp, NULL);
+}
+
+/**
+ * @brief Captures and stores a THUMBNAIL_WIDTH thumbnail of the images the
+ * 		  last take_image stored
+ *
+ * Both sensors are switched to the thumbnail window and back to their own
+ * resolutions. The register shadow keeps both switches to the registers the
+ * two windows differ in. A thumbnail is stored with its image's name, linked
+ * to the image, and the OBC can fetch it before deciding to download the
+ * image.
+ *
+ * @return 0 on success, -1 if there was no image or a thumbnail was not stored
+ */
+int take_thumbnails() {
+    const uint8_t sensors[] = {VIS_SENSOR, NIR_SENSOR};
+    int width[2], depth;
+    int ret = -1;
+
+    if (stored_index[0] < 0 && stored_index[1] < 0) {
+        iris_log("No image to take a thumbnail of");
+        return -1;
+    }
+    // The sensors can be at different resolutions
+    for (int i = 0; i < 2; i++) {
+        arducam_get_resolution(&width[i], &depth, sensors[i]);
+    }
+    if (arducam_set_resolutions(JPEG, THUMBNAIL_WIDTH, sensors, 2) != 0) {
+        ret = _capture(1, NULL, NULL, stored_index);
+    }
+    if (width[0] == width[1]) {
+        arducam_set_resolutions(JPEG, width[0], sensors, 2); // both settle at once
+    } else {
+        for (int i = 0; i < 2; i++) {
+            arducam_set_resolutions(JPEG, width[i], &sensors[i], 1);
+        }
+    }
+
+    stored_index[0] = -1;
+    stored_index[1] = -1;
+    return ret;
+}
+
+/**
+ * @brief Captures a burst of frames back to back on both sensors and stores
+ * 		  every frame as its own file
+ *
+ * The Arducam captures the frames into its FIFO on a single trigger, so the
+ * frames are only a frame time apart instead of a full capture and transfer.
+ * The files of a burst record the burst id in their inodes, and ids keep
+ * counting up across reboots. Their names, logged as each is stored, are the
+ * trigger time, the burst id in hex, the frame number and the sensor, like
+ * 12_30_5_17_10_2026_b1a0_vis.jpg for frame 0 of burst 0x1a.
+ *
+ * @param frames: Frames per sensor, clamped to 1..BURST_FRAMES_MAX
+ * @return 0 on success, -1 if a sensor timed out or a frame was not stored
+ */
+int take_burst(uint8_t frames) {
+    if (frames < 1) {
+        frames = 1;
+    } else if (frames > BURST_FRAMES_MAX) {
+        frames = BURST_FRAMES_MAX;
+    }
+    burst_id++;
+    get_rtc_time(&burst_time);
+    iris_log("Burst %x: %d frames per sensor", burst_id, frames);
+    return _capture(frames, NULL, NULL, NULL);
+}
+
+/**
+ * @brief Get the capture latency of the last take_image
+ *
+ * @param vis_ms: Trigger to CAP_DONE of the VIS sensor, 0xffff if it timed out
+ * @param nir_ms: Trigger to CAP_DONE of the NIR sensor, 0xffff if it timed out
+ */
+void get_capture_latency(uint16_t *vis_ms, uint16_t *nir_ms) {
+    *(vis_ms) = capture_latency_ms[0];
+    *(nir_ms) = capture_latency_ms[1];
 }
 
 /**
@@ -114,11 +299,23 @@ int get_image_length(uint32_t *image_length, uint8_t index) {
     return 0;
 }
 
+/**
+ * @brief Get the length of a queued image's thumbnail
+ *
+ * @param thumb_length: Pointer to variable containing length of thumbnail, 0 if the image has none
+ * @param index: Queue index of the image
+ */
+void get_thumbnail_length(uint32_t *thumb_length, uint8_t index) {
+    *(thumb_length) = image_file_infos_queue[index].thumb_id ? image_file_infos_queue[index].thumb_size : 0;
+}
+
 /**
  * @brief Sends Arducam sensors into an idle (re: powered off) state by turning off FET driver pin
  */
 void turn_off_sensors() {
     HAL_GPIO_WritePin(CAM_EN_GPIO_Port, CAM_EN_Pin, GPIO_PIN_RESET);
+    sccb_shadow_invalidate(VIS_SENSOR);
+    sccb_shadow_invalidate(NIR_SENSOR);
     iris_log("Sensor Power Disabled.\r\n");
     sensor_status = SENSORS_OFF;
 }
@@ -151,15 +348,13 @@ void set_configurations(Iris_config *config) {
 
     if (sensor_status == SENSORS_ON) {
         // Set resolution for both sensors
-        arducam_set_resolution(JPEG, (int)config->set_resolution, VIS_SENSOR);
-        arducam_set_resolution(JPEG, (int)config->set_resolution, NIR_SENSOR);
+        const uint8_t sensors[] = {VIS_SENSOR, NIR_SENSOR};
+        arducam_set_resolutions(JPEG, (int)config->set_resolution, sensors, 2);
 
         // Set saturation for both sensors
         arducam_set_saturation((int)config->set_saturation, VIS_SENSOR);
         arducam_set_saturation((int)config->set_saturation, NIR_SENSOR);
     }
-
-    HAL_Delay(500);
 }
 
 /**
@@ -176,16 +371,10 @@ void flood_cam_spi() {
  * @brief Initializes sensors to our chosen defaults as defined in main.c
  */
 int initalize_sensors() {
+    const uint8_t sensors[] = {VIS_SENSOR, NIR_SENSOR};
     int res;
 
     res = onboot_sensors(VIS_SENSOR);
-    if (res == 1) {
-        program_sensor(format, VIS_SENSOR);
-        iris_log("VIS Camera Mode: JPEG\r\nI2C address: 0x3C");
-#ifdef UART_HANDLER
-        VIS_DETECTED = 1;
-#endif
-    }
     if (res == -1) {
         // need some error handling eh
         iterate_error_num();
@@ -194,23 +383,22 @@ int initalize_sensors() {
     }
 
     res = onboot_sensors(NIR_SENSOR);
-    if (res == 1) {
-        program_sensor(format, NIR_SENSOR);
-        iris_log("NIR Camera Mode: JPEG\r\nI2C address: 0x3D");
-#ifdef UART_HANDLER
-        NIR_DETECTED = 1;
-#endif
-    } else {
-        iris_log("NIR initialization failed.");
-        return -1;
-    }
-    if (res == -1) {
+    if (res != 1) {
         // need some error handling eh
         iterate_error_num();
         iris_log("NIR init failed.");
         return -1;
     }
 
+    // Both sensors answered, load their register tables together
+    program_sensors(format, sensors, 2);
+    iris_log("VIS Camera Mode: JPEG\r\nI2C address: 0x3C");
+    iris_log("NIR Camera Mode: JPEG\r\nI2C address: 0x3D");
+#ifdef UART_HANDLER
+    VIS_DETECTED = 1;
+    NIR_DETECTED = 1;
+#endif
+
     HAL_Delay(100);
     return 0;
 }
@@ -225,7 +413,16 @@ int onboot_sensors(uint8_t sensor) {
 
     // Make sure camera is listening over SPI
     arducam_wait_for_ready(sensor);
+    // Find the fastest FIFO clock, ahead of the reset that clears any garbled test writes
+    spi_timing_t timing;
+    if (arducam_calibrate_spi(sensor)) {
+        spi_get_timing(sensor, &timing);
+        iris_log("Camera %x: SPI burst half period %d cycles", sensor, timing.burst_half_cycles);
+    } else {
+        iris_log("Camera %x: SPI calibration failed", sensor);
+    }
     // reset I2C regs
+    sccb_shadow_invalidate(sensor);
     write_reg(AC_REG_RESET, 1, sensor);
     write_reg(AC_REG_RESET, 1, sensor);
     HAL_Delay(100);
@@ -316,9 +513,133 @@ void get_rtc_time(Iris_Timestamp *timestamp) {
 #endif
 }
 
-int transfer_image_to_nand(uint8_t sensor, uint8_t *file_timestamp) {
+/*
+ * Camera bytes are handed to NANDfs in chunks of this size. NANDfs collects
+ * them into its own page buffers and programs each page while the next one
+ * is read off the camera.
+ */
+#define CAMERA_CHUNK_SIZE 256
+
+static int _nand_sink(const uint8_t *data, uint32_t len, void *arg) {
+    return NANDfs_write((NAND_FILE *)arg, len, (void *)data);
+}
+
+/*
+ * Closes and deletes a file that is not kept. A file whose write failed is
+ * already gone, its close only releases the handle.
+ */
+static void _discard_file(NAND_FILE *file) {
+    uint32_t id = file->node.id;
+
+    if (NANDfs_close(file) == 0) {
+        NANDfs_delete(id);
+    }
+}
+
+/*
+ * Size of a closed file. A handle's size misses the page buffer and the end
+ * of a coded stream, which close writes.
+ */
+static uint32_t _stored_size(uint32_t id) {
+    uint32_t size = 0;
+    NAND_FILE *file = NANDfs_open(id);
+
+    if (file) {
+        size = file->node.file_size;
+        NANDfs_close(file);
+    }
+    return size;
+}
+
+/*
+ * Names a file holding a framed JPEG, queues it for the OBC and closes it
+ */
+static int _store_image_file(NAND_FILE *file, uint8_t *file_name) {
+    int ret;
+
+    if (image_count >= MAX_IMAGE_FILES) {
+        iris_log("image queue full, dropping file %d", file->node.id);
+        _discard_file(file);
+        return -1;
+    }
+    file->node.file_name = file_name;
+
+    image_file_infos_queue[image_count].file_id = file->node.id;
+    image_file_infos_queue[image_count].file_name = file->node.file_name;
+    image_file_infos_queue[image_count].thumb_id = 0;
+    image_file_infos_queue[image_count].thumb_size = 0;
+    image_file_infos_queue[image_count].burst = file->node.burst;
+
+    ret = NANDfs_close(file);
+    if (ret < 0) {
+        iris_log("not able to close file %d failed: %d", file, nand_errno);
+        return -1;
+    }
+    image_file_infos_queue[image_count].file_size = _stored_size(image_file_infos_queue[image_count].file_id);
+
+    if (file_name) {
+        iris_log("%d|%s|%d", image_file_infos_queue[image_count].file_id,
+                 image_file_infos_queue[image_count].file_name, image_file_infos_queue[image_count].file_size);
+    }
+
+    image_count += 1;
+    return 0;
+}
+
+/*
+ * Writes a RAW capture in the sensor's FIFO to a new file, coded by the file
+ * system as it is written, and returns it still open, NULL if it could not
+ * be written. Lines short enough for the LOCO coder's ring are LOCO coded,
+ * wider ones RLE coded.
+ */
+static NAND_FILE *_fifo_to_raw_file(uint8_t sensor) {
+    uint32_t image_size = read_fifo_length(sensor);
+    uint32_t size_remaining = image_size;
+    uint8_t image[CAMERA_CHUNK_SIZE];
+    int width, depth;
     int ret = 0;
-    HAL_Delay(100);
+
+    NAND_FILE *file = NANDfs_create();
+    if (!file) {
+        iris_log("not able to create file %d failed: %d", file, nand_errno);
+        return NULL;
+    }
+
+    arducam_get_resolution(&width, &depth, sensor);
+    if (NANDfs_set_codec(file, NAND_CODEC_LOCO_BAYER8, width) < 0 && NANDfs_set_codec(file, NAND_CODEC_RLE, 0) < 0) {
+        iris_log("Camera %x: storing RAW uncoded, codec failed: %d", sensor, nand_errno);
+    }
+
+    spi_init_burst(sensor);
+    while (size_remaining > 0 && ret == 0) {
+        uint32_t size_to_read = size_remaining > CAMERA_CHUNK_SIZE ? CAMERA_CHUNK_SIZE : size_remaining;
+        spi_read_burst_buf(sensor, image, size_to_read);
+        ret = NANDfs_write(file, size_to_read, image);
+        size_remaining -= size_to_read;
+    }
+    spi_deinit_burst(sensor);
+
+    if (ret < 0) {
+        iris_log("not able to write to file %d failed: %d", file, nand_errno);
+        _discard_file(file);
+        return NULL;
+    }
+    iris_log("Camera %x: RAW %d bytes, codec %d", sensor, image_size, file->node.codec);
+    return file;
+}
+
+/*
+ * Writes the JPEG in the sensor's FIFO to a new file and returns it still
+ * open, NULL if there was no JPEG or it could not be written. Only the bytes
+ * from SOI to EOI are stored, so the file size is the JPEG's, and the FIFO
+ * is not read past EOI. RAW captures are stored losslessly coded instead.
+ */
+static NAND_FILE *_fifo_to_file(uint8_t sensor) {
+    int ret = 0;
+
+    if (format == RAW) {
+        return _fifo_to_raw_file(sensor);
+    }
 
     uint32_t image_size;
     image_size = read_fifo_length(sensor);
@@ -326,50 +647,164 @@ int transfer_image_to_nand(uint8_t sensor, uint8_t *file_timestamp) {
     NAND_FILE *file = NANDfs_create();
     if (!file) {
         iris_log("not able to create file %d failed: %d", file, nand_errno);
-        return -1;
+        return NULL;
     }
 
-    int size_remaining;
-    uint8_t image[PAGE_DATA_SIZE];
-    uint32_t i = 0;
-    int chunks_to_write = ((image_size + (PAGE_DATA_SIZE - 1)) / PAGE_DATA_SIZE);
+    uint8_t image[CAMERA_CHUNK_SIZE];
+    uint32_t size_remaining = image_size;
+    jpeg_framer_t framer;
+    jpeg_framer_init(&framer);
 
     spi_init_burst(sensor);
-    for (int j = 0; j < chunks_to_write; j++) {
-        for (i = 0; i < PAGE_DATA_SIZE; i++) {
-            image[i] = spi_read_burst(sensor);
-        }
-        size_remaining = i;
-        while (size_remaining > 0) {
-            int size_to_write = size_remaining > PAGE_DATA_SIZE ? PAGE_DATA_SIZE : size_remaining;
-            ret = NANDfs_write(file, size_to_write, image);
-            if (ret < 0) {
-                iris_log("not able to write to file %d failed: %d", file, nand_errno);
-                return -1;
-            }
-            size_remaining -= size_to_write;
+    while (size_remaining > 0 && !jpeg_framer_done(&framer)) {
+        int size_to_write = size_remaining > CAMERA_CHUNK_SIZE ? CAMERA_CHUNK_SIZE : size_remaining;
+        spi_read_burst_buf(sensor, image, size_to_write);
+        ret = jpeg_framer_feed(&framer, image, size_to_write, _nand_sink, file);
+        if (ret < 0) {
+            spi_deinit_burst(sensor);
+            iris_log("not able to write to file %d failed: %d", file, nand_errno);
+            _discard_file(file);
+            return NULL;
         }
+        size_remaining -= size_to_write;
     }
     spi_deinit_burst(sensor);
-    file->node.file_name = file_timestamp;
 
-    image_file_infos_queue[image_count].file_id = file->node.id;
-    image_file_infos_queue[image_count].file_name = file->node.file_name;
-    image_file_infos_queue[image_count].file_size = file->node.file_size;
+    if (framer.state == JPEG_FRAMER_SEEK) {
+        iris_log("Camera %x: no JPEG in %d FIFO bytes", sensor, image_size);
+        _discard_file(file);
+        return NULL;
+    } else if (framer.state == JPEG_FRAMER_BODY) {
+        iris_log("Camera %x: JPEG has no EOI, storing %d bytes", sensor, framer.length);
+    }
+    return file;
+}
 
-    ret = NANDfs_close(file);
-    if (ret < 0) {
-        iris_log("not able to close file %d failed: %d", file, nand_errno);
+/*
+ * Stores the JPEG in the sensor's FIFO as a new file and queues it for the OBC
+ */
+int transfer_image_to_nand(uint8_t sensor, uint8_t *file_timestamp) {
+    NAND_FILE *file = _fifo_to_file(sensor);
+
+    if (!file) {
         return -1;
     }
+    return _store_image_file(file, file_timestamp);
+}
 
-    iris_log("%d|%s|%d", image_file_infos_queue[image_count].file_id,
-             image_file_infos_queue[image_count].file_name, image_file_infos_queue[image_count].file_size);
+/*
+ * Stores the JPEG in the sensor's FIFO as the thumbnail of a queued image.
+ * The file's inode links it to the image, so the link survives a reboot.
+ */
+static int transfer_thumbnail_to_nand(uint8_t sensor, uint8_t index) {
+    FileInfo_t *image = &image_file_infos_queue[index];
+    NAND_FILE *file = _fifo_to_file(sensor);
 
-    image_count += 1;
+    if (!file) {
+        return -1;
+    }
+    file->node.file_name = image->file_name;
+    file->node.parent = image->file_id;
+    image->thumb_id = file->node.id;
+
+    if (NANDfs_close(file) < 0) {
+        iris_log("not able to close file %d failed: %d", file, nand_errno);
+        image->thumb_id = 0;
+        return -1;
+    }
+    image->thumb_size = _stored_size(image->thumb_id);
+    iris_log("%d|thumbnail of %d|%d", image->thumb_id, image->file_id, image->thumb_size);
     return 0;
 }
 
+/*
+ * Names a frame of the last burst, set_capture_timestamp's name with the
+ * burst id and frame number added
+ */
+static void _burst_file_name(uint8_t *file_name, uint8_t sensor, uint8_t frame) {
+    snprintf(file_name, CAPTURE_TIMESTAMP_SIZE, "%d_%d_%d_%d_%d_%d_b%02x%d_%s.jpg", burst_time.Hour,
+             burst_time.Minute, burst_time.Second, burst_time.Day, burst_time.Month, burst_time.Year, burst_id, frame,
+             (sensor == VIS_SENSOR) ? "vis" : "nir");
+}
+
+/*
+ * Queues a frame of the last burst. Its inode records the burst, the name
+ * only goes to the log since nothing keeps the buffer.
+ */
+static int _store_burst_file(NAND_FILE *file, uint8_t sensor, uint8_t frame) {
+    uint8_t file_name[CAPTURE_TIMESTAMP_SIZE];
+    uint32_t id = file->node.id;
+    int ret;
+
+    file->node.burst = burst_id;
+    ret = _store_image_file(file, NULL);
+    if (ret == 0) {
+        _burst_file_name(file_name, sensor, frame);
+        iris_log("%d|%s|%d", id, file_name, image_file_infos_queue[image_count - 1].file_size);
+    }
+    return ret;
+}
+
+/*
+ * Stores the JPEGs of a burst in the sensor's FIFO, one file per frame. The
+ * FIFO is read once, a new framer starts where the last frame's EOI was,
+ * and the FIFO is not read past the last frame's EOI.
+ */
+static int transfer_burst_to_nand(uint8_t sensor, uint8_t frames) {
+    uint8_t image[CAMERA_CHUNK_SIZE];
+    uint32_t image_size = read_fifo_length(sensor);
+    uint32_t size_remaining = image_size;
+    NAND_FILE *file = NULL;
+    jpeg_framer_t framer;
+    uint8_t stored = 0;
+    int ret = 0;
+
+    spi_init_burst(sensor);
+    while (size_remaining > 0 && stored < frames && ret == 0) {
+        uint32_t size_to_read = size_remaining > CAMERA_CHUNK_SIZE ? CAMERA_CHUNK_SIZE : size_remaining;
+        uint32_t offset = 0;
+
+        spi_read_burst_buf(sensor, image, size_to_read);
+        size_remaining -= size_to_read;
+        while (offset < size_to_read && stored < frames) {
+            if (!file) {
+                file = NANDfs_create();
+                if (!file) {
+                    iris_log("not able to create file %d failed: %d", file, nand_errno);
+                    ret = -1;
+                    break;
+                }
+                jpeg_framer_init(&framer);
+            }
+            if (jpeg_framer_feed(&framer, image + offset, size_to_read - offset, _nand_sink, file) < 0) {
+                iris_log("not able to write to file %d failed: %d", file, nand_errno);
+                ret = -1;
+                break;
+            }
+            offset += framer.used;
+            if (jpeg_framer_done(&framer)) {
+                ret |= _store_burst_file(file, sensor, stored);
+                file = NULL;
+                stored++;
+            }
+        }
+    }
+    spi_deinit_burst(sensor);
+
+    if (file && framer.state == JPEG_FRAMER_BODY && ret == 0) {
+        iris_log("Camera %x: frame %d has no EOI, storing %d bytes", sensor, stored, framer.length);
+        ret = _store_burst_file(file, sensor, stored);
+        stored++;
+    } else if (file) {
+        _discard_file(file);
+    }
+    if (stored < frames) {
+        iris_log("Camera %x: %d of %d frames in %d FIFO bytes", sensor, stored, frames, image_size);
+        ret = -1;
+    }
+    return ret;
+}
+
 int delete_image_file_from_queue(uint16_t index) {
     int ret;
 
@@ -379,9 +814,73 @@ int delete_image_file_from_queue(uint16_t index) {
         return -1;
     }
     image_file_infos_queue[index].file_id = -1;
+
+    if (image_file_infos_queue[index].thumb_id != 0) {
+        ret = NANDfs_delete(image_file_infos_queue[index].thumb_id);
+        if (ret < 0) {
+            iris_log("not able to delete thumbnail %d failed: %d\r\n", image_file_infos_queue[index].thumb_id,
+                     nand_errno);
+            return -1;
+        }
+        image_file_infos_queue[index].thumb_id = 0;
+    }
     return 0;
 }
 
+/*
+ * Deletes the queued image with the given file id, and its thumbnail, once
+ * the OBC has acknowledged it. Only the live entries from first on are
+ * searched, and the later ones are moved up so the queue has no gap.
+ */
+int ack_image_file_in_queue(uint32_t file_id, uint8_t first) {
+    int index = -1;
+
+    for (uint8_t i = first; i < first + image_count && i < MAX_IMAGE_FILES; i++) {
+        if (image_file_infos_queue[i].file_id == file_id) {
+            index = i;
+            break;
+        }
+    }
+    if (index < 0) {
+        iris_log("file %d is not queued\r\n", file_id);
+        return -1;
+    }
+    if (delete_image_file_from_queue(index) < 0) {
+        return -1;
+    }
+
+    uint8_t last = first + image_count - 1;
+    memmove(&image_file_infos_queue[index], &image_file_infos_queue[index + 1],
+            (last - index) * sizeof(FileInfo_t));
+    memset(&image_file_infos_queue[last], 0, sizeof(FileInfo_t));
+    image_count -= 1;
+
+    // Keep the thumbnail links of the last captures on their images
+    for (int i = 0; i < 2; i++) {
+        if (stored_index[i] == index) {
+            stored_index[i] = -1;
+        } else if (stored_index[i] > index) {
+            stored_index[i] -= 1;
+        }
+    }
+    return 0;
+}
+
+/*
+ * Opens the thumbnail of a queued image, NULL if it has none
+ */
+NAND_FILE *get_thumbnail_file_from_queue(uint8_t index) {
+    if (image_file_infos_queue[index].thumb_id == 0) {
+        iris_log("image %d has no thumbnail\r\n", image_file_infos_queue[index].file_id);
+        return NULL;
+    }
+    NAND_FILE *file = NANDfs_open(image_file_infos_queue[index].thumb_id);
+    if (!file) {
+        iris_log("not able to open file %d failed: %d\r\n", file, nand_errno);
+    }
+    return file;
+}
+
 NAND_FILE *get_image_file_from_queue(uint8_t index) {
     NAND_FILE *file = NANDfs_open(image_file_infos_queue[index].file_id);
     if (!file) {
@@ -439,9 +938,25 @@ int store_file_infos_in_buffer() {
             }
         }
 
+        if (cur_node.parent != 0) {
+            // A thumbnail, stored after its image
+            for (uint8_t i = 0; i < index; i++) {
+                if (image_file_infos_queue[i].file_id == cur_node.parent) {
+                    image_file_infos_queue[i].thumb_id = cur_node.id;
+                    image_file_infos_queue[i].thumb_size = cur_node.file_size;
+                }
+            }
+            continue;
+        }
         image_file_infos_queue[index].file_id = cur_node.id;
         image_file_infos_queue[index].file_name = cur_node.file_name;
         image_file_infos_queue[index].file_size = cur_node.file_size;
+        image_file_infos_queue[index].thumb_id = 0;
+        image_file_infos_queue[index].thumb_size = 0;
+        image_file_infos_queue[index].burst = cur_node.burst;
+        if (cur_node.burst > burst_id) {
+            burst_id = cur_node.burst; // the next burst gets a new id
+        }
 
         image_count++;
         index += 1;
@@ -1,13 +1,15 @@
 #include <stdio.h>
+#include <string.h>
 
 #include "stm32l0xx_hal.h"
 #include "arducam.h"
 #include "iris_system.h"
-#include "ov5642_regs.h"
+#include "ov5642_regs_packed.h"
 #include "flash_cmds.h"
 #include "I2C.h"
 #include "debug.h"
 #include "spi_bitbang.h"
+#include "jpeg_framer.h"
 extern UART_HandleTypeDef huart1;
 
 // probs needs to be re-evaluated
@@ -31,38 +33,45 @@ void arducam_delay_ms(int ms) { HAL_Delay(ms); }
  *
  */
 void program_sensor(int m_fmt, int sensor) {
+    uint8_t target = (uint8_t)sensor;
+
+    program_sensors(m_fmt, &target, 1);
+}
+
+/*
+ * Programs several sensors with the same format, the register tables are
+ * written to all of them interleaved so the settling delays are shared.
+ */
+void program_sensors(int m_fmt, const uint8_t *sensors, int count) {
     if (m_fmt == RAW) {
-        arducam_raw_init(1280, 960, sensor);
-    } else {
-        wrSensorReg16_8(REG_SYS_CTL0, 0x82, sensor); // software reset
-        wrSensorRegs16_8(OV5642_QVGA_Preview, sensor);
-        arducam_delay_ms(100);
-
-        if (m_fmt == JPEG) {
-            arducam_delay_ms(100);
-
-            wrSensorRegs16_8(OV5642_JPEG_Capture_QSXGA, sensor);
-            wrSensorRegs16_8(ov5642_320x240, sensor);
-            arducam_delay_ms(100);
-
-            wrSensorReg16_8(0x3818, 0xa8, sensor);
-            wrSensorReg16_8(0x3621, 0x10, sensor);
-            wrSensorReg16_8(0x3801, 0xb0, sensor);
-            wrSensorReg16_8(0x4407, 0x08, sensor);
-            wrSensorReg16_8(0x5888, 0x00, sensor);
-            wrSensorReg16_8(0x5000, 0xFF, sensor);
-        } else {
-            byte reg_val;
-            wrSensorReg16_8(0x4740, 0x21, sensor);
-            wrSensorReg16_8(0x501e, 0x2a, sensor);     // RGB Dither Ctl = RGB565/555
-            wrSensorReg16_8(0x5002, 0xf8, sensor);     // ISP Ctl 2 = Dither enable
-            wrSensorReg16_8(0x501f, 0x01, sensor);     // Format MUX Ctl = ISP RGB
-            wrSensorReg16_8(0x4300, 0x61, sensor);     // Format Ctl = RGB565
-            rdSensorReg16_8(0x3818, &reg_val, sensor); // Timing Ctl = Mirror/Vertical flip
-            wrSensorReg16_8(0x3818, (reg_val | 0x60) & 0xff, sensor);
-            rdSensorReg16_8(0x3621, &reg_val, sensor); // Array Ctl 01 = Horizontal bin
-            wrSensorReg16_8(0x3621, reg_val & 0xdf, sensor);
+        for (int i = 0; i < count; i++) {
+            arducam_raw_init(1280, 960, sensors[i]);
         }
+        return;
+    }
+
+    // The preview table starts with a software reset and waits for it
+    wrSensorRegsPacked16_8(OV5642_QVGA_Preview_packed, sensors, count);
+
+    if (m_fmt == JPEG) {
+        wrSensorRegsPacked16_8(OV5642_JPEG_Capture_QSXGA_packed, sensors, count);
+        wrSensorRegsPacked16_8(ov5642_320x240_packed, sensors, count);
+        wrSensorRegsPacked16_8(OV5642_JPEG_Finish_packed, sensors, count);
+        return;
+    }
+
+    for (int i = 0; i < count; i++) {
+        uint8_t sensor = sensors[i];
+        byte reg_val;
+        wrSensorReg16_8(0x4740, 0x21, sensor);
+        wrSensorReg16_8(0x501e, 0x2a, sensor);     // RGB Dither Ctl = RGB565/555
+        wrSensorReg16_8(0x5002, 0xf8, sensor);     // ISP Ctl 2 = Dither enable
+        wrSensorReg16_8(0x501f, 0x01, sensor);     // Format MUX Ctl = ISP RGB
+        wrSensorReg16_8(0x4300, 0x61, sensor);     // Format Ctl = RGB565
+        rdSensorReg16_8(0x3818, &reg_val, sensor); // Timing Ctl = Mirror/Vertical flip
+        wrSensorReg16_8(0x3818, (reg_val | 0x60) & 0xff, sensor);
+        rdSensorReg16_8(0x3621, &reg_val, sensor); // Array Ctl 01 = Horizontal bin
+        wrSensorReg16_8(0x3621, reg_val & 0xdf, sensor);
     }
 }
 
@@ -76,18 +85,19 @@ void arducam_raw_init(int width, int depth, uint8_t sensor) {
      * I also don't know if the order of programming the registers matters, but
      * all the examples set the resolution in exactly the same place.
      */
-    wrSensorRegs16_8(OV5642_RAW_Init_start, sensor);
+    wrSensorRegsPacked16_8(OV5642_RAW_Init_start_packed, &sensor, 1);
 
     wrSensorReg16_8(REG_DVPHO_HI, (uint8_t)(width >> 8), sensor);
     wrSensorReg16_8(REG_DVPHO_LO, (uint8_t)(width & 0x0ff), sensor);
     wrSensorReg16_8(REG_DVPVO_HI, (uint8_t)(depth >> 8), sensor);
     wrSensorReg16_8(REG_DVPVO_LO, (uint8_t)(depth & 0x0ff), sensor);
 
-    wrSensorRegs16_8(OV5642_RAW_Init_finish, sensor);
+    wrSensorRegsPacked16_8(OV5642_RAW_Init_finish_packed, &sensor, 1);
 }
 
 /*
- * Function to get the current resolution of target sensor
+ * Function to get the current resolution of target sensor, answered from
+ * the register shadow once the sensor has been programmed
  *
  * params:
  * 		width: pointer to variable to store width
@@ -120,6 +130,23 @@ void arducam_get_resolution(int *width, int *depth, uint8_t sensor) {
  * 		sensor: Integer sensor identifier
  */
 int arducam_set_resolution(int format, int width, uint8_t sensor) {
+    return arducam_set_resolutions(format, width, &sensor, 1);
+}
+
+/*
+ * Sets the resolution of several sensors, JPEG windows are written to all
+ * of them interleaved and the sensors settle on the new window together.
+ * Only the registers that change are written, and a sensor already at the
+ * resolution is left alone.
+ *
+ * params:
+ * 		width: horizontal resolution
+ * 		sensors: sensor identifiers
+ * 		count: number of sensors
+ */
+int arducam_set_resolutions(int format, int width, const uint8_t *sensors, int count) {
+    const uint8_t *window = NULL;
+    int depth = 0;
     int rc = width;
     switch (width) {
     case 320:
@@ -127,35 +154,31 @@ int arducam_set_resolution(int format, int width, uint8_t sensor) {
             iris_log("320x240 not supported for RAW");
             rc = 0;
         } else
-            wrSensorRegs16_8(ov5642_320x240, sensor);
+            window = ov5642_320x240_packed;
         break;
     case 640:
-        if (format == RAW)
-            arducam_raw_init(640, 480, sensor);
-        else
-            wrSensorRegs16_8(ov5642_640x480, sensor);
+        depth = 480;
+        window = ov5642_640x480_packed;
         break;
     case 1024:
         if (format == RAW) {
             iris_log("1024x768 not supported for RAW");
             rc = 0;
         } else
-            wrSensorRegs16_8(ov5642_1024x768, sensor);
+            window = ov5642_1024x768_packed;
         break;
     case 1280:
-        if (format == RAW)
-            arducam_raw_init(1280, 960, sensor);
-        else
-            wrSensorRegs16_8(ov5642_1280x960, sensor);
+        depth = 960;
+        window = ov5642_1280x960_packed;
         break;
 #if 0
     case 1600:
-      wrSensorRegs16_8(ov5642_1600x1200, sensor);
+      window = ov5642_1600x1200_packed;
       break;
 #endif
     case 1920:
         if (format == RAW)
-            arducam_raw_init(1920, 1080, sensor);
+            depth = 1080;
         else {
             iris_log("1920X1080 not supported");
             rc = 0;
@@ -163,22 +186,30 @@ int arducam_set_resolution(int format, int width, uint8_t sensor) {
         break;
 #if 0
     case 2048:
-      wrSensorRegs16_8(ov5642_2048x1536, sensor);
+      window = ov5642_2048x1536_packed;
       break;
 #endif
     case 2592:
-        if (format == RAW)
-            arducam_raw_init(2592, 1944, sensor);
-        else {
-            wrSensorRegs16_8(ov5642_2592x1944, sensor);
-        }
+        depth = 1944;
+        window = ov5642_2592x1944_packed;
         break;
     default:
         iris_log("unsupported width\r\n");
         rc = 0;
         break;
     }
-    HAL_Delay(1000);
+    if (rc == 0) {
+        return rc;
+    }
+
+    if (format == RAW) {
+        for (int i = 0; i < count; i++) {
+            arducam_raw_init(width, depth, sensors[i]);
+        }
+    } else if (wrSensorRegsPacked16_8(window, sensors, count) == 0) {
+        return rc; // already at this resolution
+    }
+    arducam_delay_ms(OV5642_MODE_SETTLE_MS);
     return rc;
 }
 
@@ -208,6 +239,93 @@ bool arducam_wait_for_ready(uint8_t sensor) {
     return (rval == wval);
 }
 
+#define SPI_CAL_ROUNDS 4      // passes over the test patterns at each clock step
+#define SPI_CAL_FIFO_BYTES 64 // FIFO bytes compared at each clock step
+
+static const uint8_t spi_cal_patterns[] = {0x55, 0xaa, 0x00, 0xff, 0x01, 0x80, 0x7e, 0x81};
+
+/*
+ * Writes the test patterns to AC_REG_TEST and reads them back through the
+ * burst reader
+ */
+static bool _spi_patterns_ok(uint8_t sensor) {
+    for (int r = 0; r < SPI_CAL_ROUNDS; r++) {
+        for (size_t i = 0; i < sizeof(spi_cal_patterns); i++) {
+            write_reg(AC_REG_TEST, spi_cal_patterns[i], sensor);
+            if (read_spi_reg_burst(AC_REG_TEST, sensor) != spi_cal_patterns[i]) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+/*
+ * Burst reads the first SPI_CAL_FIFO_BYTES of the FIFO
+ */
+static void _spi_fifo_read(uint8_t sensor, uint8_t *buf) {
+    write_reg(ARDUCHIP_FIFO, FIFO_RDPTR_RST_MASK, sensor);
+    spi_init_burst(sensor);
+    spi_read_burst_buf(sensor, buf, SPI_CAL_FIFO_BYTES);
+    spi_deinit_burst(sensor);
+}
+
+/*
+ * Finds the fastest burst clock the wiring to a sensor takes
+ *
+ * Reads the start of the FIFO with bursts at the register timing, then steps
+ * the burst clock up one cycle at a time until the same bytes or the test
+ * patterns, read back through the burst reader, stop coming back, or the
+ * clock reaches SPI_BURST_MAX_HZ. The burst timing is then set a quarter
+ * slower than the last step that passed, but never slower than the register
+ * timing, which register accesses keep. A garbled address can hit any
+ * register, so run it before resetting the sensor.
+ *
+ * param:
+ * 		sensor: integer sensor identifier
+ * return:
+ * 		false, leaving the timing as it was, if bursts fail at the register timing
+ */
+bool arducam_calibrate_spi(uint8_t sensor) {
+    spi_timing_t timing, trial;
+    uint8_t ref[SPI_CAL_FIFO_BYTES], got[SPI_CAL_FIFO_BYTES];
+    uint16_t half, good;
+    bool failed = false;
+
+    spi_get_timing(sensor, &timing);
+    trial = timing;
+    trial.burst_half_cycles = timing.reg_half_cycles;
+    spi_set_timing(sensor, &trial);
+    _spi_fifo_read(sensor, ref);
+    _spi_fifo_read(sensor, got);
+    if (!_spi_patterns_ok(sensor) || memcmp(ref, got, sizeof(ref)) != 0) {
+        spi_set_timing(sensor, &timing);
+        return false;
+    }
+
+    good = half = timing.reg_half_cycles;
+    while (half > SPI_BURST_MIN_HALF_CYCLES) {
+        trial.burst_half_cycles = --half;
+        spi_set_timing(sensor, &trial);
+        _spi_fifo_read(sensor, got);
+        if (memcmp(ref, got, sizeof(ref)) != 0 || !_spi_patterns_ok(sensor)) {
+            failed = true;
+            break;
+        }
+        good = half;
+    }
+
+    if (failed) {
+        good += (good + 3) / 4;
+        if (good > timing.reg_half_cycles) {
+            good = timing.reg_half_cycles;
+        }
+    }
+    timing.burst_half_cycles = good;
+    spi_set_timing(sensor, &timing);
+    return true;
+}
+
 /*
  * Read sensor SPI reg
  *
@@ -428,65 +546,75 @@ static inline uint32_t min(uint32_t a, uint32_t b) { return (a <= b) ? a : b; }
 //
 //#define BUF_LEN 64
 //
-static void dump_uart_jpg_burst(uint32_t length, uint8_t sensor) {
+#define UART_JPG_BUF_LEN 512
+
+/* Collects the framed JPEG into UART sized writes */
+typedef struct {
+    uint8_t *buf;
+    uint32_t fill;
+    uint32_t sent;
+} uart_jpg_sink_t;
+
+static void _uart_jpg_flush(uart_jpg_sink_t *out) {
+    if (out->fill) {
+        HAL_UART_Transmit(&huart1, out->buf, out->fill, 100);
+        out->sent += out->fill;
+        out->fill = 0;
+    }
+}
 
-    uint32_t BUF_LEN = 512;
-    uint8_t prev = 0, curr = 0;
-    bool found_header = false;
-    uint32_t i, x = 0;
-    uint8_t buf[BUF_LEN];
+static int _uart_jpg_sink(const uint8_t *data, uint32_t len, void *arg) {
+    uart_jpg_sink_t *out = (uart_jpg_sink_t *)arg;
+
+    while (len > 0) {
+        uint32_t n = min(len, UART_JPG_BUF_LEN - out->fill);
+        memcpy(out->buf + out->fill, data, n);
+        out->fill += n;
+        data += n;
+        len -= n;
+        if (out->fill == UART_JPG_BUF_LEN) {
+            _uart_jpg_flush(out);
+        }
+    }
+    return 0;
+}
+
+/*
+ * Sends the FIFO length, then the JPEG from SOI to EOI, zero filled up to the
+ * length the receiver was told. The FIFO is not read past EOI.
+ */
+static void dump_uart_jpg_burst(uint32_t length, uint8_t sensor) {
+    static const uint8_t eoi[2] = {0xff, 0xd9};
+    uint8_t buf[UART_JPG_BUF_LEN];
+    uint8_t chunk[32];
+    uart_jpg_sink_t out = {.buf = buf, .fill = 0, .sent = 0};
+    jpeg_framer_t framer;
+    uint32_t i;
 
     // Note: we're assuming the ARM is BE
     memcpy(buf, &length, sizeof(length));
     HAL_UART_Transmit(&huart1, (uint8_t *)buf, sizeof(length), 100);
 
+    jpeg_framer_init(&framer);
     spi_init_burst(sensor);
-    for (i = 0; i < length; i++) {
-        prev = curr;
-        curr = spi_read_burst(sensor);
-        if ((curr == 0xd9) && (prev == 0xff)) {
-            // found the footer - break
-            buf[x++] = curr;
-            HAL_UART_Transmit(&huart1, buf, x, 100);
-            x = 0;
-            i++;
-            found_header = false;
-            break;
-        }
-
-        if (found_header) {
-            buf[x] = curr;
-            x++;
-            if (x >= BUF_LEN) {
-                HAL_UART_Transmit(&huart1, buf, BUF_LEN, 100);
-                x = 0;
-            }
-        } else if ((curr == 0xd8) && (prev = 0xff)) {
-            found_header = true;
-            buf[0] = prev;
-            buf[1] = curr;
-            HAL_UART_Transmit(&huart1, (uint8_t *)buf, 2, 100);
-            x = 0;
-        }
+    for (i = 0; i < length && !jpeg_framer_done(&framer); i += sizeof(chunk)) {
+        uint32_t n = min(length - i, sizeof(chunk));
+        spi_read_burst_buf(sensor, chunk, n);
+        jpeg_framer_feed(&framer, chunk, n, _uart_jpg_sink, &out);
     }
     spi_deinit_burst(sensor);
 
-    if (x) {
-        HAL_UART_Transmit(&huart1, buf, x, 100);
+    if (framer.state == JPEG_FRAMER_BODY && out.sent + out.fill + sizeof(eoi) <= length) {
+        // We found the header but not the footer :-(
+        _uart_jpg_sink(eoi, sizeof(eoi), &out);
     }
+    _uart_jpg_flush(&out);
 
-    if (found_header) {
-        // We found the header but not the footer :-(
-        buf[0] = 0xff;
-        buf[1] = 0xd9;
-        HAL_UART_Transmit(&huart1, (uint8_t *)buf, 2, 100);
-    } else {
-        memset(buf, 0, BUF_LEN);
-        while (i < length) {
-            int cnt = min(length - i, BUF_LEN);
-            HAL_UART_Transmit(&huart1, (uint8_t *)buf, cnt, 100);
-            i += cnt;
-        }
+    memset(buf, 0, UART_JPG_BUF_LEN);
+    while (out.sent < length) {
+        uint32_t cnt = min(length - out.sent, UART_JPG_BUF_LEN);
+        HAL_UART_Transmit(&huart1, (uint8_t *)buf, cnt, 100);
+        out.sent += cnt;
     }
 }
 //
@@ -0,0 +1,94 @@
+/*
+ * jpeg_framer.c
+ *
+ * Streaming JPEG framer for the Arducam FIFO, shared by everything that
+ * drains a capture: NAND, the OBC direct transfer and the UART dump.
+ */
+#include "jpeg_framer.h"
+
+static const uint8_t soi[2] = {0xff, 0xd8};
+
+void jpeg_framer_init(jpeg_framer_t *framer) {
+    framer->state = JPEG_FRAMER_SEEK;
+    framer->prev = 0;
+    framer->length = 0;
+    framer->used = 0;
+}
+
+static int _emit(jpeg_framer_t *framer, const uint8_t *data, uint32_t len, jpeg_sink_t sink, void *arg) {
+    int ret;
+
+    if (len == 0) {
+        return 0;
+    }
+    ret = sink(data, len, arg);
+    if (ret < 0) {
+        return ret;
+    }
+    framer->length += len;
+    return 0;
+}
+
+/**
+ * @brief Passes the JPEG bytes of the next chunk of the FIFO to the sink
+ *
+ * Bytes before SOI are dropped, and so is everything after the first EOI,
+ * after which jpeg_framer_done is true and the rest of the FIFO need not be
+ * read. The sink can be called twice for a chunk, when SOI straddles chunks.
+ * Once done, used is the offset just past EOI in the chunk, where the next
+ * JPEG of a burst starts.
+ *
+ * @param framer    framer state, set up by jpeg_framer_init
+ * @param chunk     next bytes of the FIFO
+ * @param len       number of bytes in chunk
+ * @param sink      receives the JPEG bytes
+ * @param arg       passed to sink
+ * @return 0, or what the sink returned if it failed
+ */
+int jpeg_framer_feed(jpeg_framer_t *framer, const uint8_t *chunk, uint32_t len, jpeg_sink_t sink, void *arg) {
+    uint32_t i = 0;
+    uint32_t start = 0;
+    int ret;
+
+    if (framer->state == JPEG_FRAMER_SEEK) {
+        for (; i < len; i++) {
+            if (framer->prev == 0xff && chunk[i] == 0xd8) {
+                break;
+            }
+            framer->prev = chunk[i];
+        }
+        if (i == len) {
+            framer->used = len;
+            return 0;
+        }
+
+        framer->state = JPEG_FRAMER_BODY;
+        framer->prev = 0xd8;
+        if (i == 0) {
+            // the FF of SOI ended the last chunk
+            ret = _emit(framer, soi, sizeof(soi), sink, arg);
+            if (ret < 0) {
+                return ret;
+            }
+            start = 1;
+        } else {
+            start = i - 1;
+        }
+        i++;
+    }
+
+    if (framer->state == JPEG_FRAMER_BODY) {
+        for (; i < len; i++) {
+            if (framer->prev == 0xff && chunk[i] == 0xd9) {
+                framer->state = JPEG_FRAMER_DONE;
+                i++;
+                break;
+            }
+            framer->prev = chunk[i];
+        }
+        framer->used = i;
+        return _emit(framer, chunk + start, i - start, sink, arg);
+    }
+    framer->used = 0;
+    return 0;
+}
@@ -9,121 +9,59 @@
  */
 #include "compression.h"
 #include "iris_system.h"
-#include "rle.h"
-#include <stdlib.h>
+#include "rle_stream.h"
 
-unsigned int rle_compress(unsigned char *arr, unsigned int insize, unsigned char *outarr, uint8_t ecc) {
+typedef struct {
+    const unsigned char *expect;
+    unsigned int pos;
+    unsigned int len;
+    unsigned int err_count;
+} _compare_t;
 
-    unsigned int outsize, bufsize, k, err_count;
-    err_count = 0;
-    unsigned char *in, *out, *buf;
-    /* Worst case output buffer size */
-    bufsize = (insize * 104 + 50) / 100 + 384;
+static int _compare_sink(const uint8_t *data, uint32_t len, void *arg) {
+    _compare_t *cmp = (_compare_t *)arg;
 
-    /* Allocate memory */
-    in = (unsigned char *)malloc(insize + 2 * bufsize);
-    if (!in) {
-        return;
-    }
-
-    /* copy contents to buffer */
-    *in = arr;
-
-    /* Pointers to compression buffer and output memory */
-    buf = &in[insize];
-    out = &buf[bufsize];
-    outsize = RLE_Compress(in, buf, insize);
-
-    if (ecc) {
-        if (outsize > 0) {
-            RLE_Uncompress(buf, out, outsize);
-            /* Show compression result */
-            iris_log("\n  Compression: Output: %d / input : %d bytes \r\n", outsize, insize);
-
-            /* Compare input / output data */
-            for (k = 0; k < insize; ++k) {
-                if (in[k] != out[k]) {
-                    if (err_count == 0)
-                        iris_log("\n");
-                    if (err_count == 30)
-                        iris_log("    ...\n");
-                    else if (err_count < 30) {
-                        iris_log("    0x%x: 0x%x != 0x%x\n", k, out[k], in[k]);
-                    }
-                    ++err_count;
-                }
-            }
-            /* Did it work? */
-            if (err_count == 0) {
-                iris_log(" - OK!\n");
-            } else {
-                iris_log("    *******************************\n");
-                iris_log("    ERROR: %d faulty bytes\n", err_count);
-                iris_log("    *******************************\n");
+    for (uint32_t k = 0; k < len; k++, cmp->pos++) {
+        if (cmp->pos >= cmp->len || data[k] != cmp->expect[cmp->pos]) {
+            if (cmp->err_count < 30) {
+                iris_log("    0x%x: 0x%x != 0x%x\n", cmp->pos, data[k],
+                         (cmp->pos < cmp->len) ? cmp->expect[cmp->pos] : 0);
             }
+            ++cmp->err_count;
         }
     }
-
-    // TODO: fix this shit
-    *outarr = *buf;
-    return outsize;
+    return 0;
 }
 
-// unsigned int rel_decompress(){
-//	  RLE_Uncompress(buf, out, outsize );
-// }
-
-void _test_compression(unsigned char *arr, unsigned int insize) {
-
-    unsigned int outsize, bufsize, k, err_count;
-    err_count = 0;
-    unsigned char *in, *out, *buf;
-    /* Worst case output buffer size */
-    bufsize = (insize * 104 + 50) / 100 + 384;
-
-    /* Allocate memory */
-    in = (unsigned char *)malloc(insize + 2 * bufsize);
-    if (!in) {
-        return;
-    }
-
-    /* copy contents to buffer */
-    *in = arr;
-
-    /* Pointers to compression buffer and output memory */
-    buf = &in[insize];
-    out = &buf[bufsize];
-    outsize = RLE_Compress(in, buf, insize);
-    RLE_Uncompress(buf, out, outsize);
+static int _decoder_sink(const uint8_t *data, uint32_t len, void *arg) {
+    return rle_decoder_feed((rle_decoder_t *)arg, data, len);
+}
 
-    if (outsize > 0) {
-        /* Show compression result */
-        iris_log("\n  Compression: Output: %d / input : %d bytes \r\n", outsize, insize);
+/*
+ * Codes arr with the streaming coder and decodes the result straight back,
+ * neither needs more than its fixed state
+ */
+static void _test_compression(const unsigned char *arr, unsigned int insize) {
+    static rle_stream_t stream;
+    static rle_decoder_t decoder;
+    _compare_t cmp = {.expect = arr, .len = insize};
 
-        /* Compare input / output data */
-        for (k = 0; k < insize; ++k) {
-            if (in[k] != out[k]) {
-                if (err_count == 0)
-                    iris_log("\n");
-                if (err_count == 30)
-                    iris_log("    ...\n");
-                else if (err_count < 30) {
-                    iris_log("    0x%x: 0x%x != 0x%x\n", k, out[k], in[k]);
-                }
-                ++err_count;
-            }
-        }
-        /* Did we have success? */
-        if (err_count == 0) {
-            iris_log(" - OK!\n");
-        } else {
-            iris_log("    *******************************\n");
-            iris_log("    ERROR: %d faulty bytes\n", err_count);
-            iris_log("    *******************************\n");
-        }
+    rle_decoder_init(&decoder, _compare_sink, &cmp);
+    rle_stream_init(&stream, _decoder_sink, &decoder);
+    rle_stream_feed(&stream, arr, insize);
+    rle_stream_finish(&stream);
+    if (rle_decoder_finish(&decoder) < 0 || cmp.pos != insize) {
+        cmp.err_count++;
     }
 
-    while (1) {
+    /* Show compression result */
+    iris_log("\n  Compression: Output: %d / input : %d bytes \r\n", stream.out_bytes, insize);
+    if (cmp.err_count == 0) {
+        iris_log(" - OK!\n");
+    } else {
+        iris_log("    *******************************\n");
+        iris_log("    ERROR: %d faulty bytes\n", cmp.err_count);
+        iris_log("    *******************************\n");
     }
 }
 
@@ -361,5 +299,5 @@ void test_compression() {
         0xFF, 0xFF, 0xC0, 0xFF, 0xFF, 0xC0, 0xFF, 0xC0, 0xFF,
     };
 
-    _test_compression(&array, sizeof(array));
+    _test_compression(array, sizeof(array));
 }
@@ -0,0 +1,338 @@
+/*
+ * loco.c
+ *
+ * LOCO-I style lossless coder, see loco.h for the format. The encoder and
+ * decoder share the predictor and the context model and differ only in
+ * whether the byte is known before or after the code.
+ *
+ * A code is q 1 bits, a 0 bit and the low k bits of the mapped error, q being
+ * the error shifted down by k. Errors with q of LOCO_QMAX or more are escaped
+ * as LOCO_QMAX 1 bits and the 8 bit mapped error, so no code is longer than
+ * LOCO_CODE_MAX bits and padding of fewer than 8 1 bits never decodes.
+ */
+#include <string.h>
+
+#include "loco.h"
+
+#define LOCO_QMAX 16
+#define LOCO_KMAX 7
+#define LOCO_CODE_MAX 24 // LOCO_QMAX 1 bits and 8 bits of escaped error
+#define LOCO_RESET 64    // halve a context's sums after this many samples
+#define LOCO_A_INIT 4
+
+static const uint8_t loco_magic[2] = {'L', 'I'};
+
+static void _loco_reset(loco_t *l, loco_sink_t sink, void *arg) {
+    memset(l, 0, sizeof(*l) - sizeof(l->ring));
+    l->sink = sink;
+    l->arg = arg;
+    for (int i = 0; i < LOCO_CONTEXTS; i++) {
+        l->contexts[i].a = LOCO_A_INIT;
+        l->contexts[i].n = 1;
+    }
+}
+
+static int _loco_setup(loco_t *l, uint8_t layout, uint16_t line) {
+    // the ring reaches back to the upper left neighbour, at most 4 bytes past the line(s) above
+    uint32_t size = ((layout == LOCO_BAYER8) ? (uint32_t)line << 1 : line) + 4;
+
+    if (layout > LOCO_YUV422 || line < 4 || size > LOCO_HISTORY) {
+        return -1;
+    }
+    l->layout = layout;
+    l->line = line;
+    l->size = (uint16_t)size;
+    return 0;
+}
+
+static inline uint8_t _loco_back(const loco_t *l, uint16_t d) {
+    return l->ring[(l->pos >= d) ? l->pos - d : l->pos + l->size - d];
+}
+
+/*
+ * MED prediction of the next byte from its neighbours of the same colour,
+ * and the context it is coded in
+ */
+static uint8_t _loco_predict(loco_t *l, loco_context_t **ctx) {
+    uint16_t dx, up;
+    uint8_t colour, above, a, b, c;
+
+    if (l->layout == LOCO_BAYER8) {
+        dx = 2;
+        up = l->line << 1;
+        above = l->lines >= 2;
+        colour = (l->odd << 1) | (l->x & 1);
+    } else {
+        dx = (l->x & 1) ? 4 : 2;
+        up = l->line;
+        above = l->lines >= 1;
+        colour = (l->x & 1) ? (l->x & 3) : 0; // Y, U or V
+    }
+
+    uint8_t left = l->x >= dx;
+    a = left ? _loco_back(l, dx) : (above ? _loco_back(l, up) : 0);
+    b = above ? _loco_back(l, up) : a;
+    c = (above && left) ? _loco_back(l, up + dx) : b;
+
+    uint16_t g = ((b > c) ? b - c : c - b) + ((a > c) ? a - c : c - a);
+    uint8_t q = 0;
+    while (g && q < 7) {
+        g >>= 1;
+        q++;
+    }
+    *ctx = &l->contexts[(colour << 3) | q];
+
+    uint8_t lo = (a < b) ? a : b;
+    uint8_t hi = (a < b) ? b : a;
+    if (c >= hi) {
+        return lo;
+    }
+    if (c <= lo) {
+        return hi;
+    }
+    return a + b - c;
+}
+
+static uint8_t _loco_k(const loco_context_t *ctx) {
+    uint8_t k = 0;
+
+    while (k < LOCO_KMAX && ((uint32_t)ctx->n << k) < ctx->a) {
+        k++;
+    }
+    return k;
+}
+
+/*
+ * Adapts the context to the error and moves the ring on past the byte
+ */
+static void _loco_update(loco_t *l, loco_context_t *ctx, int8_t e, uint8_t v) {
+    ctx->a += (e < 0) ? -e : e;
+    if (++ctx->n == LOCO_RESET) {
+        ctx->a >>= 1;
+        ctx->n >>= 1;
+    }
+
+    l->ring[l->pos] = v;
+    if (++l->pos == l->size) {
+        l->pos = 0;
+    }
+    if (++l->x == l->line) {
+        l->x = 0;
+        l->odd ^= 1;
+        if (l->lines < 2) {
+            l->lines++;
+        }
+    }
+}
+
+static int _loco_flush(loco_t *l) {
+    int ret = 0;
+
+    if (l->fill > 0) {
+        l->out_bytes += l->fill;
+        ret = l->sink(l->out, l->fill, l->arg);
+        l->fill = 0;
+    }
+    return ret;
+}
+
+static int _loco_out(loco_t *l, uint8_t b) {
+    l->out[l->fill++] = b;
+    return (l->fill == LOCO_OUT_SIZE) ? _loco_flush(l) : 0;
+}
+
+/*
+ * Appends the low n bits of v, n at most 16
+ */
+static int _loco_put(loco_t *l, uint32_t v, uint8_t n) {
+    int ret = 0;
+
+    l->bits = (l->bits << n) | v;
+    l->nbits += n;
+    while (l->nbits >= 8 && ret == 0) {
+        l->nbits -= 8;
+        ret = _loco_out(l, (uint8_t)(l->bits >> l->nbits));
+    }
+    return ret;
+}
+
+/**
+ * @brief Starts a new stream and writes its header
+ *
+ * @param l       coder state
+ * @param layout  how the colours of the image are laid out
+ * @param line    bytes a line
+ * @param sink    receives the coded bytes
+ * @param arg     passed to sink
+ *
+ * @return 0, or -1 if the line is too long to keep the lines above it
+ */
+int loco_encoder_init(loco_t *l, loco_layout_t layout, uint16_t line, loco_sink_t sink, void *arg) {
+    _loco_reset(l, sink, arg);
+    if (_loco_setup(l, layout, line) < 0) {
+        return -1;
+    }
+    l->out[0] = loco_magic[0];
+    l->out[1] = loco_magic[1];
+    l->out[2] = layout;
+    l->out[3] = line >> 8;
+    l->out[4] = line & 0xff;
+    l->fill = LOCO_HEADER_SIZE;
+    return 0;
+}
+
+/**
+ * @brief Codes the next chunk of the image, lines can span chunks
+ *
+ * @return 0, or what the sink returned if it failed
+ */
+int loco_encode(loco_t *l, const uint8_t *in, uint32_t len) {
+    int ret = 0;
+
+    for (uint32_t i = 0; i < len && ret == 0; i++) {
+        loco_context_t *ctx;
+        uint8_t pred = _loco_predict(l, &ctx);
+        uint8_t k = _loco_k(ctx);
+        int8_t e = (int8_t)(in[i] - pred);
+        uint8_t m = (e >= 0) ? (uint8_t)(e << 1) : (uint8_t)((-e << 1) - 1);
+        uint8_t q = m >> k;
+
+        if (q < LOCO_QMAX) {
+            ret = _loco_put(l, ((1u << q) - 1) << 1, q + 1);
+            if (ret == 0 && k) {
+                ret = _loco_put(l, m & ((1u << k) - 1), k);
+            }
+        } else {
+            ret = _loco_put(l, (1u << LOCO_QMAX) - 1, LOCO_QMAX);
+            if (ret == 0) {
+                ret = _loco_put(l, m, 8);
+            }
+        }
+        _loco_update(l, ctx, e, in[i]);
+    }
+    l->in_bytes += len;
+    return ret;
+}
+
+/**
+ * @brief Pads the last code out to a byte and writes the last block
+ *
+ * @return 0, or what the sink returned if it failed
+ */
+int loco_encoder_finish(loco_t *l) {
+    int ret = 0;
+
+    if (l->nbits) {
+        ret = _loco_put(l, (1u << (8 - l->nbits)) - 1, 8 - l->nbits);
+    }
+    return (ret < 0) ? ret : _loco_flush(l);
+}
+
+/**
+ * @brief Starts decoding a new stream, the header sets the layout
+ *
+ * @param l     decoder state
+ * @param sink  receives the decoded bytes
+ * @param arg   passed to sink
+ */
+void loco_decoder_init(loco_t *l, loco_sink_t sink, void *arg) {
+    _loco_reset(l, sink, arg);
+    l->header = LOCO_HEADER_SIZE;
+}
+
+/*
+ * Decodes one byte if its whole code is in the accumulator
+ *
+ * Returns 1 if it did, 0 if more bits are needed, or what the sink returned
+ */
+static int _loco_decode_one(loco_t *l) {
+    loco_context_t *ctx;
+    uint8_t pred = _loco_predict(l, &ctx);
+    uint8_t k = _loco_k(ctx);
+    uint8_t q = 0, used, m;
+
+    while (q < LOCO_QMAX && q < l->nbits && ((l->bits >> (l->nbits - 1 - q)) & 1)) {
+        q++;
+    }
+    if (q == LOCO_QMAX) {
+        used = LOCO_QMAX + 8;
+        if (l->nbits < used) {
+            return 0;
+        }
+        m = (uint8_t)(l->bits >> (l->nbits - used));
+    } else {
+        used = q + 1 + k;
+        if (q == l->nbits || l->nbits < used) {
+            return 0;
+        }
+        m = (uint8_t)((q << k) | ((l->bits >> (l->nbits - used)) & ((1u << k) - 1)));
+    }
+    l->nbits -= used;
+
+    int8_t e = (m & 1) ? -(int8_t)((m >> 1) + 1) : (int8_t)(m >> 1);
+    uint8_t v = pred + e;
+    _loco_update(l, ctx, e, v);
+    int ret = _loco_out(l, v);
+    return (ret < 0) ? ret : 1;
+}
+
+/**
+ * @brief Decodes the next chunk of a stream, codes can span chunks
+ *
+ * @return 0, -1 if the header is not one loco_encoder_init writes, or what
+ *         the sink returned if it failed
+ */
+int loco_decode(loco_t *l, const uint8_t *in, uint32_t len) {
+    int ret = 0;
+    uint32_t i = 0;
+
+    for (; i < len && l->header; i++) {
+        uint8_t at = LOCO_HEADER_SIZE - l->header--;
+
+        if (at < sizeof(loco_magic)) {
+            if (in[i] != loco_magic[at]) {
+                return -1;
+            }
+        } else if (at == 2) {
+            l->layout = in[i];
+        } else {
+            l->line = (l->line << 8) | in[i];
+            if (l->header == 0 && _loco_setup(l, l->layout, l->line) < 0) {
+                return -1;
+            }
+        }
+    }
+    for (; i < len && ret >= 0; i++) {
+        l->bits = (l->bits << 8) | in[i];
+        l->nbits += 8;
+        while (l->nbits >= LOCO_CODE_MAX && (ret = _loco_decode_one(l)) > 0)
+            ;
+    }
+    l->in_bytes += len;
+    return (ret < 0) ? ret : 0;
+}
+
+/**
+ * @brief Decodes the codes left in the accumulator and passes on the last
+ *        decoded bytes
+ *
+ * @return 0, -1 if the stream ended inside a code or its header, or what the
+ *         sink returned if it failed
+ */
+int loco_decoder_finish(loco_t *l) {
+    int ret;
+
+    if (l->header) {
+        return -1;
+    }
+    while ((ret = _loco_decode_one(l)) > 0)
+        ;
+    if (ret == 0) {
+        ret = _loco_flush(l);
+    }
+    if (ret < 0) {
+        return ret;
+    }
+    uint32_t pad = (1u << l->nbits) - 1;
+    return (l->nbits >= 8 || (l->bits & pad) != pad) ? -1 : 0;
+}
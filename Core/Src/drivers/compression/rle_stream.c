@@ -0,0 +1,289 @@
+/*
+ * rle_stream.c
+ *
+ * Streaming version of RLE_Compress/RLE_Uncompress, see rle_stream.h for
+ * the format. The coder holds one pending run and a block of output, and
+ * works the same whatever size the chunks fed to it are.
+ */
+#include <string.h>
+
+#include "rle_stream.h"
+
+#define RLE_CODE_MAX 4 // longest code, marker, long count and symbol
+
+enum { RLE_DEC_MARKER, RLE_DEC_DATA, RLE_DEC_COUNT, RLE_DEC_LONG, RLE_DEC_SYMBOL, RLE_DEC_RUN };
+
+static int _rle_flush(uint8_t *out, uint8_t *fill, rle_sink_t sink, void *arg) {
+    int ret = 0;
+
+    if (*fill > 0) {
+        ret = sink(out, *fill, arg);
+        *fill = 0;
+    }
+    return ret;
+}
+
+static int _rle_room(rle_stream_t *s) {
+    if (s->fill > RLE_STREAM_OUT_SIZE - RLE_CODE_MAX) {
+        s->out_bytes += s->fill;
+        int ret = _rle_flush(s->out, &s->fill, s->sink, s->arg);
+        if (ret < 0) {
+            return ret;
+        }
+    }
+    return 0;
+}
+
+/*
+ * Writes the pending run the way _RLE_WriteRep does
+ */
+static int _rle_write_run(rle_stream_t *s) {
+    uint16_t count = s->count;
+    int ret = _rle_room(s);
+
+    if (ret < 0) {
+        return ret;
+    }
+    if (count <= 3) {
+        if (s->symbol == s->marker) {
+            s->out[s->fill++] = s->marker;
+            s->out[s->fill++] = count - 1;
+        } else {
+            for (uint16_t i = 0; i < count; i++) {
+                s->out[s->fill++] = s->symbol;
+            }
+        }
+    } else {
+        count--;
+        s->out[s->fill++] = s->marker;
+        if (count >= 128) {
+            s->out[s->fill++] = (count >> 8) | 0x80;
+        }
+        s->out[s->fill++] = count & 0xff;
+        s->out[s->fill++] = s->symbol;
+    }
+    s->count = 0;
+    return 0;
+}
+
+/*
+ * Makes the least common byte of the window the marker, keeping the current
+ * one on a tie, and starts a new window
+ */
+static int _rle_choose_marker(rle_stream_t *s) {
+    uint8_t marker = s->marker;
+    int ret = _rle_room(s);
+
+    if (ret < 0) {
+        return ret;
+    }
+    for (int i = 0; i < 256; i++) {
+        if (s->histogram[i] < s->histogram[marker]) {
+            marker = i;
+        }
+    }
+    if (!s->started) {
+        s->out[s->fill++] = marker;
+        s->started = 1;
+    } else if (marker != s->marker) {
+        s->out[s->fill++] = s->marker; // end code
+        s->out[s->fill++] = 0x80;
+        s->out[s->fill++] = 0x00;
+        s->out[s->fill++] = marker;
+    }
+    s->marker = marker;
+    memset(s->histogram, 0, sizeof(s->histogram));
+    s->window = 0;
+    return 0;
+}
+
+/**
+ * @brief Starts a new stream
+ *
+ * @param s     coder state
+ * @param sink  receives the coded bytes
+ * @param arg   passed to sink
+ */
+void rle_stream_init(rle_stream_t *s, rle_sink_t sink, void *arg) {
+    memset(s, 0, sizeof(*s));
+    s->sink = sink;
+    s->arg = arg;
+}
+
+/**
+ * @brief Codes the next chunk of input
+ *
+ * The first marker is the least common byte of the first chunk (or its
+ * first RLE_STREAM_WINDOW bytes). A run can span chunks.
+ *
+ * @return 0, or what the sink returned if it failed
+ */
+int rle_stream_feed(rle_stream_t *s, const uint8_t *in, uint32_t len) {
+    int ret;
+
+    if (!s->started && len > 0) {
+        for (uint32_t i = 0; i < len && i < RLE_STREAM_WINDOW; i++) {
+            s->histogram[in[i]] += s->histogram[in[i]] != 0xff;
+        }
+        ret = _rle_choose_marker(s);
+        if (ret < 0) {
+            return ret;
+        }
+    }
+
+    for (uint32_t i = 0; i < len; i++) {
+        uint8_t b = in[i];
+
+        s->histogram[b] += s->histogram[b] != 0xff;
+        if (s->count && b == s->symbol && s->count < RLE_STREAM_MAX_RUN) {
+            s->count++;
+        } else {
+            if (s->count && (ret = _rle_write_run(s)) < 0) {
+                return ret;
+            }
+            s->symbol = b;
+            s->count = 1;
+        }
+        if (++s->window == RLE_STREAM_WINDOW && (ret = _rle_choose_marker(s)) < 0) {
+            return ret;
+        }
+    }
+    s->in_bytes += len;
+    return 0;
+}
+
+/**
+ * @brief Writes the pending run and the last block of output
+ *
+ * @return 0, or what the sink returned if it failed
+ */
+int rle_stream_finish(rle_stream_t *s) {
+    int ret;
+
+    if (s->count && (ret = _rle_write_run(s)) < 0) {
+        return ret;
+    }
+    s->out_bytes += s->fill;
+    return _rle_flush(s->out, &s->fill, s->sink, s->arg);
+}
+
+/**
+ * @brief Starts decoding a new stream
+ *
+ * @param d     decoder state
+ * @param sink  receives the decoded bytes
+ * @param arg   passed to sink
+ */
+void rle_decoder_init(rle_decoder_t *d, rle_sink_t sink, void *arg) {
+    memset(d, 0, sizeof(*d));
+    d->sink = sink;
+    d->arg = arg;
+    d->state = RLE_DEC_MARKER;
+}
+
+/*
+ * Returns 1 if the sink asked for a rest and the rest of the run is held
+ * back for the next feed
+ */
+static int _rle_emit(rle_decoder_t *d, uint8_t symbol, uint32_t n) {
+    while (n > 0) {
+        uint32_t room = RLE_STREAM_OUT_SIZE - d->fill;
+        uint32_t k = (n < room) ? n : room;
+
+        memset(d->out + d->fill, symbol, k);
+        d->fill += k;
+        d->out_bytes += k;
+        n -= k;
+        if (d->fill == RLE_STREAM_OUT_SIZE) {
+            int ret = _rle_flush(d->out, &d->fill, d->sink, d->arg);
+            if (ret < 0) {
+                return ret;
+            }
+            if (ret > 0 && n > 0) {
+                d->symbol = symbol;
+                d->count = n;
+                d->state = RLE_DEC_RUN;
+                return 1;
+            }
+        }
+    }
+    return 0;
+}
+
+/**
+ * @brief Decodes the next chunk of a stream, codes can span chunks
+ *
+ * A sink returning > 0 stops the decoder after the byte it was on, with the
+ * rest of a long run held back. Feed it again, from the next byte or with
+ * no input, to carry on.
+ *
+ * @return 0, 1 if it stopped for the sink, or what the sink returned if it
+ *         failed
+ */
+int rle_decoder_feed(rle_decoder_t *d, const uint8_t *in, uint32_t len) {
+    int ret = 0;
+
+    if (d->state == RLE_DEC_RUN) {
+        d->state = RLE_DEC_DATA;
+        ret = _rle_emit(d, d->symbol, d->count);
+    }
+    for (uint32_t i = 0; i < len && ret == 0; i++) {
+        uint8_t c = in[i];
+
+        switch (d->state) {
+        case RLE_DEC_MARKER:
+            d->marker = c;
+            d->state = RLE_DEC_DATA;
+            break;
+        case RLE_DEC_DATA:
+            if (c == d->marker) {
+                d->state = RLE_DEC_COUNT;
+            } else {
+                ret = _rle_emit(d, c, 1);
+            }
+            break;
+        case RLE_DEC_COUNT:
+            if (c <= 2) {
+                // counts 0 to 2 repeat the marker itself
+                d->state = RLE_DEC_DATA;
+                ret = _rle_emit(d, d->marker, c + 1);
+            } else if (c & 0x80) {
+                d->count = (c & 0x7f) << 8;
+                d->state = RLE_DEC_LONG;
+            } else {
+                d->count = c;
+                d->state = RLE_DEC_SYMBOL;
+            }
+            break;
+        case RLE_DEC_LONG:
+            d->count |= c;
+            d->state = (d->count == 0) ? RLE_DEC_MARKER : RLE_DEC_SYMBOL; // 0 is the end code
+            break;
+        case RLE_DEC_SYMBOL:
+            d->state = RLE_DEC_DATA;
+            ret = _rle_emit(d, c, d->count + 1);
+            break;
+        }
+    }
+    return ret;
+}
+
+/**
+ * @brief Passes on the last decoded bytes
+ *
+ * @return 0, -1 if the stream ended inside a code, 1 if a held run stopped
+ *         for the sink again, or what the sink returned if it failed
+ */
+int rle_decoder_finish(rle_decoder_t *d) {
+    int ret = (d->state == RLE_DEC_RUN) ? rle_decoder_feed(d, NULL, 0) : 0;
+
+    if (ret != 0) {
+        return ret;
+    }
+    ret = _rle_flush(d->out, &d->fill, d->sink, d->arg);
+
+    if (ret < 0) {
+        return ret;
+    }
+    return (d->state == RLE_DEC_DATA || d->state == RLE_DEC_MARKER) ? 0 : -1;
+}
@@ -3,21 +3,23 @@
 #include <stdio.h>
 #include "stm32l0xx_hal.h"
 #include "arducam.h"
+#include "sccb_table.h"
 #include "debug.h"
 extern I2C_HandleTypeDef hi2c2;
 
 #define SCCB_READ 1
 // arducam functions
 /**
- * @brief Writes Arducam Sensor i2c register
+ * @brief Writes Arducam Sensor i2c register, unless it already holds regDat
  *
  * @param regID target register ID; 16 bit
  * @param regDat register data to write; 8 bit
  * @param sensor target sensor
  */
 void wrSensorReg16_8(uint16_t regID, uint8_t regDat, uint8_t sensor) {
-    i2c2_write16_8(sensor, regID, regDat);
-    HAL_Delay(1);
+    if (sccb_write_reg(&hi2c2, sensor, regID, regDat) < 0) {
+        iris_log("I2C16_8 write to 0x%x register 0x%x failed\r\n", sensor, regID);
+    }
 }
 
 /**
@@ -26,24 +28,44 @@ void wrSensorReg16_8(uint16_t regID, uint8_t regDat, uint8_t sensor) {
  * @param reglist sensor_reg struct containing registers and values to write to sensor
  * @param sensor  target sensor
  */
-void wrSensorRegs16_8(struct sensor_reg reglist[], uint8_t sensor) {
-    struct sensor_reg *curr = reglist;
-    for (curr = reglist; curr->reg != 0xffff; curr++) {
-        wrSensorReg16_8(curr->reg, curr->val, sensor);
+void wrSensorRegs16_8(const struct sensor_reg reglist[], uint8_t sensor) {
+    sccb_stats_t stats;
+    if (sccb_write_table(&hi2c2, reglist, &sensor, 1, &stats) < 0) {
+        iris_log("I2C register table: %d writes failed\r\n", stats.failed);
     }
-    return;
 }
 
 /**
- * @brief reads sensor reg
+ * @brief Writes a run encoded register table to several sensors at once
+ *
+ * Each run goes out as auto-increment writes, to every sensor in turn, and
+ * delay entries are waited once for all. Registers already holding their
+ * value are skipped.
+ *
+ * @param packed  table from ov5642_regs_packed.h
+ * @param sensors target sensors
+ * @param count   number of target sensors
+ * @return number of I2C writes issued
+ */
+int wrSensorRegsPacked16_8(const uint8_t *packed, const uint8_t *sensors, int count) {
+    sccb_stats_t stats;
+    if (sccb_write_packed(&hi2c2, packed, sensors, count, &stats) < 0) {
+        iris_log("I2C register table: %d writes failed\r\n", stats.failed);
+    }
+    return stats.writes;
+}
+
+/**
+ * @brief reads sensor reg, from the register shadow when it holds it
  *
  * @param regID target register ID; 16 bit
  * @param regDat register data; 8 bit
  * @param sensor target sensor
  */
 void rdSensorReg16_8(uint16_t regID, uint8_t *regDat, uint8_t sensor) {
-    i2c2_read16_8(sensor, regID, regDat);
-    return;
+    if (sccb_read_reg(&hi2c2, sensor, regID, regDat) < 0) {
+        iris_log("I2C16_8 read from 0x%x register 0x%x failed\r\n", sensor, regID);
+    }
 }
 
 // I2C2 Functions
@@ -0,0 +1,276 @@
+/*
+ * sccb_table.c
+ *
+ * Writes OV5642 register tables a run at a time. The sensor increments its
+ * register address after every data byte, so N consecutive registers cost
+ * one start, device address and 16 bit register address instead of N. The
+ * run encoded tables store the runs the same way, so they are written
+ * straight from flash.
+ *
+ * The shadow is a small direct mapped cache of register values per sensor.
+ * A register missing from it is simply written or read over the bus, so
+ * its size only decides how much traffic is saved. It is dropped when the
+ * sensor is reset or powered off.
+ */
+#include <string.h>
+
+#include "sccb_table.h"
+
+#define SCCB_SYS_CTL0 0x3008 // System Control, bit 7 is software reset
+#define SCCB_RESET_BIT 0x80
+
+typedef struct {
+    uint8_t addr;                    // 7 bit sensor address, 0 unused
+    uint16_t reg[SCCB_SHADOW_SLOTS]; // 0 empty, no OV5642 register lives there
+    uint8_t val[SCCB_SHADOW_SLOTS];
+} sccb_shadow_t;
+
+static sccb_shadow_t shadows[SCCB_SHADOW_SENSORS];
+
+/*
+ * Registers the sensor changes by itself, AWB and AEC/AGC results, and the
+ * reset and power down control. They are never taken from the shadow.
+ */
+static int _sccb_volatile(uint16_t reg) {
+    return reg == SCCB_SYS_CTL0 || (reg >= 0x3400 && reg <= 0x350f);
+}
+
+static inline uint32_t _sccb_slot(uint16_t reg) { return (reg ^ (reg >> 5)) & (SCCB_SHADOW_SLOTS - 1); }
+
+static sccb_shadow_t *_sccb_shadow(uint8_t sensor) {
+    sccb_shadow_t *unused = NULL;
+
+    for (int i = 0; i < SCCB_SHADOW_SENSORS; i++) {
+        if (shadows[i].addr == sensor) {
+            return &shadows[i];
+        }
+        if (!unused && shadows[i].addr == 0) {
+            unused = &shadows[i];
+        }
+    }
+    if (unused) {
+        unused->addr = sensor;
+    }
+    return unused;
+}
+
+static int _sccb_shadow_get(const sccb_shadow_t *shadow, uint16_t reg, uint8_t *val) {
+    uint32_t slot = _sccb_slot(reg);
+
+    if (!shadow || reg == 0 || _sccb_volatile(reg) || shadow->reg[slot] != reg) {
+        return 0;
+    }
+    *val = shadow->val[slot];
+    return 1;
+}
+
+static void _sccb_shadow_put(sccb_shadow_t *shadow, uint16_t reg, const uint8_t *val) {
+    uint32_t slot = _sccb_slot(reg);
+
+    if (!shadow || _sccb_volatile(reg)) {
+        return;
+    }
+    if (val) {
+        shadow->reg[slot] = reg;
+        shadow->val[slot] = *val;
+    } else if (shadow->reg[slot] == reg) {
+        shadow->reg[slot] = 0; // value unknown after a failed write
+    }
+}
+
+/**
+ * @brief Forgets every register value held for a sensor
+ *
+ * Call when the sensor is reset or loses power.
+ *
+ * @param sensor 7 bit sensor address
+ */
+void sccb_shadow_invalidate(uint8_t sensor) {
+    for (int i = 0; i < SCCB_SHADOW_SENSORS; i++) {
+        if (shadows[i].addr == sensor) {
+            memset(shadows[i].reg, 0, sizeof(shadows[i].reg));
+        }
+    }
+}
+
+/*
+ * Collects the run of consecutive registers starting at entry, at most
+ * SCCB_BURST_MAX of them. Repeated or out of order registers end the run so
+ * the table's write order is kept.
+ */
+static int _sccb_run(const struct sensor_reg *entry, uint8_t *data) {
+    int n = 0;
+
+    while (n < SCCB_BURST_MAX && entry[n].reg < REG_DELAY && entry[n].reg == entry[0].reg + n) {
+        data[n] = (uint8_t)entry[n].val;
+        n++;
+    }
+    return n;
+}
+
+/*
+ * Writes the part of a run that differs from the shadow, from the first
+ * register that differs to the last one.
+ */
+static void _sccb_write_run(I2C_HandleTypeDef *hi2c, uint8_t sensor, uint16_t reg, const uint8_t *data, int n,
+                            sccb_stats_t *stats) {
+    sccb_shadow_t *shadow = _sccb_shadow(sensor);
+    int first = -1, last = -1, reset = 0;
+    uint8_t held;
+
+    for (int i = 0; i < n; i++) {
+        if (!_sccb_shadow_get(shadow, reg + i, &held) || held != data[i]) {
+            first = (first < 0) ? i : first;
+            last = i;
+        }
+        reset |= (reg + i == SCCB_SYS_CTL0) && (data[i] & SCCB_RESET_BIT);
+    }
+    if (first < 0) {
+        stats->skipped += n;
+        return;
+    }
+    stats->skipped += n - (last - first + 1);
+    stats->writes++;
+
+    int ok = HAL_I2C_Mem_Write(hi2c, sensor << 1, reg + first, I2C_MEMADD_SIZE_16BIT, (uint8_t *)data + first,
+                               last - first + 1, SCCB_WRITE_TIMEOUT) == HAL_OK;
+    if (!ok) {
+        stats->failed++;
+    }
+    if (reset) {
+        sccb_shadow_invalidate(sensor);
+        return;
+    }
+    for (int i = first; i <= last; i++) {
+        _sccb_shadow_put(shadow, reg + i, ok ? &data[i] : NULL);
+    }
+}
+
+/*
+ * Waits out a delay entry, unless nothing was written since the last one
+ */
+static void _sccb_delay(uint16_t ms, const sccb_stats_t *stats, uint16_t *settled) {
+    if (stats->writes != *settled) {
+        HAL_Delay(ms);
+        *settled = stats->writes;
+    }
+}
+
+/**
+ * @brief Writes a register table to one or more sensors
+ *
+ * Each run is written to every sensor before moving on. A REG_DELAY entry
+ * waits its val in ms once for all of them, and only if a write went out
+ * since the start of the table or the last delay.
+ *
+ * @param hi2c      I2C bus the sensors are on
+ * @param reglist   table ending in REG_LIST_END
+ * @param sensors   7 bit sensor addresses
+ * @param count     number of sensors
+ * @param stats     counts of writes, skipped registers and failures, or NULL
+ * @return 0 on success, -1 if any write failed
+ */
+int sccb_write_table(I2C_HandleTypeDef *hi2c, const struct sensor_reg reglist[], const uint8_t *sensors, int count,
+                     sccb_stats_t *stats) {
+    const struct sensor_reg *curr = reglist;
+    uint8_t data[SCCB_BURST_MAX];
+    sccb_stats_t local = {0};
+    uint16_t settled = 0; // writes issued before the last delay
+
+    while (curr->reg != REG_LIST_END) {
+        if (curr->reg == REG_DELAY) {
+            _sccb_delay(curr->val, &local, &settled);
+            curr++;
+            continue;
+        }
+        int n = _sccb_run(curr, data);
+        for (int i = 0; i < count; i++) {
+            _sccb_write_run(hi2c, sensors[i], curr->reg, data, n, &local);
+        }
+        curr += n;
+    }
+    if (stats) {
+        *stats = local;
+    }
+    return local.failed ? -1 : 0;
+}
+
+/**
+ * @brief Writes a run encoded register table to one or more sensors
+ *
+ * Same as sccb_write_table, runs longer than SCCB_BURST_MAX are split.
+ *
+ * @param hi2c      I2C bus the sensors are on
+ * @param packed    table as generated by host/ov5642_pack
+ * @param sensors   7 bit sensor addresses
+ * @param count     number of sensors
+ * @param stats     counts of writes, skipped registers and failures, or NULL
+ * @return 0 on success, -1 if any write failed
+ */
+int sccb_write_packed(I2C_HandleTypeDef *hi2c, const uint8_t *packed, const uint8_t *sensors, int count,
+                      sccb_stats_t *stats) {
+    const uint8_t *p = packed;
+    sccb_stats_t local = {0};
+    uint16_t settled = 0;
+    uint16_t reg = 0; // start of the previous run, for its page
+
+    while (*p != SCCB_PACKED_END) {
+        uint8_t op = *p++;
+        if (op & SCCB_PACKED_DELAY) {
+            _sccb_delay((uint16_t)((op & ~SCCB_PACKED_DELAY) << 8 | p[0]), &local, &settled);
+            p++;
+            continue;
+        }
+        if (op & SCCB_PACKED_PAGE) {
+            reg = (reg & 0xff00) | p[0];
+            p++;
+        } else {
+            reg = (uint16_t)(p[0] << 8 | p[1]);
+            p += 2;
+        }
+        int n = op & SCCB_PACKED_RUN_MAX;
+        for (int done = 0; done < n; done += SCCB_BURST_MAX) {
+            int len = (n - done < SCCB_BURST_MAX) ? n - done : SCCB_BURST_MAX;
+            for (int i = 0; i < count; i++) {
+                _sccb_write_run(hi2c, sensors[i], reg + done, p + done, len, &local);
+            }
+        }
+        p += n;
+    }
+    if (stats) {
+        *stats = local;
+    }
+    return local.failed ? -1 : 0;
+}
+
+/**
+ * @brief Writes one register unless the shadow already holds the value
+ *
+ * @return 1 if written, 0 if skipped, -1 if the write failed
+ */
+int sccb_write_reg(I2C_HandleTypeDef *hi2c, uint8_t sensor, uint16_t reg, uint8_t val) {
+    const struct sensor_reg table[] = {{reg, val}, {REG_LIST_END, 0xff}};
+    sccb_stats_t stats;
+
+    if (sccb_write_table(hi2c, table, &sensor, 1, &stats) < 0) {
+        return -1;
+    }
+    return stats.writes;
+}
+
+/**
+ * @brief Reads one register, from the shadow when it holds it
+ *
+ * @return 0 on success, -1 if the read failed
+ */
+int sccb_read_reg(I2C_HandleTypeDef *hi2c, uint8_t sensor, uint16_t reg, uint8_t *val) {
+    for (int i = 0; i < SCCB_SHADOW_SENSORS; i++) {
+        if (shadows[i].addr == sensor && _sccb_shadow_get(&shadows[i], reg, val)) {
+            return 0;
+        }
+    }
+    if (HAL_I2C_Mem_Read(hi2c, sensor << 1, reg, I2C_MEMADD_SIZE_16BIT, val, 1, SCCB_WRITE_TIMEOUT) != HAL_OK) {
+        return -1;
+    }
+    return 0;
+}
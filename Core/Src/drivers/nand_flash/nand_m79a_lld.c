@@ -23,10 +23,47 @@
  * to M79a NAND Flash via SPI.
  */
 
+#include <string.h>
 #include "nand_m79a_lld.h"
 
 static NAND_ReturnType __Status_Reg_2_ReturnType(uint8_t status_reg);
 
+/* Bad block table. Bit n is set if block n is bad. */
+static uint8_t bad_block_table[BAD_BLOCK_TABLE_SIZE];
+static bool bad_block_table_valid = false;
+
+/* Sequential read state. When active, stream_row is being loaded into the
+ * data register by READ PAGE CACHE RANDOM. */
+static bool stream_active = false;
+static uint32_t stream_row;
+
+/* Page held in the cache register, so a read that picks up in the same page
+ * skips the PAGE READ. Any program, erase or reset drops it. */
+static bool cache_valid = false;
+static uint32_t cache_row;
+
+static void __end_sequential_read(void);
+
+/* Asynchronous page operation started by NAND_Page_Read_Async or
+ * NAND_Page_Program_Async, finished by NAND_Async_Complete. */
+typedef enum { ASYNC_NONE, ASYNC_READ, ASYNC_PROGRAM } AsyncOp;
+static AsyncOp async_op = ASYNC_NONE;
+static uint32_t async_row;
+static volatile NAND_SPI_ReturnType async_status;
+static bool async_executed; // PROGRAM EXECUTE of the asynchronous program was sent
+static NAND_SPI_Callback async_done;
+static void *async_arg;
+/* Failure of an asynchronous program that another NAND call finished,
+ * returned by the next NAND_Async_Complete. */
+static NAND_ReturnType async_result = Ret_Success;
+
+static void __end_async(void);
+static void __async_program_loaded(NAND_SPI_ReturnType status, void *arg);
+static void __async_program_exec(void);
+static NAND_SPI_ReturnType __program_exec_send(uint32_t row);
+static NAND_ReturnType __program_finish(void);
+static NAND_ReturnType __program_execute(uint32_t row);
+
 /**
  * @brief Initializes the NAND. Steps: Reset device and check for correct device IDs.
  * @note  This function must be called first when powered on.
@@ -56,8 +93,11 @@ NAND_ReturnType NAND_Init(void) {
         return Ret_Failed;
     }
 
+    /* The bad block table is built from the markers on first use, unless a
+     * saved copy is handed over with NAND_Load_Bad_Block_Table first. */
+    bad_block_table_valid = false;
+
     // TODO:
-    // build bad block table
     // finally, run power on self test (POST)
 
     return Ret_Success;
@@ -76,6 +116,7 @@ NAND_ReturnType NAND_Init(void) {
  */
 NAND_ReturnType NAND_Reset(void) {
 
+    cache_valid = false;
     uint8_t command = SPI_NAND_RESET;
     SPI_Params transmit = {.buffer = &command, .length = 1};
 
@@ -107,6 +148,8 @@ NAND_ReturnType NAND_Reset(void) {
 #define MAX_ATTEMPTS 10000
 
 NAND_ReturnType NAND_Wait_Until_Ready(void) {
+    stream_active = false; // Any pending cache read load finishes here
+
     uint8_t timeout_counter = 0;
 
     /* SPI Transaction set up for NAND_SPI_Receive */
@@ -122,6 +165,24 @@ NAND_ReturnType NAND_Wait_Until_Ready(void) {
     return ret;
 }
 
+/**
+ * @brief Waits until the cache register is ready to be read.
+ * @note Only polls OIP, so an array load started by READ PAGE CACHE RANDOM
+ *  (CRBSY set) can keep going in the background.
+ *
+ * @param[in] None
+ * @return NAND_ReturnType
+ */
+static NAND_ReturnType __Wait_Until_Cache_Ready(void) {
+    uint8_t data_rx = 0;
+    do {
+        if (NAND_Get_Features(SPI_NAND_STATUS_REG_ADDR, &data_rx) != Ret_Success) {
+            return Ret_Failed;
+        }
+    } while (CHECK_OIP(data_rx));
+    return Ret_Success;
+}
+
 /**
  * @brief Send a dummy byte to NAND via SPI
  *
@@ -188,6 +249,7 @@ NAND_ReturnType NAND_Read_Param_Page(NAND_Parameter_Page_t *parameters) {
     }
 
     rc = NAND_Cache_Read(0, sizeof(*parameters), (uint8_t *)parameters);
+    cache_valid = false; // it holds the parameter page, not page 1
 
     rc |= NAND_Set_Features(SPI_NAND_CFG_REG_ADDR, cfg_data);
     return rc;
@@ -293,17 +355,26 @@ NAND_ReturnType NAND_Cache_Read(uint16_t col, uint16_t length, uint8_t *buffer)
 }
 
 NAND_ReturnType NAND_Page_Load(uint32_t paddr) {
+    __end_async();
+    __end_sequential_read();
+
     /* PAGE READ. See datasheet page 16 for details */
     uint8_t command_page_read[4] = {SPI_NAND_PAGE_READ, BYTE_2(paddr), BYTE_1(paddr), BYTE_0(paddr)};
 
     SPI_Params tx_page_read = {.buffer = command_page_read, .length = 4};
 
+    cache_valid = false;
     if (NAND_SPI_Send(&tx_page_read) != SPI_OK) {
         return Ret_ReadFailed;
     }
 
     /* Command 2: Wait for data to be loaded into cache */
-    return NAND_Wait_Until_Ready();
+    NAND_ReturnType status = NAND_Wait_Until_Ready();
+    if (status == Ret_Success) {
+        cache_valid = true;
+        cache_row = paddr;
+    }
+    return status;
 }
 
 /**
@@ -340,6 +411,120 @@ NAND_ReturnType NAND_Page_Read(PhysicalAddrs *addr, uint16_t length, uint8_t *bu
     return NAND_Cache_Read(col, length, buffer);
 }
 
+/**
+ * @brief Read bytes from the spare area of a page.
+ * @note The first spare byte is the bad block marker.
+ *
+ * @param addr[in]      Pointer to PhysicalAddrs struct, column is ignored
+ * @param offset[in]    Offset into the spare area
+ * @param length[in]    Number of bytes to read
+ * @param buffer[out]   Pointer to contents read from the spare area
+ * @return NAND_ReturnType
+ */
+NAND_ReturnType NAND_Spare_Read(PhysicalAddrs *addr, uint16_t offset, uint16_t length, uint8_t *buffer) {
+    NAND_ReturnType status;
+
+    if (offset + length > PAGE_SPARE_SIZE) {
+        return Ret_ReadFailed;
+    }
+    uint32_t row = ((0x7ff & addr->block) << 6) | (0x3f & addr->page);
+    if ((status = NAND_Page_Load(row)) != Ret_Success) {
+        return status;
+    }
+    return NAND_Spare_Read_Cache(addr, offset, length, buffer);
+}
+
+/**
+ * @brief Read bytes from the spare area of the page that is already in the
+ *  cache register, e.g. right after NAND_Page_Read_Sequential.
+ *
+ * @param addr[in]      Page in the cache register
+ * @param offset[in]    Offset into the spare area
+ * @param length[in]    Number of bytes to read
+ * @param buffer[out]   Pointer to contents read from the spare area
+ * @return NAND_ReturnType
+ */
+NAND_ReturnType NAND_Spare_Read_Cache(PhysicalAddrs *addr, uint16_t offset, uint16_t length, uint8_t *buffer) {
+    if (offset + length > PAGE_SPARE_SIZE) {
+        return Ret_ReadFailed;
+    }
+    uint32_t plane = addr->block & 1;
+    uint32_t col = (PAGE_DATA_SIZE + offset) | (plane << 12);
+    return NAND_Cache_Read(col, length, buffer);
+}
+
+/**
+ * @brief Read a page as part of a sequential read, starting the array load
+ *  of the next page before the current one is clocked out.
+ * @note Command sequence:
+ *          1) PAGE READ of addr, unless the previous call already started it
+ *          2) READ PAGE CACHE RANDOM with next, or READ PAGE CACHE LAST if
+ *             there is no next page. Moves addr into the cache register.
+ *          3) Wait until OIP clears. CRBSY stays set while next loads.
+ *          4) Read addr from cache
+ *
+ *  Any other command ends the sequence, after waiting for the pending load.
+ *
+ * @param addr[in]      Page to read
+ * @param next[in]      Page that will be read next, or NULL if addr is the last
+ * @param length[in]    Number of bytes to read
+ * @param buffer[out]   Pointer to contents read from page
+ * @return NAND_ReturnType
+ */
+NAND_ReturnType NAND_Page_Read_Sequential(PhysicalAddrs *addr, PhysicalAddrs *next, uint16_t length,
+                                          uint8_t *buffer) {
+    NAND_ReturnType status;
+
+    if (length > PAGE_DATA_SIZE) {
+        return Ret_ReadFailed;
+    }
+    uint32_t plane = addr->block & 1;
+    uint32_t row = ((0x7ff & addr->block) << 6) | (0x3f & addr->page);
+
+    if (!stream_active && cache_valid && cache_row == row) {
+        /* Still in the cache from the last read, e.g. a read of part of a page */
+        __end_async();
+    } else if (!stream_active || stream_row != row) {
+        /* Not streaming yet: load addr directly into the cache */
+        if ((status = NAND_Page_Load(row)) != Ret_Success) {
+            return status;
+        }
+    }
+
+    if (next) {
+        uint32_t next_row = ((0x7ff & next->block) << 6) | (0x3f & next->page);
+        uint8_t command[4] = {SPI_NAND_READ_PAGE_CACHE_RANDOM, BYTE_2(next_row), BYTE_1(next_row),
+                              BYTE_0(next_row)};
+        SPI_Params tx = {.buffer = command, .length = 4};
+        cache_valid = false;
+        if (NAND_SPI_Send(&tx) != SPI_OK) {
+            stream_active = false;
+            return Ret_ReadFailed;
+        }
+        stream_active = true;
+        stream_row = next_row;
+        if ((status = __Wait_Until_Cache_Ready()) != Ret_Success) {
+            stream_active = false;
+            return status;
+        }
+    } else if (stream_active) {
+        uint8_t command = SPI_NAND_READ_PAGE_CACHE_LAST;
+        SPI_Params tx = {.buffer = &command, .length = 1};
+        stream_active = false;
+        if (NAND_SPI_Send(&tx) != SPI_OK) {
+            return Ret_ReadFailed;
+        }
+        if ((status = NAND_Wait_Until_Ready()) != Ret_Success) {
+            return status;
+        }
+        cache_valid = true;
+        cache_row = row;
+    }
+
+    uint32_t col = addr->column | (plane << 12);
+    return NAND_Cache_Read(col, length, buffer);
+}
+
 /******************************************************************************
  *                              Write Operations
  *****************************************************************************/
@@ -364,9 +549,33 @@ NAND_ReturnType NAND_Page_Read(PhysicalAddrs *addr, uint16_t length, uint8_t *bu
  * @return NAND_ReturnType
  */
 NAND_ReturnType NAND_Page_Program(PhysicalAddrs *addr, uint16_t length, uint8_t *buffer) {
+    return NAND_Page_Program_Spare(addr, length, buffer, 0, 0, NULL);
+}
+
+/**
+ * @brief Write data to a page and to its spare area in one program operation.
+ * @note Same as NAND_Page_Program, with a PROGRAM LOAD RANDOM DATA of the
+ *  spare bytes before PROGRAM EXECUTE. The first spare byte is the bad block
+ *  marker, don't write it.
+ *
+ * @param addr[in]          Pointer to PhysicalAddrs struct
+ * @param length[in]        Number of bytes to write
+ * @param buffer[in]        Pointer to contents to write to the page
+ * @param spare_offset[in]  Offset into the spare area
+ * @param spare_length[in]  Number of spare bytes to write, may be 0
+ * @param spare[in]         Pointer to contents to write to the spare area
+ * @return NAND_ReturnType
+ */
+NAND_ReturnType NAND_Page_Program_Spare(PhysicalAddrs *addr, uint16_t length, uint8_t *buffer, uint16_t spare_offset,
+                                        uint16_t spare_length, uint8_t *spare) {
     if (length > PAGE_DATA_SIZE) {
         return Ret_WriteFailed;
     }
+    if (spare_offset + spare_length > PAGE_SPARE_SIZE) {
+        return Ret_WriteFailed;
+    }
+    __end_async();
+    __end_sequential_read();
 
     /* Command 1: WRITE ENABLE */
     __write_enable();
@@ -386,27 +595,220 @@ NAND_ReturnType NAND_Page_Program(PhysicalAddrs *addr, uint16_t length, uint8_t
         return Ret_WriteFailed;
     }
 
+    /* PROGRAM LOAD RANDOM DATA keeps the rest of the cache register */
+    if (spare_length > 0) {
+        uint32_t spare_col = (PAGE_DATA_SIZE + spare_offset) | (plane << 12);
+        uint8_t command_spare[3] = {SPI_NAND_PROGRAM_LOAD_RANDOM_X1, BYTE_1(spare_col), BYTE_0(spare_col)};
+        SPI_Params tx_spare_cmd = {.buffer = command_spare, .length = 3};
+        SPI_Params tx_spare = {.buffer = spare, .length = spare_length};
+
+        if (NAND_SPI_Send_Command_Data(&tx_spare_cmd, &tx_spare) != SPI_OK) {
+            return Ret_WriteFailed;
+        }
+    }
+
     /* Command 3: PROGRAM EXECUTE. See datasheet page 31 for details */
     uint32_t row = 0;
     row = (0x7ff & addr->block) << 6;
     row |= (0x3f & addr->page);
 
-    uint8_t command_exec[4] = {SPI_NAND_PROGRAM_EXEC, BYTE_2(row), BYTE_1(row), BYTE_0(row)};
-    SPI_Params exec_cmd = {.buffer = command_exec, .length = 4};
+    return __program_execute(row);
+}
 
-    if (NAND_SPI_Send(&exec_cmd) != SPI_OK) {
-        return Ret_Failed;
+/******************************************************************************
+ *                          Asynchronous Operations
+ *****************************************************************************/
+
+/**
+ * @brief Start reading a page into buffer. Returns once the page is in the
+ *  cache register and the transfer out of it is running on DMA.
+ * @note Only one asynchronous operation runs at a time. Finish it with
+ *  NAND_Async_Complete, any other NAND call finishes it first. buffer must
+ *  stay valid until then.
+ *
+ * @param addr[in]      Pointer to PhysicalAddrs struct
+ * @param length[in]    Number of bytes to read
+ * @param buffer[out]   Pointer to contents read from page
+ * @param done[in]      Called from the DMA interrupt once buffer is filled, may be NULL
+ * @param arg[in]       Passed to done
+ * @return NAND_ReturnType
+ */
+NAND_ReturnType NAND_Page_Read_Async(PhysicalAddrs *addr, uint16_t length, uint8_t *buffer, NAND_SPI_Callback done,
+                                     void *arg) {
+    NAND_ReturnType status;
+
+    if (length > PAGE_DATA_SIZE) {
+        return Ret_ReadFailed;
     }
+    uint32_t plane = addr->block & 1;
+    uint32_t row = ((0x7ff & addr->block) << 6) | (0x3f & addr->page);
 
-    /* Command 3: wait for device to be ready again */
-    NAND_ReturnType status = NAND_Wait_Until_Ready();
+    if ((status = NAND_Page_Load(row)) != Ret_Success) {
+        return status;
+    }
 
-    /* Command 4: WRITE DISABLE */
-    __write_disable();
-    if (status != Ret_Success) {
-        NAND_Reset();
+    uint32_t col = addr->column | (plane << 12);
+    uint8_t command_cache_read[4] = {SPI_NAND_READ_CACHE_X1, BYTE_1(col), BYTE_0(col), DUMMY_BYTE};
+    SPI_Params tx_cache_read = {.buffer = command_cache_read, .length = 4};
+    SPI_Params rx_cache_read = {.buffer = buffer, .length = length};
+
+    async_op = ASYNC_READ;
+    if (NAND_SPI_SendReceive_DMA(&tx_cache_read, &rx_cache_read, done, arg) != SPI_OK) {
+        async_op = ASYNC_NONE;
+        return Ret_ReadFailed;
     }
-    return status;
+    return Ret_Success;
+}
+
+/**
+ * @brief Start writing buffer to a page. Returns once the PROGRAM LOAD of
+ *  the data is running on DMA.
+ * @note NAND_Async_Execute sends PROGRAM EXECUTE once the data is loaded,
+ *  so the program runs in the background too.
+ *  NAND_Async_Complete waits for it and reports whether it passed. Only one
+ *  asynchronous operation runs at a time, any other NAND call finishes it
+ *  first. buffer must stay valid until done is called.
+ *
+ * @param addr[in]      Pointer to PhysicalAddrs struct
+ * @param length[in]    Number of bytes to write
+ * @param buffer[in]    Pointer to contents to write to the page
+ * @param done[in]      Called from the DMA interrupt once buffer is loaded, may be NULL
+ * @param arg[in]       Passed to done
+ * @return NAND_ReturnType
+ */
+NAND_ReturnType NAND_Page_Program_Async(PhysicalAddrs *addr, uint16_t length, uint8_t *buffer,
+                                        NAND_SPI_Callback done, void *arg) {
+    return NAND_Page_Program_Spare_Async(addr, length, buffer, 0, 0, NULL, done, arg);
+}
+
+/**
+ * @brief NAND_Page_Program_Async that also writes the spare area.
+ * @note The spare bytes go first with PROGRAM LOAD, then the data with
+ *  PROGRAM LOAD RANDOM DATA, which keeps them. spare is not used after this
+ *  returns.
+ *
+ * @param addr[in]          Pointer to PhysicalAddrs struct
+ * @param length[in]        Number of bytes to write
+ * @param buffer[in]        Pointer to contents to write to the page
+ * @param spare_offset[in]  Offset into the spare area
+ * @param spare_length[in]  Number of spare bytes to write, may be 0
+ * @param spare[in]         Pointer to contents to write to the spare area
+ * @param done[in]          Called from the DMA interrupt once buffer is loaded, may be NULL
+ * @param arg[in]           Passed to done
+ * @return NAND_ReturnType
+ */
+NAND_ReturnType NAND_Page_Program_Spare_Async(PhysicalAddrs *addr, uint16_t length, uint8_t *buffer,
+                                              uint16_t spare_offset, uint16_t spare_length, uint8_t *spare,
+                                              NAND_SPI_Callback done, void *arg) {
+    if (length > PAGE_DATA_SIZE) {
+        return Ret_WriteFailed;
+    }
+    if (spare_offset + spare_length > PAGE_SPARE_SIZE) {
+        return Ret_WriteFailed;
+    }
+    __end_async();
+    __end_sequential_read();
+
+    /* Command 1: WRITE ENABLE */
+    __write_enable();
+
+    uint32_t plane = addr->block & 1;
+    uint8_t load_cmd = SPI_NAND_PROGRAM_LOAD_X1;
+
+    /* Command 2: PROGRAM LOAD of the spare bytes, clears the rest of the cache register */
+    if (spare_length > 0) {
+        uint32_t spare_col = (PAGE_DATA_SIZE + spare_offset) | (plane << 12);
+        uint8_t command_spare[3] = {SPI_NAND_PROGRAM_LOAD_X1, BYTE_1(spare_col), BYTE_0(spare_col)};
+        SPI_Params tx_spare_cmd = {.buffer = command_spare, .length = 3};
+        SPI_Params tx_spare = {.buffer = spare, .length = spare_length};
+
+        if (NAND_SPI_Send_Command_Data(&tx_spare_cmd, &tx_spare) != SPI_OK) {
+            __write_disable();
+            return Ret_WriteFailed;
+        }
+        load_cmd = SPI_NAND_PROGRAM_LOAD_RANDOM_X1;
+    }
+
+    /* Command 3: PROGRAM LOAD (RANDOM DATA) of the page, the data goes out on DMA */
+    uint32_t col = addr->column | (plane << 12);
+    uint8_t command_load[3] = {load_cmd, BYTE_1(col), BYTE_0(col)};
+    SPI_Params tx_cmd = {.buffer = command_load, .length = 3};
+    SPI_Params tx_data = {.buffer = buffer, .length = length};
+
+    async_op = ASYNC_PROGRAM;
+    async_row = ((0x7ff & addr->block) << 6) | (0x3f & addr->page);
+    async_status = SPI_Fail;
+    async_executed = false;
+    async_done = done;
+    async_arg = arg;
+    if (NAND_SPI_Send_Command_Data_DMA(&tx_cmd, &tx_data, __async_program_loaded, NULL) != SPI_OK) {
+        async_op = ASYNC_NONE;
+        __write_disable();
+        return Ret_WriteFailed;
+    }
+    return Ret_Success;
+}
+
+/**
+ * @brief Returns true while the data of an asynchronous operation is still
+ *  moving on DMA. A program can still be running after that.
+ */
+bool NAND_Async_Busy(void) { return NAND_SPI_Busy(); }
+
+/**
+ * @brief Starts the program of an asynchronous PROGRAM LOAD once its data is
+ *  loaded. The DMA interrupt only records the end of the load, so call this
+ *  from task context while there is other work to overlap tPROG with.
+ *  NAND_Async_Complete starts it too.
+ *
+ * @return false while the load is still running on DMA, true otherwise
+ */
+bool NAND_Async_Execute(void) {
+    if (async_op != ASYNC_PROGRAM || async_executed) {
+        return true;
+    }
+    if (NAND_SPI_Busy()) {
+        return false;
+    }
+    __async_program_exec();
+    return true;
+}
+
+/**
+ * @brief Finish the asynchronous operation in flight: wait for its DMA
+ *  transfer, then for a program, wait for the device to finish it.
+ *
+ * @return NAND_ReturnType of the operation, or the failure of an earlier
+ *  program another NAND call finished first. Ret_Success if there was none.
+ */
+NAND_ReturnType NAND_Async_Complete(void) {
+    AsyncOp op = async_op;
+    NAND_ReturnType earlier = async_result;
+    NAND_ReturnType status = Ret_Success;
+
+    async_op = ASYNC_NONE;
+    async_result = Ret_Success;
+    NAND_SPI_ReturnType spi_status = NAND_SPI_Wait_DMA();
+
+    switch (op) {
+    case ASYNC_READ:
+        status = (spi_status == SPI_OK) ? Ret_Success : Ret_ReadFailed;
+        break;
+    case ASYNC_PROGRAM:
+        if (spi_status == SPI_OK && !async_executed) {
+            __async_program_exec();
+        }
+        if (spi_status != SPI_OK || async_status != SPI_OK) {
+            __write_disable();
+            status = Ret_WriteFailed;
+        } else {
+            status = __program_finish();
+        }
+        break;
+    default:
+        break;
+    }
+    return (earlier != Ret_Success) ? earlier : status;
 }
 
 /******************************************************************************
@@ -433,6 +835,8 @@ NAND_ReturnType NAND_Page_Program(PhysicalAddrs *addr, uint16_t length, uint8_t
  * @return NAND_ReturnType
  */
 NAND_ReturnType NAND_Block_Erase(PhysicalAddrs *addr) {
+    __end_async();
+    __end_sequential_read();
 
     /* Command 1: WRITE ENABLE */
     __write_enable();
@@ -468,12 +872,10 @@ NAND_ReturnType NAND_Block_Erase(PhysicalAddrs *addr) {
  * True: Block is bad
  */
 bool NAND_is_Bad_Block(int block) {
-    PhysicalAddrs addr = {0};
-    addr.block = block;
-    addr.column = 2048;
-    uint8_t marker = 0xFF;
-    NAND_Page_Read(&addr, sizeof(marker), &marker);
-    return marker != 0xFF;
+    if (!bad_block_table_valid) {
+        NAND_Build_Bad_Block_Table();
+    }
+    return (bad_block_table[block >> 3] >> (block & 7)) & 1;
 }
 
 NAND_ReturnType NAND_Mark_Bad_Block(int block) {
@@ -481,12 +883,72 @@ NAND_ReturnType NAND_Mark_Bad_Block(int block) {
     addr.block = block;
     addr.column = 2048;
     uint8_t marker = 0x00;
+    bad_block_table[block >> 3] |= 1 << (block & 7);
     // It seems that sometimes we can write a couple bits to a bad block
     // Really all the marker needs to be is not 0xFF
     // The datasheet seems confident that this will work
     return NAND_Page_Program(&addr, sizeof(marker), &marker);
 }
 
+/**
+ * @brief Builds the bad block table from the marker in the first spare byte
+ *        of each block.
+ * @note Reads the first page of every block, so it is slow. Use
+ *       NAND_Load_Bad_Block_Table when a saved copy is available.
+ *
+ * @return NAND_ReturnType
+ */
+NAND_ReturnType NAND_Build_Bad_Block_Table(void) {
+    PhysicalAddrs addr = {0};
+    addr.column = BAD_BLOCK_BYTE;
+    uint8_t marker;
+
+    memset(bad_block_table, 0, sizeof(bad_block_table));
+    for (int i = 0; i < NUM_BLOCKS; i++) {
+        addr.block = i;
+        marker = 0xFF;
+        NAND_Page_Read(&addr, sizeof(marker), &marker);
+        if (marker != 0xFF) {
+            bad_block_table[i >> 3] |= 1 << (i & 7);
+        }
+    }
+    bad_block_table_valid = true;
+    return Ret_Success;
+}
+
+/**
+ * @brief Replaces the bad block table with a saved copy.
+ *
+ * @param table[in]  BAD_BLOCK_TABLE_SIZE bytes, as returned by NAND_Get_Bad_Block_Table
+ */
+void NAND_Load_Bad_Block_Table(const uint8_t *table) {
+    memcpy(bad_block_table, table, sizeof(bad_block_table));
+    bad_block_table_valid = true;
+}
+
+/**
+ * @brief Returns the bad block table, building it first if needed.
+ *
+ * @return Pointer to BAD_BLOCK_TABLE_SIZE bytes
+ */
+const uint8_t *NAND_Get_Bad_Block_Table(void) {
+    if (!bad_block_table_valid) {
+        NAND_Build_Bad_Block_Table();
+    }
+    return bad_block_table;
+}
+
+uint16_t NAND_Bad_Block_Count(void) {
+    const uint8_t *table = NAND_Get_Bad_Block_Table();
+    uint16_t count = 0;
+    for (int i = 0; i < BAD_BLOCK_TABLE_SIZE; i++) {
+        for (uint8_t bits = table[i]; bits; bits &= bits - 1) {
+            count++;
+        }
+    }
+    return count;
+}
+
 /**
  * THIS WILL ERASE THE BAD BLOCK TABLE. Probably a bad idea, but it's your funeral
  */
@@ -496,6 +958,7 @@ NAND_ReturnType NAND_Erase_All() {
         addr.block = i;
         NAND_Block_Erase(&addr);
     }
+    bad_block_table_valid = false;
     return Ret_Success;
 }
 
@@ -531,6 +994,95 @@ static NAND_ReturnType __Status_Reg_2_ReturnType(uint8_t status_reg) {
     return Ret_Success;
 }
 
+/**
+ * @brief Ends a sequential read by waiting for the pending array load, so the
+ *  next command does not interrupt it.
+ */
+static void __end_sequential_read(void) {
+    if (stream_active) {
+        NAND_Wait_Until_Ready();
+    }
+}
+
+/**
+ * @brief Finishes the asynchronous operation in flight, so the next command
+ *  does not interrupt it. A failed program is kept for the next
+ *  NAND_Async_Complete to return.
+ */
+static void __end_async(void) {
+    if (async_op != ASYNC_NONE) {
+        async_result = NAND_Async_Complete();
+    }
+}
+
+/**
+ * @brief DMA completion of an asynchronous PROGRAM LOAD. Runs in the
+ *  interrupt, so it only records the status; NAND_Async_Execute sends the
+ *  PROGRAM EXECUTE.
+ */
+static void __async_program_loaded(NAND_SPI_ReturnType status, void *arg) {
+    (void)arg;
+    async_status = status;
+    if (async_done) {
+        async_done(status, async_arg);
+    }
+}
+
+/**
+ * @brief Sends the PROGRAM EXECUTE of the loaded asynchronous program.
+ */
+static void __async_program_exec(void) {
+    async_executed = true;
+    if (async_status == SPI_OK) {
+        async_status = __program_exec_send(async_row);
+    }
+}
+
+/**
+ * @brief Sends PROGRAM EXECUTE of the data in the cache register.
+ *
+ * @param row[in]   Block and page address
+ * @return NAND_SPI_ReturnType
+ */
+static NAND_SPI_ReturnType __program_exec_send(uint32_t row) {
+    uint8_t command_exec[4] = {SPI_NAND_PROGRAM_EXEC, BYTE_2(row), BYTE_1(row), BYTE_0(row)};
+    SPI_Params exec_cmd = {.buffer = command_exec, .length = 4};
+
+    return NAND_SPI_Send(&exec_cmd);
+}
+
+/**
+ * @brief PROGRAM EXECUTE of the data in the cache register, then wait for it
+ *  and drop write enable.
+ *
+ * @param row[in]   Block and page address
+ * @return NAND_ReturnType
+ */
+static NAND_ReturnType __program_execute(uint32_t row) {
+    if (__program_exec_send(row) != SPI_OK) {
+        __write_disable();
+        return Ret_Failed;
+    }
+    return __program_finish();
+}
+
+/**
+ * @brief Waits for a program to finish and drops write enable.
+ *
+ * @return NAND_ReturnType
+ */
+static NAND_ReturnType __program_finish(void) {
+    /* wait for device to be ready again */
+    NAND_ReturnType status = NAND_Wait_Until_Ready();
+
+    /* WRITE DISABLE */
+    __write_disable();
+    if (status != Ret_Success) {
+        NAND_Reset();
+    }
+    return status;
+}
+
 /**
  * @brief Enable writing to NAND.
  *
@@ -538,6 +1090,7 @@ static NAND_ReturnType __Status_Reg_2_ReturnType(uint8_t status_reg) {
  * @return NAND_SPI_ReturnType
  */
 NAND_SPI_ReturnType __write_enable(void) {
+    cache_valid = false; // a program loads the cache register, an erase may clear it
     uint8_t command = SPI_NAND_WRITE_ENABLE;
     SPI_Params transmit = {.buffer = &command, .length = 1};
     return NAND_SPI_Send(&transmit);
@@ -31,6 +31,17 @@
 
 static SPI_HandleTypeDef *hspi_nand;
 
+/* DMA transaction in flight. nCS stays low until it completes. */
+static volatile bool dma_busy = false;
+static volatile NAND_SPI_ReturnType dma_status = SPI_OK;
+static NAND_SPI_Callback dma_done;
+static void *dma_arg;
+
+static bool __nand_spi_use_dma(uint16_t length);
+static NAND_SPI_ReturnType __nand_spi_poll_send_receive(SPI_Params *data_send, SPI_Params *data_recv);
+static NAND_SPI_ReturnType __nand_spi_poll_send_command_data(SPI_Params *cmd_send, SPI_Params *data_send);
+static void __nand_spi_dma_complete(NAND_SPI_ReturnType status);
+
 // /**
 //  * @brief Initialize SPI bus to NAND IC.
 //  * @note For reference only. Not to be called.
@@ -113,6 +124,7 @@ void NAND_Wait(uint8_t milliseconds) { HAL_Delay(milliseconds); };
 NAND_SPI_ReturnType NAND_SPI_Send(SPI_Params *data_send) {
     HAL_StatusTypeDef send_status;
 
+    NAND_SPI_Wait_DMA();
     __nand_spi_cs_low();
     send_status = HAL_SPI_Transmit(hspi_nand, data_send->buffer, data_send->length, NAND_SPI_TIMEOUT);
     __nand_spi_cs_high();
@@ -126,24 +138,22 @@ NAND_SPI_ReturnType NAND_SPI_Send(SPI_Params *data_send) {
 
 /**
  * @brief Send and receive data from NAND in one transaction.
+ * @note Long receives run on DMA, this waits for them to finish.
  *
  * @param data_send[in]    Pointer to struct with sending data buffer and length of buffer
  * @param data_recv[out]    Pointer to struct with receive data buffer and length of buffer
  * @return NAND_SPI_ReturnType
  */
 NAND_SPI_ReturnType NAND_SPI_SendReceive(SPI_Params *data_send, SPI_Params *data_recv) {
-    HAL_StatusTypeDef recv_status;
-
-    __nand_spi_cs_low();
-    HAL_SPI_Transmit(hspi_nand, data_send->buffer, data_send->length, NAND_SPI_TIMEOUT);
-    recv_status = HAL_SPI_Receive(hspi_nand, data_recv->buffer, data_recv->length, NAND_SPI_TIMEOUT);
-    __nand_spi_cs_high();
-
-    if (recv_status != HAL_OK) {
-        return SPI_Fail;
-    } else {
-        return SPI_OK;
+    if (__nand_spi_use_dma(data_recv->length)) {
+        if (NAND_SPI_SendReceive_DMA(data_send, data_recv, NULL, NULL) != SPI_OK) {
+            return SPI_Fail;
+        }
+        return NAND_SPI_Wait_DMA();
     }
+
+    NAND_SPI_Wait_DMA();
+    return __nand_spi_poll_send_receive(data_send, data_recv);
 };
 
 /**
@@ -155,6 +165,7 @@ NAND_SPI_ReturnType NAND_SPI_SendReceive(SPI_Params *data_send, SPI_Params *data
 NAND_SPI_ReturnType NAND_SPI_Receive(SPI_Params *data_recv) {
     HAL_StatusTypeDef receive_status;
 
+    NAND_SPI_Wait_DMA();
     __nand_spi_cs_low();
     receive_status = HAL_SPI_Receive(hspi_nand, data_recv->buffer, data_recv->length, NAND_SPI_TIMEOUT);
     __nand_spi_cs_high();
@@ -172,25 +183,165 @@ NAND_SPI_ReturnType NAND_SPI_Receive(SPI_Params *data_recv) {
 
 /**
  * @brief Send a command and associated data to NAND in one transaction
+ * @note Long data runs on DMA, this waits for it to finish.
  *
  * @param cmd_send[in]     Pointer to struct with command and length of command
  * @param data_send[in]    Pointer to struct with data and length of data
  * @return NAND_SPI_ReturnType
  */
 NAND_SPI_ReturnType NAND_SPI_Send_Command_Data(SPI_Params *cmd_send, SPI_Params *data_send) {
-    HAL_StatusTypeDef send_status;
+    if (__nand_spi_use_dma(data_send->length)) {
+        if (NAND_SPI_Send_Command_Data_DMA(cmd_send, data_send, NULL, NULL) != SPI_OK) {
+            return SPI_Fail;
+        }
+        return NAND_SPI_Wait_DMA();
+    }
+
+    NAND_SPI_Wait_DMA();
+    return __nand_spi_poll_send_command_data(cmd_send, data_send);
+};
+
+/******************************************************************************
+ *                          Asynchronous Transactions
+ *****************************************************************************/
+
+/**
+ * @brief Start a transaction that sends a command and receives data into
+ *  data_recv->buffer by DMA. Returns once the command is out.
+ * @note The buffer must stay valid until done is called or
+ *  NAND_SPI_Wait_DMA returns. Receives shorter than NAND_SPI_DMA_MIN finish
+ *  before this returns, done is still called.
+ *
+ * @param data_send[in]    Pointer to struct with command and length of command
+ * @param data_recv[out]   Pointer to struct with receive data buffer and length of buffer
+ * @param done[in]         Called when the transaction ends, may be NULL
+ * @param arg[in]          Passed to done
+ * @return NAND_SPI_ReturnType
+ */
+NAND_SPI_ReturnType NAND_SPI_SendReceive_DMA(SPI_Params *data_send, SPI_Params *data_recv, NAND_SPI_Callback done,
+                                             void *arg) {
+    HAL_StatusTypeDef status;
+
+    NAND_SPI_Wait_DMA();
+    if (!__nand_spi_use_dma(data_recv->length)) {
+        NAND_SPI_ReturnType ret = __nand_spi_poll_send_receive(data_send, data_recv);
+        if (done) {
+            done(ret, arg);
+        }
+        return ret;
+    }
+
+    dma_done = done;
+    dma_arg = arg;
+    dma_busy = true;
 
     __nand_spi_cs_low();
-    HAL_SPI_Transmit(hspi_nand, cmd_send->buffer, cmd_send->length, NAND_SPI_TIMEOUT);
-    send_status = HAL_SPI_Transmit(hspi_nand, data_send->buffer, data_send->length, NAND_SPI_TIMEOUT);
-    __nand_spi_cs_high();
+    status = HAL_SPI_Transmit(hspi_nand, data_send->buffer, data_send->length, NAND_SPI_TIMEOUT);
+    if (status == HAL_OK) {
+        // The NAND ignores MOSI while it shifts data out, so the buffer is clocked out as the dummy bytes.
+        // HAL_SPI_Receive_DMA does the same but ends in HAL_SPI_RxCpltCallback, which is the OBC's.
+        status = HAL_SPI_TransmitReceive_DMA(hspi_nand, data_recv->buffer, data_recv->buffer, data_recv->length);
+    }
+    if (status != HAL_OK) {
+        __nand_spi_cs_high();
+        dma_done = NULL;
+        dma_busy = false;
+        return SPI_Fail;
+    }
+    return SPI_OK;
+}
 
-    if (send_status != HAL_OK) {
+/**
+ * @brief Start a transaction that sends a command, then data_send->buffer by
+ *  DMA. Returns once the command is out.
+ * @note The buffer must stay valid until done is called or
+ *  NAND_SPI_Wait_DMA returns. Data shorter than NAND_SPI_DMA_MIN is sent
+ *  before this returns, done is still called.
+ *
+ * @param cmd_send[in]     Pointer to struct with command and length of command
+ * @param data_send[in]    Pointer to struct with data and length of data
+ * @param done[in]         Called when the transaction ends, may be NULL
+ * @param arg[in]          Passed to done
+ * @return NAND_SPI_ReturnType
+ */
+NAND_SPI_ReturnType NAND_SPI_Send_Command_Data_DMA(SPI_Params *cmd_send, SPI_Params *data_send,
+                                                   NAND_SPI_Callback done, void *arg) {
+    HAL_StatusTypeDef status;
+
+    NAND_SPI_Wait_DMA();
+    if (!__nand_spi_use_dma(data_send->length)) {
+        NAND_SPI_ReturnType ret = __nand_spi_poll_send_command_data(cmd_send, data_send);
+        if (done) {
+            done(ret, arg);
+        }
+        return ret;
+    }
+
+    dma_done = done;
+    dma_arg = arg;
+    dma_busy = true;
+
+    __nand_spi_cs_low();
+    status = HAL_SPI_Transmit(hspi_nand, cmd_send->buffer, cmd_send->length, NAND_SPI_TIMEOUT);
+    if (status == HAL_OK) {
+        status = HAL_SPI_Transmit_DMA(hspi_nand, data_send->buffer, data_send->length);
+    }
+    if (status != HAL_OK) {
+        __nand_spi_cs_high();
+        dma_done = NULL;
+        dma_busy = false;
         return SPI_Fail;
-    } else {
-        return SPI_OK;
     }
-};
+    return SPI_OK;
+}
+
+/**
+ * @brief Returns true while a DMA transaction is in flight.
+ */
+bool NAND_SPI_Busy(void) { return dma_busy; }
+
+/**
+ * @brief Waits for the DMA transaction in flight, if any.
+ * @note A transaction that runs past NAND_SPI_TIMEOUT is aborted.
+ *
+ * @return NAND_SPI_ReturnType of the last DMA transaction
+ */
+NAND_SPI_ReturnType NAND_SPI_Wait_DMA(void) {
+    uint32_t tickstart = HAL_GetTick();
+
+    while (dma_busy) {
+        if (HAL_GetTick() - tickstart > NAND_SPI_TIMEOUT) {
+            HAL_SPI_Abort(hspi_nand);
+            __nand_spi_cs_high();
+            dma_done = NULL;
+            dma_status = SPI_Fail;
+            dma_busy = false;
+        }
+    }
+    return dma_status;
+}
+
+/******************************************************************************
+ *                              HAL Callbacks
+ *****************************************************************************/
+
+void HAL_SPI_TxCpltCallback(SPI_HandleTypeDef *hspi) {
+    if (hspi == hspi_nand) {
+        __nand_spi_dma_complete(SPI_OK);
+    }
+}
+
+void HAL_SPI_TxRxCpltCallback(SPI_HandleTypeDef *hspi) {
+    if (hspi == hspi_nand) {
+        __nand_spi_dma_complete(SPI_OK);
+    }
+}
+
+void HAL_SPI_ErrorCallback(SPI_HandleTypeDef *hspi) {
+    if (hspi == hspi_nand && dma_busy) {
+        __nand_spi_dma_complete(SPI_Fail);
+    }
+}
 
 /******************************************************************************
  *                              Internal Functions
@@ -206,4 +357,58 @@ void __nand_spi_cs_low(void) { HAL_GPIO_WritePin(NAND_NCS_PORT, NAND_NCS_PIN, GP
  * @brief Close SPI communication to NAND by pulling chip select pin high.
  * @note Must be called after every SPI transmission
  */
-void __nand_spi_cs_high(void) { HAL_GPIO_WritePin(NAND_NCS_PORT, NAND_NCS_PIN, GPIO_PIN_SET); };
\ No newline at end of file
+void __nand_spi_cs_high(void) { HAL_GPIO_WritePin(NAND_NCS_PORT, NAND_NCS_PIN, GPIO_PIN_SET); };
+
+/**
+ * @brief Use DMA for a data phase of this length, if the DMA channels are linked.
+ */
+static bool __nand_spi_use_dma(uint16_t length) {
+    return length >= NAND_SPI_DMA_MIN && hspi_nand->hdmarx != NULL && hspi_nand->hdmatx != NULL;
+}
+
+static NAND_SPI_ReturnType __nand_spi_poll_send_receive(SPI_Params *data_send, SPI_Params *data_recv) {
+    HAL_StatusTypeDef recv_status;
+
+    __nand_spi_cs_low();
+    HAL_SPI_Transmit(hspi_nand, data_send->buffer, data_send->length, NAND_SPI_TIMEOUT);
+    recv_status = HAL_SPI_Receive(hspi_nand, data_recv->buffer, data_recv->length, NAND_SPI_TIMEOUT);
+    __nand_spi_cs_high();
+
+    if (recv_status != HAL_OK) {
+        return SPI_Fail;
+    } else {
+        return SPI_OK;
+    }
+}
+
+static NAND_SPI_ReturnType __nand_spi_poll_send_command_data(SPI_Params *cmd_send, SPI_Params *data_send) {
+    HAL_StatusTypeDef send_status;
+
+    __nand_spi_cs_low();
+    HAL_SPI_Transmit(hspi_nand, cmd_send->buffer, cmd_send->length, NAND_SPI_TIMEOUT);
+    send_status = HAL_SPI_Transmit(hspi_nand, data_send->buffer, data_send->length, NAND_SPI_TIMEOUT);
+    __nand_spi_cs_high();
+
+    if (send_status != HAL_OK) {
+        return SPI_Fail;
+    } else {
+        return SPI_OK;
+    }
+}
+
+/**
+ * @brief Ends the DMA transaction: releases nCS, then reports to the caller.
+ * @note Runs in the DMA interrupt. The transport is free again before done
+ *  is called, so done can start the next transaction.
+ */
+static void __nand_spi_dma_complete(NAND_SPI_ReturnType status) {
+    NAND_SPI_Callback done = dma_done;
+
+    __nand_spi_cs_high();
+    dma_status = status;
+    dma_done = NULL;
+    dma_busy = false;
+    if (done) {
+        done(status, dma_arg);
+    }
+}
@@ -19,9 +19,7 @@
  *
  * 		spi_init_burst(sensor);
  * 		for (j=0; j<num_of_chunks; j++){
- *  		for (i=0; i<chunk_length; i++) {
- *      		imagebyte = spi_read_burst(sensor);
- *      	}
+ *  		spi_read_burst_buf(sensor, chunk, chunk_length);
  *  	}
  * 		spi_deinit_burst(sensor);
  *
@@ -46,6 +44,152 @@
 #include "spi_bitbang.h"
 extern TIM_HandleTypeDef htim2;
 
+/*
+ * Pin access of the bit loops, through the port registers they cache on
+ * entry. The host tests define these to clock a simulated sensor instead.
+ */
+#ifndef BB_CLK_HIGH
+#define BB_PORTS()                                                                                                 \
+    volatile uint32_t *clk_set = &CLK_Port->BSRR;                                                                  \
+    volatile uint32_t *clk_reset = &CLK_Port->BRR;                                                                 \
+    volatile uint32_t *mosi_set = &MOSI_Port->BSRR;                                                                \
+    volatile uint32_t *mosi_reset = &MOSI_Port->BRR;                                                               \
+    volatile uint32_t *miso_in = &MISO_Port->IDR
+#define BB_CLK_HIGH() (*clk_set = CLK_Pin)
+#define BB_CLK_LOW() (*clk_reset = CLK_Pin)
+#define BB_MOSI(bit) (*((bit) ? mosi_set : mosi_reset) = MOSI_Pin)
+#define BB_MISO() ((*miso_in >> __builtin_ctz(MISO_Pin)) & 1u)
+#endif
+
+// One clock, sampling MISO on the rising edge like spi_read_burst
+#define BB_BIT(byte)                                                                                               \
+    do {                                                                                                           \
+        _bb_delay(loops);                                                                                          \
+        BB_CLK_HIGH();                                                                                             \
+        byte = (byte << 1) | BB_MISO();                                                                            \
+        _bb_delay(loops);                                                                                          \
+        BB_CLK_LOW();                                                                                              \
+    } while (0)
+
+// Sized so the padded calibration run stays well inside the 16 bit TIM2 period
+#define BB_CAL_BYTES 16 // bytes clocked per calibration run
+#define BB_CAL_LOOPS 16 // delay loops per half period for the padded calibration run
+
+/* Timing profile of one sensor, with the delay loop counts it works out to */
+typedef struct {
+    spi_timing_t timing;
+    uint32_t reg_loops;
+    uint32_t burst_loops;
+} spi_profile_t;
+
+// Bursts run at the register timing until arducam_calibrate_spi finds a faster one
+static spi_profile_t profiles[2] = {
+    {.timing = {.reg_half_cycles = SPI_REG_HALF_CYCLES, .burst_half_cycles = SPI_REG_HALF_CYCLES}},
+    {.timing = {.reg_half_cycles = SPI_REG_HALF_CYCLES, .burst_half_cycles = SPI_REG_HALF_CYCLES}},
+};
+static uint32_t cal_bare;   // cycles of the calibration run without delay loops
+static uint32_t cal_padded; // cycles of the calibration run with BB_CAL_LOOPS delay loops
+static bool bb_calibrated = false;
+
+static void _bb_calibrate(void);
+
+static inline spi_profile_t *_profile(uint8_t sensor) {
+    if (!bb_calibrated) {
+        _bb_calibrate();
+    }
+    return &profiles[sensor == 0x3C ? 0 : 1]; // VIS sensor is CS1
+}
+
+static inline void _bb_delay(uint32_t loops) {
+    while (loops--) {
+        __NOP();
+    }
+}
+
+/*
+ * Clocks one byte out on MOSI and one in from MISO, MSB first
+ */
+static uint8_t _bb_transfer(uint8_t out, uint32_t loops) {
+    BB_PORTS();
+    uint32_t in = 0;
+
+    for (int i = 0; i < 8; i++) {
+        BB_MOSI(out & 0x80);
+        out <<= 1;
+        BB_BIT(in);
+    }
+    BB_MOSI(0); // ensure mosi stays low
+    return (uint8_t)in;
+}
+
+static inline void _bb_read(uint8_t *buf, uint32_t len, uint32_t loops) {
+    BB_PORTS();
+
+    BB_MOSI(0); // dummy bits are all low
+    while (len--) {
+        uint32_t byte = 0;
+        BB_BIT(byte);
+        BB_BIT(byte);
+        BB_BIT(byte);
+        BB_BIT(byte);
+        BB_BIT(byte);
+        BB_BIT(byte);
+        BB_BIT(byte);
+        BB_BIT(byte);
+        *buf++ = (uint8_t)byte;
+    }
+}
+
+/*
+ * Returns the number of delay loops that stretch a clock half period of the
+ * burst reader to at least half_cycles SYSCLK cycles.
+ */
+static uint32_t _bb_loops(uint32_t half_cycles) {
+    uint32_t budget = half_cycles * 2 * BB_CAL_BYTES * 8;
+
+    if (budget <= cal_bare || cal_padded <= cal_bare) {
+        return 0;
+    }
+    // every delay loop adds (cal_padded - cal_bare) / BB_CAL_LOOPS cycles to the run
+    return ((budget - cal_bare) * BB_CAL_LOOPS + (cal_padded - cal_bare) - 1) / (cal_padded - cal_bare);
+}
+
+static void _bb_apply(spi_profile_t *profile) {
+    if (profile->timing.burst_half_cycles < SPI_BURST_MIN_HALF_CYCLES) {
+        profile->timing.burst_half_cycles = SPI_BURST_MIN_HALF_CYCLES;
+    }
+    if (profile->timing.reg_half_cycles < SPI_BURST_MIN_HALF_CYCLES) {
+        profile->timing.reg_half_cycles = SPI_BURST_MIN_HALF_CYCLES;
+    }
+    profile->reg_loops = _bb_loops(profile->timing.reg_half_cycles);
+    profile->burst_loops = _bb_loops(profile->timing.burst_half_cycles);
+}
+
+/*
+ * Returns the TIM2 ticks (SYSCLK cycles) the burst reader takes for
+ * BB_CAL_BYTES bytes with the given delay.
+ */
+static uint32_t _bb_cycles(uint32_t loops) {
+    uint8_t scratch[BB_CAL_BYTES];
+
+    __HAL_TIM_SET_COUNTER(&htim2, 0);
+    _bb_read(scratch, sizeof(scratch), loops);
+    return __HAL_TIM_GET_COUNTER(&htim2);
+}
+
+/*
+ * Times the burst reader with and without padding, which is what turns the
+ * half periods of the profiles into delay loops. Runs before the first
+ * access, with both chip selects high so the sensors ignore the clocks.
+ */
+static void _bb_calibrate(void) {
+    cal_bare = _bb_cycles(0);
+    cal_padded = _bb_cycles(BB_CAL_LOOPS);
+    bb_calibrated = true;
+    _bb_apply(&profiles[0]);
+    _bb_apply(&profiles[1]);
+}
+
 // Pin config
 //  /*Configure GPIO pins : SPI_B_MOSI_Pin SPI_B_CLK_Pin */
 //  GPIO_InitStruct.Pin = SPI_B_MOSI_Pin|SPI_B_CLK_Pin;
@@ -82,10 +226,8 @@ extern TIM_HandleTypeDef htim2;
  * todo: consider switching to pointers (will require a decent amount of refactor)
  */
 uint8_t read_spi_reg(uint8_t addr, uint8_t sensor) {
-    uint8_t rec[8];
-    // preallocate for teh z o o m
-    uint8_t address[8];
-    set_bits(address, addr);
+    uint32_t loops = _profile(sensor)->reg_loops;
+    uint8_t data;
 
     // CS Low
     if (sensor == 0x3C) {
@@ -93,49 +235,46 @@ uint8_t read_spi_reg(uint8_t addr, uint8_t sensor) {
     } else {
         _CS2_LOW(); // NIR sensor is CS2
     }
-    // Send Phase
-    for (int i = 0; i < 8; i++) {
-        if (address[i] == 1) {
-            MOSI_Port->BSRR = MOSI_Pin;
-        } else {
-            MOSI_Port->BRR = MOSI_Pin;
-        }
-        delay_us(SPI_DELAY);
-        CLK_Port->BSRR = CLK_Pin; // high
-        if ((MISO_Port->IDR & MISO_Pin) != (uint32_t)GPIO_PIN_RESET) {
-        }
-        delay_us(SPI_DELAY);
-        CLK_Port->BRR = CLK_Pin; // low
+    _bb_transfer(addr, loops);
+    data = _bb_transfer(0x00, loops); // dummy byte
+    if (sensor == 0x3C) {
+        _CS1_HIGH();
+    } else {
+        _CS2_HIGH();
     }
 
-    // Receive phase
-    for (int i = 0; i < 8; i++) {
-        // write low regardless for dummy byte, this logic keeps the duty cycle for the clock
-        // at around 50% without having to mess with the delay_us();
-        if (address[i] == 1) {
-            MOSI_Port->BRR = MOSI_Pin;
-        } else {
-            MOSI_Port->BRR = MOSI_Pin;
-        }
-        delay_us(SPI_DELAY);
-        CLK_Port->BSRR = CLK_Pin; // high
-        if ((MISO_Port->IDR & MISO_Pin) != (uint32_t)GPIO_PIN_RESET) {
-            rec[i] = 1;
-        } else {
-            rec[i] = 0;
-        }
-        delay_us(SPI_DELAY);
-        CLK_Port->BRR = CLK_Pin; // low
-    }
+    return data;
+}
+
+/**
+ * @brief reads spi register with the data clocked in by the burst reader
+ *
+ * The address goes out at the sensor's register timing, the data comes in at
+ * its burst timing, which lets the burst timing be checked against known
+ * register contents.
+ *
+ * @param addr      8 bit register address
+ * @param sensor    target sensor
+ * @return uint8_t
+ */
+uint8_t read_spi_reg_burst(uint8_t addr, uint8_t sensor) {
+    spi_profile_t *profile = _profile(sensor);
+    uint8_t data;
 
+    if (sensor == 0x3C) {
+        _CS1_LOW(); // VIS sensor is CS1
+    } else {
+        _CS2_LOW(); // NIR sensor is CS2
+    }
+    _bb_transfer(addr, profile->reg_loops);
+    _bb_read(&data, 1, profile->burst_loops);
     if (sensor == 0x3C) {
         _CS1_HIGH();
     } else {
         _CS2_HIGH();
     }
-    MOSI_Port->BRR = MOSI_Pin; // ensure mosi stays low
 
-    return parse_bits(rec);
+    return data;
 }
 
 /**
@@ -148,11 +287,7 @@ uint8_t read_spi_reg(uint8_t addr, uint8_t sensor) {
  * @return false
  */
 bool write_spi_reg(uint8_t addr, uint8_t packet, uint8_t sensor) {
-    // preallocate for teh z o o m
-    uint8_t address[8];
-    uint8_t to_send[8];
-    set_bits(address, (addr | 0x80));
-    set_bits(to_send, packet);
+    uint32_t loops = _profile(sensor)->reg_loops;
 
     // CS Low
     if (sensor == 0x3C) {
@@ -160,43 +295,13 @@ bool write_spi_reg(uint8_t addr, uint8_t packet, uint8_t sensor) {
     } else {
         _CS2_LOW(); // NIR sensor is CS2
     }
-    // Send Phase
-    for (int i = 0; i < 8; i++) {
-        if (address[i] == 1) {
-            MOSI_Port->BSRR = MOSI_Pin;
-        } else {
-            MOSI_Port->BRR = MOSI_Pin;
-        }
-        delay_us(SPI_DELAY);
-        CLK_Port->BSRR = CLK_Pin; // high
-        // keep this here for timing sync? I think.
-        if ((MISO_Port->IDR & MISO_Pin) != (uint32_t)GPIO_PIN_RESET) {
-        }
-        delay_us(SPI_DELAY);
-        CLK_Port->BRR = CLK_Pin; // low
-    }
-
-    // Write phase
-    for (int i = 0; i < 8; i++) {
-        if (to_send[i] == 1) {
-            MOSI_Port->BSRR = MOSI_Pin;
-        } else {
-            MOSI_Port->BRR = MOSI_Pin;
-        }
-        delay_us(SPI_DELAY);
-        CLK_Port->BSRR = CLK_Pin; // high
-        if ((MISO_Port->IDR & MISO_Pin) != (uint32_t)GPIO_PIN_RESET) {
-        }
-        delay_us(SPI_DELAY);
-        CLK_Port->BRR = CLK_Pin; // low
-    }
-
+    _bb_transfer(addr | 0x80, loops);
+    _bb_transfer(packet, loops);
     if (sensor == 0x3C) {
         _CS1_HIGH();
     } else {
         _CS2_HIGH();
     }
-    MOSI_Port->BRR = MOSI_Pin; // ensure mosi stays low
 
     return true;
 }
@@ -229,6 +334,45 @@ uint8_t spi_read_burst(uint8_t sensor) {
     return parse_bits(rec);
 }
 
+/**
+ * @brief Reads a run of bytes in burst mode from the sensor FIFO
+ *
+ * Same bits on the wire as calling spi_read_burst len times, without the
+ * per-bit array and TIM2 restarts, clocked at the sensor's burst timing.
+ *
+ * @param sensor    target sensor
+ * @param buf       destination of the bytes
+ * @param len       number of bytes to read
+ */
+void spi_read_burst_buf(uint8_t sensor, uint8_t *buf, uint32_t len) {
+    _bb_read(buf, len, _profile(sensor)->burst_loops);
+}
+
+/**
+ * @brief Sets the clock timing of a sensor
+ *
+ * Half periods under SPI_BURST_MIN_HALF_CYCLES are raised to it. The
+ * accesses take at least the given time, the loop overhead of register
+ * accesses can make them slower.
+ *
+ * @param sensor    target sensor
+ * @param timing    half periods in SYSCLK cycles
+ */
+void spi_set_timing(uint8_t sensor, const spi_timing_t *timing) {
+    spi_profile_t *profile = _profile(sensor);
+
+    profile->timing = *timing;
+    _bb_apply(profile);
+}
+
+/**
+ * @brief Gets the clock timing of a sensor
+ *
+ * @param sensor    target sensor
+ * @param timing    filled with the half periods in SYSCLK cycles
+ */
+void spi_get_timing(uint8_t sensor, spi_timing_t *timing) { *timing = _profile(sensor)->timing; }
+
 /*
  * Initializes burst mode on image sensor
  *
@@ -237,28 +381,14 @@ uint8_t spi_read_burst(uint8_t sensor) {
  */
 void spi_init_burst(uint8_t sensor) {
     uint8_t addr = 0x3C; // not i2c address dummy, spi reg x3C
-    uint8_t address[8];
-    set_bits(address, addr);
+    uint32_t loops = _profile(sensor)->reg_loops;
 
     if (sensor == 0x3C) {
         _CS1_LOW(); // VIS sensor is CS1
     } else {
         _CS2_LOW(); // NIR sensor is CS2
     }
-    // Send Phase
-    for (int i = 0; i < 8; i++) {
-        if (address[i] == 1) {
-            MOSI_Port->BSRR = MOSI_Pin;
-        } else {
-            MOSI_Port->BRR = MOSI_Pin;
-        }
-        delay_us(SPI_DELAY);
-        CLK_Port->BSRR = CLK_Pin; // high
-        if ((MISO_Port->IDR & MISO_Pin) != (uint32_t)GPIO_PIN_RESET) {
-        }
-        delay_us(SPI_DELAY);
-        CLK_Port->BRR = CLK_Pin; // low
-    }
+    _bb_transfer(addr, loops);
     return;
 }
 
@@ -6,8 +6,10 @@
  */
 
 #include <iris_system.h>
+#include "spi_obc.h"
 
 extern SPI_HandleTypeDef hspi1;
+extern CRC_HandleTypeDef hcrc;
 
 /**
  * @brief
@@ -22,6 +24,86 @@ HAL_StatusTypeDef obc_spi_transmit(uint8_t *tx_data, uint16_t data_length) {
     return HAL_SPI_Transmit(&hspi1, tx_data, data_length, HAL_MAX_DELAY);
 }
 
+/**
+ * @brief
+ * 		Transmit a block followed by its CRC
+ *
+ * 		The block goes out by DMA while the CRC unit is fed from it a chunk
+ * 		at a time, so the CRC is ready when the last byte is. It is the
+ * 		CRC-32/MPEG-2 of the block (polynomial 0x04C11DB7, initial value
+ * 		0xFFFFFFFF, no reflection or final XOR), sent big endian after it.
+ * 		Every response to the OBC goes out this way.
+ * @param
+ * 		*tx_data: pointer to the block
+ * 		data_length: numbers of bytes in the block
+ * @return
+ * 		HAL level return status
+ */
+HAL_StatusTypeDef obc_spi_transmit_block(uint8_t *tx_data, uint16_t data_length) {
+    uint8_t crc[OBC_BLOCK_CRC_SIZE];
+    uint32_t value = 0;
+    HAL_StatusTypeDef ret;
+
+    ret = HAL_SPI_Transmit_DMA(&hspi1, tx_data, data_length);
+    if (ret != HAL_OK) {
+        return ret;
+    }
+
+    for (uint16_t i = 0; i < data_length; i += OBC_CRC_CHUNK_SIZE) {
+        uint16_t n = (data_length - i < OBC_CRC_CHUNK_SIZE) ? data_length - i : OBC_CRC_CHUNK_SIZE;
+        if (i == 0) {
+            value = HAL_CRC_Calculate(&hcrc, (uint32_t *)tx_data, n);
+        } else {
+            value = HAL_CRC_Accumulate(&hcrc, (uint32_t *)(tx_data + i), n);
+        }
+    }
+    crc[0] = (value >> 24) & 0xff;
+    crc[1] = (value >> 16) & 0xff;
+    crc[2] = (value >> 8) & 0xff;
+    crc[3] = value & 0xff;
+
+    // The OBC clocks the block out, as it would a blocking transmit
+    while (HAL_SPI_GetState(&hspi1) != HAL_SPI_STATE_READY) {
+    }
+    if (hspi1.ErrorCode != HAL_SPI_ERROR_NONE) {
+        return HAL_ERROR;
+    }
+    return HAL_SPI_Transmit(&hspi1, crc, OBC_BLOCK_CRC_SIZE, HAL_MAX_DELAY);
+}
+
+/**
+ * @brief
+ * 		Transmit a transfer block and its CRC until the OBC acks it
+ *
+ * 		After the CRC the OBC replies with an ack (0xAA) if it matched.
+ * 		Anything else has the block sent again, up to OBC_BLOCK_RETRIES
+ * 		times. No reply within OBC_BLOCK_REPLY_TIMEOUT ends the transfer.
+ * @param
+ * 		*tx_data: pointer to the block
+ * 		data_length: numbers of bytes in the block
+ * @return
+ * 		HAL level return status, HAL_ERROR if the OBC never acked
+ */
+HAL_StatusTypeDef obc_spi_transfer_block(uint8_t *tx_data, uint16_t data_length) {
+    uint8_t reply;
+    HAL_StatusTypeDef ret;
+
+    for (int attempt = 0; attempt <= OBC_BLOCK_RETRIES; attempt++) {
+        ret = obc_spi_transmit_block(tx_data, data_length);
+        if (ret != HAL_OK) {
+            return ret;
+        }
+        ret = HAL_SPI_Receive(&hspi1, &reply, 1, OBC_BLOCK_REPLY_TIMEOUT);
+        if (ret != HAL_OK) {
+            return ret;
+        }
+        if (reply == 0xAA) { // ack
+            return HAL_OK;
+        }
+    }
+    return HAL_ERROR;
+}
+
 /**
  * @brief
  * 		Receive data of given size over SPI bus in interrupt mode
@@ -124,14 +124,21 @@ static int nand_dump_file(int which, io_funcs_t *io_driver) {
         return -1;
     }
 
-    uint32_t len = fh->node.file_size;
+    // The debug dump is of the data as captured, decoded if it was stored coded
+    if (NANDfs_decode(fh)) {
+        iris_log("decode failed: %d\r\n", nand_errno);
+        NANDfs_close(fh);
+        return -1;
+    }
+
+    uint32_t len = fh->node.raw_size;
     if (len == 0) {
         iris_log("no files\r\n");
         NANDfs_close(fh);
         return -2;
     }
 
-    iris_log("file id %d, length %ld\n", which, len);
+    iris_log("file id %d, length %ld, %ld stored, codec %d\n", which, len, fh->node.file_size, fh->node.codec);
 
     if (io_driver->write_len) {
         if ((rc = io_driver->write_len(io_driver, len))) {
@@ -221,7 +228,8 @@ int list_files() {
     do {
         inode_t *entry = NANDfs_getdir(dir);
 
-        iris_log("id %ld, size %ld, start %d\r\n", entry->id, entry->file_size, entry->start_block);
+        iris_log("id %ld, size %ld, raw %ld, codec %d, burst %ld, start %d\r\n", entry->id, entry->file_size,
+                 entry->raw_size, entry->codec, entry->burst, entry->start_block);
     } while (NANDfs_nextdir(dir) > 0);
 
     NANDfs_closedir(dir);
@@ -12,6 +12,10 @@
 #include "debug.h"
 #include "tmp421.h"
 #include "ina209.h"
+#include "nandfs.h"
+#include "spi_bitbang.h"
+
+static uint8_t _hk_half_cycles(uint16_t cycles) { return (cycles > 0xff) ? 0xff : (uint8_t)cycles; }
 
 housekeeping_packet_t _get_housekeeping() {
     housekeeping_packet_t hk;
@@ -25,6 +29,26 @@ housekeeping_packet_t _get_housekeeping() {
     hk.imagenum = image_count;
     hk.software_version = software_ver;
     hk.errornum = get_error_num();
+    hk.mount_time_ms = NANDfs_mount_time();
+
+    NANDfs_erase_stats_t erase_stats;
+    NANDfs_erase_stats(&erase_stats);
+    hk.erase_pool_hits = erase_stats.hits;
+    hk.erase_pool_misses = erase_stats.misses;
+    hk.erase_stall_ms = erase_stats.stall_ms;
+
+    spi_timing_t timing;
+    spi_get_timing(VIS_SENSOR, &timing);
+    hk.vis_spi_reg_half = _hk_half_cycles(timing.reg_half_cycles);
+    hk.vis_spi_burst_half = _hk_half_cycles(timing.burst_half_cycles);
+    spi_get_timing(NIR_SENSOR, &timing);
+    hk.nir_spi_reg_half = _hk_half_cycles(timing.reg_half_cycles);
+    hk.nir_spi_burst_half = _hk_half_cycles(timing.burst_half_cycles);
+
+    uint16_t vis_capture_ms, nir_capture_ms;
+    get_capture_latency(&vis_capture_ms, &nir_capture_ms);
+    hk.vis_capture_ms = vis_capture_ms;
+    hk.nir_capture_ms = nir_capture_ms;
 
 #if defined IRIS_EM || defined IRIS_FM
     uint16_t pospeak, pwrpeak, negpeak;
@@ -94,4 +118,15 @@ void decode_hk_packet(housekeeping_packet_t hk) {
     iris_log(buf);
     sprintf(buf, "hk.MAX_3V_power: 0x%x\r\n", hk.MAX_3V_power);
     iris_log(buf);
+    sprintf(buf, "hk.mount_time_ms: %d\r\n", hk.mount_time_ms);
+    iris_log(buf);
+    sprintf(buf, "hk.erase_pool: %d hits, %d misses, %d ms stalled\r\n", hk.erase_pool_hits,
+            hk.erase_pool_misses, hk.erase_stall_ms);
+    iris_log(buf);
+    sprintf(buf, "hk.vis_spi: reg %d, burst %d cycles/half clock\r\n", hk.vis_spi_reg_half, hk.vis_spi_burst_half);
+    iris_log(buf);
+    sprintf(buf, "hk.nir_spi: reg %d, burst %d cycles/half clock\r\n", hk.nir_spi_reg_half, hk.nir_spi_burst_half);
+    iris_log(buf);
+    sprintf(buf, "hk.capture_ms: vis %d, nir %d\r\n", hk.vis_capture_ms, hk.nir_capture_ms);
+    iris_log(buf);
 }
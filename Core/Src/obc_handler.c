@@ -6,6 +6,7 @@
 #include "spi_obc.h"
 #include "iris_time.h"
 #include "spi_bitbang.h"
+#include "jpeg_framer.h"
 #include "logger.h"
 
 #include "nand_types.h"
@@ -14,16 +15,24 @@
 
 extern SPI_HandleTypeDef hspi1;
 extern uint8_t image_count;
+extern FileInfo_t image_file_infos_queue[MAX_IMAGE_FILES];
 
 uint8_t direct_method_flag = 0;
+uint8_t thumbnail_flag = 0; // take a thumbnail after every IRIS_TAKE_PIC
 
 uint8_t sensor = VIS_SENSOR; // VIS or NIR, used exclusively in direct transfer mode
 uint8_t image_file_infos_queue_iterator = 0;
 
 const uint8_t iris_commands[IRIS_NUM_COMMANDS] = {IRIS_TAKE_PIC,
+                                                  IRIS_TAKE_BURST,
                                                   IRIS_GET_IMAGE_LENGTH,
                                                   IRIS_TRANSFER_IMAGE,
+                                                  IRIS_GET_THUMBNAILS,
+                                                  IRIS_TRANSFER_THUMBNAIL,
                                                   IRIS_TRANSFER_LOG,
+                                                  IRIS_LIST_IMAGES,
+                                                  IRIS_TRANSFER_WINDOW,
+                                                  IRIS_DELETE_IMAGE,
                                                   IRIS_GET_IMAGE_COUNT,
                                                   IRIS_ON_SENSORS,
                                                   IRIS_OFF_SENSORS,
@@ -32,8 +41,19 @@ const uint8_t iris_commands[IRIS_NUM_COMMANDS] = {IRIS_TAKE_PIC,
                                                   IRIS_UPDATE_CURRENT_LIMIT,
                                                   IRIS_SET_TIME,
                                                   IRIS_UPDATE_CONFIG,
+                                                  IRIS_SET_THUMBNAILS,
                                                   IRIS_WDT_CHECK};
 
+static inline uint32_t _be32(const uint8_t *buf) {
+    return (uint32_t)buf[0] << 24 | (uint32_t)buf[1] << 16 | (uint32_t)buf[2] << 8 | (uint32_t)buf[3];
+}
+
+static inline void _put_be(uint8_t *buf, uint32_t value, int width) {
+    for (int i = 0; i < width; i++) {
+        buf[i] = (value >> (8 * (width - 1 - i))) & 0xff;
+    }
+}
+
 /**
  * @brief
  * 		Verifies if command from OBC is valid or not
@@ -56,10 +76,10 @@ int obc_verify_command(uint8_t obc_cmd) {
     }
 
     if (transmit_ack != 0) {
-        obc_spi_transmit(&ack, 2);
+        obc_spi_transmit_block(&ack, 1);
         return 0;
     } else {
-        obc_spi_transmit(&nack, 1);
+        obc_spi_transmit_block(&nack, 1);
         return -1;
     }
 }
@@ -83,14 +103,14 @@ int obc_handle_command(uint8_t obc_cmd) {
 
         uint8_t buffer[sizeof(hk)];
         memcpy(buffer, &hk, sizeof(hk));
-        obc_spi_transmit(buffer, sizeof(buffer));
+        if (obc_spi_transfer_block(buffer, sizeof(buffer)) != HAL_OK) {
+            iris_log("Housekeeping data not acked by obc");
+            return -1;
+        }
         iris_log("Done sending housekeeping data");
         return 0;
     }
     case IRIS_TAKE_PIC: {
-        take_image();
-        iris_log("Image capture complete");
-
         if (direct_method_flag != 1) {
             uint8_t cur_capture_timestamp_vis[CAPTURE_TIMESTAMP_SIZE];
             uint8_t cur_capture_timestamp_nir[CAPTURE_TIMESTAMP_SIZE];
@@ -98,26 +118,51 @@ int obc_handle_command(uint8_t obc_cmd) {
             set_capture_timestamp(cur_capture_timestamp_vis, VIS_SENSOR);
             set_capture_timestamp(cur_capture_timestamp_nir, NIR_SENSOR);
 
+            // Each image is stored as soon as its sensor is done
             obc_disable_spi_rx();
-            transfer_image_to_nand(VIS_SENSOR, cur_capture_timestamp_vis);
-            transfer_image_to_nand(NIR_SENSOR, cur_capture_timestamp_nir);
+            take_image(cur_capture_timestamp_vis, cur_capture_timestamp_nir);
+            if (thumbnail_flag == 1) {
+                take_thumbnails();
+            }
             obc_enable_spi_rx();
         } else {
+            take_image(NULL, NULL);
             image_count = 1;
         }
+        iris_log("Image capture complete");
+        return 0;
+    }
+    case IRIS_TAKE_BURST: {
+        uint8_t frames;
+
+        obc_spi_receive_blocking(&frames, 1);
+        if (direct_method_flag == 1) {
+            // the direct method only transfers the first JPEG in the FIFO
+            iris_log("Burst capture needs the NAND method");
+            return -1;
+        }
+
+        // Frames are stored as each sensor's FIFO is drained
+        obc_disable_spi_rx();
+        take_burst(frames);
+        obc_enable_spi_rx();
+        iris_log("Burst capture complete");
         return 0;
     }
     case IRIS_GET_IMAGE_COUNT: {
         uint8_t cnt;
         get_image_count(&cnt);
-        obc_spi_transmit(&cnt, 1);
+        obc_spi_transmit_block(&cnt, 1);
         return 0;
     }
     case IRIS_TRANSFER_IMAGE: {
         if (direct_method_flag == 1) {
-            transfer_image_to_obc_direct_method();
+            return transfer_image_to_obc_direct_method();
         } else {
-            transfer_images_to_obc_nand_method(image_file_infos_queue_iterator);
+            // An image the OBC didn't get stays queued
+            if (transfer_images_to_obc_nand_method(image_file_infos_queue_iterator) < 0) {
+                return -1;
+            }
             delete_image_file_from_queue(image_file_infos_queue_iterator);
             image_count -= 1;
             image_file_infos_queue_iterator += 1;
@@ -130,6 +175,79 @@ int obc_handle_command(uint8_t obc_cmd) {
         }
         return 0;
     }
+    case IRIS_GET_THUMBNAILS: {
+        // Thumbnail sizes of the queued images in transfer order, 0 if an image has none
+        uint8_t packet[IRIS_THUMBNAIL_LIST_SIZE];
+        memset(packet, 0, IRIS_THUMBNAIL_LIST_SIZE);
+
+        packet[0] = image_count;
+        for (uint8_t i = 0; i < image_count && i < MAX_IMAGE_FILES; i++) {
+            uint32_t thumb_size = 0;
+            get_thumbnail_length(&thumb_size, image_file_infos_queue_iterator + i);
+
+            uint8_t *entry = &packet[1 + i * IRIS_IMAGE_SIZE_WIDTH];
+            entry[0] = (thumb_size >> (8 * 2)) & 0xff;
+            entry[1] = (thumb_size >> (8 * 1)) & 0xff;
+            entry[2] = (thumb_size >> (8 * 0)) & 0xff;
+        }
+        obc_spi_transmit_block(packet, IRIS_THUMBNAIL_LIST_SIZE);
+        return 0;
+    }
+    case IRIS_TRANSFER_THUMBNAIL: {
+        // Image number in transfer order, as listed by IRIS_GET_THUMBNAILS
+        uint8_t index;
+
+        obc_spi_receive_blocking(&index, 1);
+        if (index >= image_count) {
+            iris_log("No image %d to send the thumbnail of", index);
+            return -1;
+        }
+        return transfer_thumbnail_to_obc(image_file_infos_queue_iterator + index);
+    }
+    case IRIS_LIST_IMAGES: {
+        // Count, then the ids and stored sizes of the queued images and their thumbnails in transfer order,
+        // zero filled to MAX_IMAGE_FILES entries
+        uint8_t packet[IRIS_IMAGE_LIST_SIZE];
+        memset(packet, 0, IRIS_IMAGE_LIST_SIZE);
+
+        packet[0] = image_count;
+        for (uint8_t i = 0; i < MAX_IMAGE_FILES; i++) {
+            uint8_t *entry = &packet[1 + i * IRIS_IMAGE_ENTRY_SIZE];
+            if (i < image_count) {
+                FileInfo_t *info = &image_file_infos_queue[image_file_infos_queue_iterator + i];
+                _put_be(&entry[0], info->file_id, IRIS_FILE_ID_SIZE);
+                _put_be(&entry[IRIS_FILE_ID_SIZE], info->file_size, IRIS_IMAGE_SIZE_WIDTH);
+                if (info->thumb_id != 0) {
+                    _put_be(&entry[IRIS_IMAGE_ENTRY_SIZE / 2], info->thumb_id, IRIS_FILE_ID_SIZE);
+                    _put_be(&entry[IRIS_IMAGE_ENTRY_SIZE / 2 + IRIS_FILE_ID_SIZE], info->thumb_size,
+                            IRIS_IMAGE_SIZE_WIDTH);
+                }
+            }
+        }
+        obc_spi_transmit_block(packet, IRIS_IMAGE_LIST_SIZE);
+        return 0;
+    }
+    case IRIS_TRANSFER_WINDOW: {
+        // Resumable transfer, the OBC asks again from its last good offset and acks with IRIS_DELETE_IMAGE
+        uint8_t request[IRIS_WINDOW_REQUEST_SIZE];
+
+        obc_spi_receive_blocking(request, IRIS_WINDOW_REQUEST_SIZE);
+        return transfer_window_to_obc(_be32(&request[0]), _be32(&request[4]), _be32(&request[8]));
+    }
+    case IRIS_DELETE_IMAGE: {
+        uint8_t request[IRIS_FILE_ID_SIZE];
+
+        obc_spi_receive_blocking(request, IRIS_FILE_ID_SIZE);
+        if (ack_image_file_in_queue(_be32(request), image_file_infos_queue_iterator) < 0) {
+            obc_spi_transmit_block(&tx_nack, 1);
+            return -1;
+        }
+        if (image_count == 0) {
+            image_file_infos_queue_iterator = 0;
+        }
+        obc_spi_transmit_block(&tx_ack, 1);
+        return 0;
+    }
     case IRIS_TRANSFER_LOG: {
         clear_and_dump_buffer();
         transfer_log_to_obc();
@@ -140,7 +258,7 @@ int obc_handle_command(uint8_t obc_cmd) {
         turn_off_sensors();
         iris_log("Sensor deactivated");
 
-        obc_spi_transmit(&tx_ack, 1);
+        obc_spi_transmit_block(&tx_ack, 1);
         return 0;
     }
     case IRIS_ON_SENSORS: {
@@ -151,13 +269,13 @@ int obc_handle_command(uint8_t obc_cmd) {
         ret = initalize_sensors();
         if (ret < 0) {
             iris_log("Sensor failed to initialized");
-            obc_spi_transmit(&tx_nack, 1);
+            obc_spi_transmit_block(&tx_nack, 1);
             return -1;
         } else {
             iris_log("Sensor initialize");
         }
 
-        obc_spi_transmit(&tx_ack, 1);
+        obc_spi_transmit_block(&tx_ack, 1);
         return 0;
     }
     case IRIS_GET_IMAGE_LENGTH: {
@@ -172,7 +290,7 @@ int obc_handle_command(uint8_t obc_cmd) {
             ret = get_image_length(&image_length, image_file_infos_queue_iterator);
             if (ret < 0) {
                 iris_log("Failed to get image length");
-                obc_spi_transmit(packet, IRIS_IMAGE_SIZE_WIDTH);
+                obc_spi_transmit_block(packet, IRIS_IMAGE_SIZE_WIDTH);
                 return -1;
             }
         }
@@ -180,17 +298,17 @@ int obc_handle_command(uint8_t obc_cmd) {
         packet[1] = (image_length >> (8 * 1)) & 0xff;
         packet[2] = (image_length >> (8 * 0)) & 0xff;
 
-        obc_spi_transmit(packet, IRIS_IMAGE_SIZE_WIDTH);
+        obc_spi_transmit_block(packet, IRIS_IMAGE_SIZE_WIDTH);
         return 0;
     }
     case IRIS_UPDATE_SENSOR_I2C_REG: {
         // update_sensor_I2C_regs();
-        obc_spi_transmit(&tx_nack, 1);
+        obc_spi_transmit_block(&tx_nack, 1);
         return 0;
     }
     case IRIS_UPDATE_CURRENT_LIMIT: {
         // update_current_limits();
-        obc_spi_transmit(&tx_nack, 1);
+        obc_spi_transmit_block(&tx_nack, 1);
         return 0;
     }
     case IRIS_SET_TIME: {
@@ -222,6 +340,15 @@ int obc_handle_command(uint8_t obc_cmd) {
         config.set_saturation = iris_config_buffer[5];
 
         set_configurations(&config);
+        return 0;
+    }
+    case IRIS_SET_THUMBNAILS: {
+        // 1 takes a thumbnail after every IRIS_TAKE_PIC, 0 stops
+        uint8_t enable;
+
+        obc_spi_receive_blocking(&enable, 1);
+        thumbnail_flag = enable;
+        return 0;
     }
     case IRIS_WDT_CHECK: {
         return 0;
@@ -232,36 +359,121 @@ int obc_handle_command(uint8_t obc_cmd) {
     }
 }
 
+/* Collects the framed JPEG into transfer blocks for the OBC */
+typedef struct {
+    uint8_t *block;
+    uint32_t fill;
+    uint16_t sent;
+} obc_block_sink_t;
+
+static int _obc_block_sink(const uint8_t *data, uint32_t len, void *arg) {
+    obc_block_sink_t *out = (obc_block_sink_t *)arg;
+
+    while (len > 0) {
+        uint32_t n = IRIS_IMAGE_TRANSFER_BLOCK_SIZE - out->fill;
+        n = (len < n) ? len : n;
+        memcpy(out->block + out->fill, data, n);
+        out->fill += n;
+        data += n;
+        len -= n;
+        if (out->fill == IRIS_IMAGE_TRANSFER_BLOCK_SIZE) {
+            if (obc_spi_transfer_block(out->block, IRIS_IMAGE_TRANSFER_BLOCK_SIZE) != HAL_OK) {
+                iris_log("Image block %d not acked by obc", out->sent);
+                return -1;
+            }
+            iris_log("Delivered %d image block to obc", out->sent);
+            out->sent++;
+            out->fill = 0;
+        }
+    }
+    return 0;
+}
+
+/*
+ * Sends a file opened for reading to the OBC a page at a time, each resent
+ * until the OBC acks its CRC, and closes it
+ */
+static int _transfer_file_to_obc(NAND_FILE *file) {
+    uint8_t page[PAGE_DATA_SIZE];
+    int ret;
+
+    int file_size = file->node.file_size;
+    int page_cnt = ((file_size + (PAGE_DATA_SIZE - 1)) / PAGE_DATA_SIZE);
+
+    // below reads out a 2048 byte page, then splits it into 4 512 chunks to transmit over spi
+    for (int count = 0; count < page_cnt; count++) {
+        ret = NANDfs_read(file, PAGE_DATA_SIZE, page);
+        if (ret < 0) {
+            iris_log("not able to read file %d failed: %d\r\n", file, nand_errno);
+            NANDfs_close(file);
+            return -1;
+        }
+        if (obc_spi_transfer_block(page, PAGE_DATA_SIZE) != HAL_OK) {
+            iris_log("Page %d not acked by obc", count);
+            NANDfs_close(file);
+            return -1;
+        }
+    }
+
+    ret = NANDfs_close(file);
+    if (ret < 0) {
+        iris_log("not able to close file %d failed: %d\r\n", file, nand_errno);
+        return -1;
+    }
+    return 0;
+}
+
 /**
  * @brief Transfer image data from Iris to OBC
  *
  * Currently using direct register access method to get image data via
  * reading data register from Arducam module.
  *
+ * The OBC is told the FIFO length, so that many blocks are sent. They carry
+ * only the JPEG, from SOI to EOI, and are zero filled after it without
+ * reading the rest of the FIFO. Each block is resent until the OBC acks its
+ * CRC, and one it never acks ends the transfer with the sensor unchanged.
+ *
  * TODO: Update data retrieval once NAND fs is intergrated
  */
-void transfer_image_to_obc_direct_method() {
+int transfer_image_to_obc_direct_method() {
     iris_log("Image delivery started (direct method)");
     uint8_t image_data[IRIS_IMAGE_TRANSFER_BLOCK_SIZE];
+    uint8_t chunk[32];
     uint16_t num_transfers;
     uint32_t image_length;
+    obc_block_sink_t out = {.block = image_data, .fill = 0, .sent = 0};
+    jpeg_framer_t framer;
 
     image_length = (uint32_t)read_fifo_length(sensor);
     num_transfers =
         (uint16_t)((image_length + (IRIS_IMAGE_TRANSFER_BLOCK_SIZE - 1)) / IRIS_IMAGE_TRANSFER_BLOCK_SIZE);
 
+    jpeg_framer_init(&framer);
     spi_init_burst(sensor);
-    for (int j = 0; j < num_transfers; j++) {
-        for (int i = 0; i < IRIS_IMAGE_TRANSFER_BLOCK_SIZE; i++) {
-            image_data[i] = (uint8_t)spi_read_burst(sensor);
+    for (uint32_t i = 0; i < image_length && !jpeg_framer_done(&framer); i += sizeof(chunk)) {
+        uint32_t n = (image_length - i < sizeof(chunk)) ? image_length - i : sizeof(chunk);
+        spi_read_burst_buf(sensor, chunk, n);
+        if (jpeg_framer_feed(&framer, chunk, n, _obc_block_sink, &out) < 0) {
+            spi_deinit_burst(sensor);
+            return -1;
         }
-
-        iris_log("Delivered %d image block to obc", j);
-        obc_spi_transmit(image_data, IRIS_IMAGE_TRANSFER_BLOCK_SIZE);
     }
     spi_deinit_burst(sensor);
 
-    iris_log("Image delivery ended");
+    // Zero fill the blocks the OBC still expects
+    while (out.sent < num_transfers) {
+        memset(image_data + out.fill, 0, IRIS_IMAGE_TRANSFER_BLOCK_SIZE - out.fill);
+        if (obc_spi_transfer_block(image_data, IRIS_IMAGE_TRANSFER_BLOCK_SIZE) != HAL_OK) {
+            iris_log("Image block %d not acked by obc", out.sent);
+            return -1;
+        }
+        iris_log("Delivered %d image block to obc", out.sent);
+        out.sent++;
+        out.fill = 0;
+    }
+
+    iris_log("Image delivery ended, %d JPEG bytes", framer.length);
     // Once done capturing with current sensor switch to counterpart
     if (sensor == VIS_SENSOR) {
         iris_log("DONE IMAGE TRANSFER (VIS_SENSOR)!\r\n");
@@ -270,43 +482,113 @@ void transfer_image_to_obc_direct_method() {
         iris_log("DONE IMAGE TRANSFER (NIR_SENSOR)!\r\n");
         sensor = VIS_SENSOR;
     }
+    return 0;
 }
 
 int transfer_images_to_obc_nand_method(uint8_t image_index) {
     iris_log("Image delivery started (NAND method)");
 
-    uint8_t page[PAGE_DATA_SIZE];
-    int ret;
-
     NAND_FILE *file = get_image_file_from_queue(image_index);
     if (!file) {
         iris_log("not able to open file %d failed: %d", file, nand_errno);
         return -1;
     }
+    if (_transfer_file_to_obc(file) < 0) {
+        return -1;
+    }
 
-    int file_size = file->node.file_size;
-    int page_cnt = ((file_size + (PAGE_DATA_SIZE - 1)) / PAGE_DATA_SIZE);
+    iris_log("Image delivery ended");
+    return 0;
+}
 
-    // below reads out a 2048 byte page, then splits it into 4 512 chunks to transmit over spi
-    for (int count = 0; count < page_cnt; count++) {
-        ret = NANDfs_read(file, PAGE_DATA_SIZE, page);
-        if (ret < 0) {
-            iris_log("not able to read file %d failed: %d\r\n", file, nand_errno);
-            return -1;
-        }
-        obc_spi_transmit(page, PAGE_DATA_SIZE);
-    }
+/**
+ * @brief Transfer the thumbnail of a queued image from Iris to OBC
+ *
+ * Sent in blocks like the image, each resent until the OBC acks its CRC.
+ * The OBC has its size from the thumbnail list. The image stays queued.
+ *
+ * @param image_index: Queue index of the image
+ */
+int transfer_thumbnail_to_obc(uint8_t image_index) {
+    iris_log("Thumbnail delivery started");
 
-    ret = NANDfs_close(file);
-    if (ret < 0) {
-        iris_log("not able to close file %d failed: %d\r\n", file, nand_errno);
+    NAND_FILE *file = get_thumbnail_file_from_queue(image_index);
+    if (!file) {
+        return -1;
+    }
+    if (_transfer_file_to_obc(file) < 0) {
         return -1;
     }
 
-    iris_log("Image delivery ended");
+    iris_log("Thumbnail delivery ended");
     return 0;
 }
 
+/**
+ * @brief Transfer a byte window of a stored file from Iris to OBC
+ *
+ * An ack (0xAA) goes first if the file can be opened and moved to offset,
+ * otherwise a nack (0x0F) and nothing else, either with its CRC. After an ack, length bytes are
+ * sent a page at a time with the CRC of each after it, and the bytes past
+ * the end of the file are zero. A page that can't be read ends the transfer
+ * there, so the OBC's CRC check fails from that page on. The file is left on
+ * NAND, so a window lost on the link, or a page whose CRC doesn't match, is
+ * simply asked for again.
+ *
+ * @param file_id: Id of the file, as listed by IRIS_LIST_IMAGES
+ * @param offset: Byte offset of the window in the stored file
+ * @param length: Bytes in the window
+ */
+int transfer_window_to_obc(uint32_t file_id, uint32_t offset, uint32_t length) {
+    uint8_t page[PAGE_DATA_SIZE];
+    uint8_t status = 0x0F; // nack
+    uint32_t available = 0;
+    int ret = 0;
+
+    iris_log("Window delivery started, file %d at %d for %d", file_id, offset, length);
+
+    NAND_FILE *file = NANDfs_open(file_id);
+    if (!file) {
+        iris_log("not able to open file %d failed: %d", file_id, nand_errno);
+    } else if (offset < file->node.file_size && NANDfs_seek(file, offset) < 0) {
+        iris_log("not able to seek file %d failed: %d", file_id, nand_errno);
+    } else {
+        status = 0xAA; // ack
+        if (offset < file->node.file_size) {
+            available = file->node.file_size - offset;
+        }
+    }
+    obc_spi_transmit_block(&status, 1);
+    if (status != 0xAA) {
+        if (file) {
+            NANDfs_close(file);
+        }
+        return -1;
+    }
+
+    while (length > 0) {
+        uint32_t n = (length < PAGE_DATA_SIZE) ? length : PAGE_DATA_SIZE;
+        uint32_t data = (available < n) ? available : n;
+
+        if (data > 0 && NANDfs_read(file, data, page) < 0) {
+            iris_log("not able to read file %d failed: %d", file_id, nand_errno);
+            ret = -1;
+            break;
+        }
+        memset(page + data, 0, n - data);
+        obc_spi_transmit_block(page, n);
+        available -= data;
+        length -= n;
+    }
+
+    if (NANDfs_close(file) < 0) {
+        iris_log("not able to close file %d failed: %d", file_id, nand_errno);
+        ret = -1;
+    }
+    iris_log("Window delivery ended");
+    return ret;
+}
+
 int transfer_log_to_obc() {
     clear_and_dump_buffer();
 
@@ -323,7 +605,10 @@ int transfer_log_to_obc() {
                 iris_log("read b %d p %d r %d\r\n", blk, pg, ret);
                 return ret;
             }
-            obc_spi_transmit(buffer, IRIS_LOG_TRANSFER_BLOCK_SIZE);
+            if (obc_spi_transfer_block(buffer, IRIS_LOG_TRANSFER_BLOCK_SIZE) != HAL_OK) {
+                iris_log("Log page b %d p %d not acked by obc", blk, pg);
+                return -1;
+            }
         }
     }
     return 0;
@@ -0,0 +1,454 @@
+/*
+ * codec_bench.c
+ *
+ * Runs every codec over a corpus of Iris captures and generated patterns
+ * and reports, per codec and file, the compression ratio, coding and
+ * decoding speed on this machine, the working memory the codec needs on
+ * the MCU and an estimate of the Cortex-M0+ cycles it would take. Every
+ * result is decoded again and compared, so it doubles as a round trip test.
+ *
+ * The cycle estimate scales the operations each codec performed here (bytes
+ * in, bytes out, sink calls, windows) by the cycles its inner loops take per
+ * operation on the M0+, estimated by hand from the loads, stores, ALU ops
+ * and branches in those loops: 1 cycle an ALU op, 2 a load, store or taken
+ * branch, no divider. It is a guide for picking a codec, not a measurement.
+ *
+ * The corpus defaults to host/jlc.jpeg, host/img1.yuv422 and the patterns
+ * below, which include host/gen-test.c's colour ramps. Files are given as
+ * name[:bayer|yuv[:line_bytes]], the layout and line length LOCO codes
+ * them with.
+ *
+ * Build from the repository root:
+ *   gcc -O2 -ICore/Inc/drivers/compression -o host/codec_bench host/codec_bench.c \
+ *       Core/Src/drivers/compression/rle.c Core/Src/drivers/compression/rle_stream.c \
+ *       Core/Src/drivers/compression/loco.c
+ *   host/codec_bench
+ *   host/codec_bench -i capture.raw:bayer:1280 -i host/img1.yuv422:yuv:2560
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+
+#include "rle.h"
+#include "rle_stream.h"
+#include "loco.h"
+
+#define MAX_NAME_LEN 64
+#define MAX_CORPUS 16
+#define FIFO_CHUNK 256  // CAMERA_CHUNK_SIZE in command_handler.c
+#define NAND_PAGE 2048  // PAGE_DATA_SIZE
+#define MCU_HZ 32000000 // STM32L071 at its fastest clock
+
+static int failures;
+
+#define CHECK(cond, ...)                                                                                           \
+    do {                                                                                                           \
+        if (!(cond)) {                                                                                             \
+            fprintf(stderr, "FAIL %s:%d: ", __FILE__, __LINE__);                                                   \
+            fprintf(stderr, __VA_ARGS__);                                                                          \
+            fprintf(stderr, "\n");                                                                                 \
+            failures++;                                                                                            \
+        }                                                                                                          \
+    } while (0)
+
+typedef struct {
+    char name[MAX_NAME_LEN * 4];
+    uint8_t *data;
+    uint32_t len;
+    loco_layout_t layout;
+    uint16_t line;
+} corpus_t;
+
+typedef struct {
+    uint8_t *data;
+    uint32_t len;
+    uint32_t size;
+    uint32_t calls;
+} buffer_t;
+
+/*
+ * Operations a codec performed on one file, what the cycle model scales
+ */
+typedef struct {
+    uint32_t in;    // bytes into the coder
+    uint32_t out;   // bytes out of the coder
+    uint32_t calls; // sink calls
+} ops_t;
+
+/*
+ * M0+ cycles a coder or decoder spends per operation
+ */
+typedef struct {
+    uint16_t per_in;
+    uint16_t per_out;
+    uint16_t per_call;
+    uint32_t per_run; // once a file, or once a window for rle_stream
+} cost_t;
+
+typedef struct {
+    uint32_t coded;
+    double enc_ms;
+    double dec_ms;
+    uint32_t memory; // bytes of RAM the MCU needs to code
+    uint64_t enc_cycles;
+    uint64_t dec_cycles;
+    int ok;
+} result_t;
+
+typedef struct {
+    const char *name;
+    // code c into coded, or return < 0 if the codec can't code it
+    int (*encode)(const corpus_t *c, buffer_t *coded, uint32_t *memory);
+    void (*decode)(const buffer_t *coded, buffer_t *decoded);
+    cost_t enc;
+    cost_t dec;
+    uint32_t window; // input bytes per per_run of the coder, 0 for once a file
+} codec_t;
+
+static int buffer_sink(const uint8_t *data, uint32_t len, void *arg) {
+    buffer_t *out = (buffer_t *)arg;
+
+    if (out->len + len > out->size) {
+        return -7;
+    }
+    memcpy(out->data + out->len, data, len);
+    out->len += len;
+    out->calls++;
+    return 0;
+}
+
+static double now_ms(void) {
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e3 + ts.tv_nsec / 1e6;
+}
+
+/*
+ * RLE_Compress and RLE_Uncompress need the whole input and output in RAM
+ */
+static int rle_whole_encode(const corpus_t *c, buffer_t *coded, uint32_t *memory) {
+    coded->len = RLE_Compress(c->data, coded->data, c->len);
+    coded->calls = 1;
+    *memory = c->len + (c->len * 104 + 50) / 100 + 384;
+    return 0;
+}
+
+static void rle_whole_decode(const buffer_t *coded, buffer_t *decoded) {
+    // the coded data doesn't say how long the input was, the caller sized decoded to it
+    RLE_Uncompress(coded->data, decoded->data, coded->len);
+    decoded->len = decoded->size;
+    decoded->calls = 1;
+}
+
+/*
+ * The streaming coders get the input a FIFO chunk at a time and the coded
+ * data a NAND page at a time, as on the MCU
+ */
+static int rle_stream_encode(const corpus_t *c, buffer_t *coded, uint32_t *memory) {
+    static rle_stream_t s;
+    int ret = 0;
+
+    rle_stream_init(&s, buffer_sink, coded);
+    for (uint32_t i = 0; i < c->len && ret == 0; i += FIFO_CHUNK) {
+        ret = rle_stream_feed(&s, c->data + i, (c->len - i < FIFO_CHUNK) ? c->len - i : FIFO_CHUNK);
+    }
+    *memory = sizeof(s) + FIFO_CHUNK;
+    return (ret < 0) ? ret : rle_stream_finish(&s);
+}
+
+static void rle_stream_decode(const buffer_t *coded, buffer_t *decoded) {
+    static rle_decoder_t d;
+    int ret = 0;
+
+    rle_decoder_init(&d, buffer_sink, decoded);
+    for (uint32_t i = 0; i < coded->len && ret == 0; i += NAND_PAGE) {
+        ret = rle_decoder_feed(&d, coded->data + i, (coded->len - i < NAND_PAGE) ? coded->len - i : NAND_PAGE);
+    }
+    if (ret == 0) {
+        rle_decoder_finish(&d);
+    }
+}
+
+static int loco_bench_encode(const corpus_t *c, buffer_t *coded, uint32_t *memory) {
+    static loco_t l;
+    int ret = 0;
+
+    if (loco_encoder_init(&l, c->layout, c->line, buffer_sink, coded) < 0) {
+        return -1;
+    }
+    for (uint32_t i = 0; i < c->len && ret == 0; i += FIFO_CHUNK) {
+        ret = loco_encode(&l, c->data + i, (c->len - i < FIFO_CHUNK) ? c->len - i : FIFO_CHUNK);
+    }
+    *memory = sizeof(l) + FIFO_CHUNK;
+    return (ret < 0) ? ret : loco_encoder_finish(&l);
+}
+
+static void loco_bench_decode(const buffer_t *coded, buffer_t *decoded) {
+    static loco_t l;
+    int ret = 0;
+
+    loco_decoder_init(&l, buffer_sink, decoded);
+    for (uint32_t i = 0; i < coded->len && ret == 0; i += NAND_PAGE) {
+        ret = loco_decode(&l, coded->data + i, (coded->len - i < NAND_PAGE) ? coded->len - i : NAND_PAGE);
+    }
+    if (ret == 0) {
+        loco_decoder_finish(&l);
+    }
+}
+
+/*
+ * Cycles per operation, from the inner loops:
+ *  RLE_Compress: histogram 7 and coding 9 a byte, 3 a byte written, the
+ *      256 entry marker search. RLE_Uncompress: 8 a code byte, 3 a byte out.
+ *  rle_stream: saturating histogram, run compare and window count 20 a
+ *      byte, 4 a byte written, a 256 entry marker search and histogram clear
+ *      every window. Decoder: 14 a code byte, 2 a byte out (memset).
+ *  loco: ring lookups, MED, gradient class, Rice parameter search and
+ *      context update 60 a byte, the bit writer 14 a byte written. Decoder:
+ *      the same model 62 a byte out, the bit reader and unary scan 20 a
+ *      code byte.
+ *  A sink call, with the call into NANDfs, is 40.
+ */
+static const codec_t codecs[] = {
+    {"RLE_Compress", rle_whole_encode, rle_whole_decode, {16, 3, 0, 256 * 6}, {8, 3, 0, 0}, 0},
+    {"rle_stream", rle_stream_encode, rle_stream_decode, {20, 4, 40, 256 * 6 + 256 / 2}, {14, 2, 40, 0},
+     RLE_STREAM_WINDOW},
+    {"loco", loco_bench_encode, loco_bench_decode, {60, 14, 40, 0}, {20, 62, 40, 0}, 0},
+};
+
+#define NUM_CODECS (sizeof(codecs) / sizeof(codecs[0]))
+
+static uint64_t cycles(const cost_t *cost, const ops_t *ops, uint32_t window) {
+    uint64_t runs = window ? (ops->in + window - 1) / window : 1;
+
+    return (uint64_t)cost->per_in * ops->in + (uint64_t)cost->per_out * ops->out +
+           (uint64_t)cost->per_call * ops->calls + (uint64_t)cost->per_run * runs;
+}
+
+static int bench(const corpus_t *c, const codec_t *codec, result_t *r) {
+    // worst case is a LOCO escape, 3 bytes a byte
+    uint32_t bound = c->len * 3 + 512;
+    buffer_t coded = {.data = malloc(bound), .size = bound};
+    buffer_t decoded = {.data = malloc(c->len), .size = c->len};
+
+    if (!coded.data || !decoded.data) {
+        CHECK(0, "out of memory");
+        return -1;
+    }
+    double t0 = now_ms();
+    int ret = codec->encode(c, &coded, &r->memory);
+    double t1 = now_ms();
+    if (ret == 0) {
+        codec->decode(&coded, &decoded);
+        double t2 = now_ms();
+        ops_t enc = {.in = c->len, .out = coded.len, .calls = coded.calls};
+        ops_t dec = {.in = coded.len, .out = decoded.len, .calls = decoded.calls};
+
+        r->coded = coded.len;
+        r->enc_ms = t1 - t0;
+        r->dec_ms = t2 - t1;
+        r->enc_cycles = cycles(&codec->enc, &enc, codec->window);
+        r->dec_cycles = cycles(&codec->dec, &dec, 0);
+        r->ok = decoded.len == c->len && memcmp(decoded.data, c->data, c->len) == 0;
+        CHECK(r->ok, "%s on %s: round trip gave %u bytes of %u", codec->name, c->name, decoded.len, c->len);
+    }
+    free(coded.data);
+    free(decoded.data);
+    return ret;
+}
+
+/*
+ * Captures dumped over the UART, like host/img1.yuv422, are hex text. Turns
+ * them into the FIFO bytes in place, returns the byte count, or len if the
+ * file is binary.
+ */
+static uint32_t unhex(uint8_t *buf, uint32_t len) {
+    uint32_t n = 0;
+    int digits = 0;
+    uint8_t b = 0;
+
+    for (uint32_t i = 0; i < len; i++) {
+        uint8_t c = buf[i];
+        if (c == ' ' || c == '\n' || c == '\r') {
+            if (digits) {
+                buf[n++] = b;
+            }
+            digits = 0;
+            b = 0;
+            continue;
+        }
+        int v = (c >= '0' && c <= '9') ? c - '0' : (c >= 'a' && c <= 'f') ? c - 'a' + 10
+                                                  : (c >= 'A' && c <= 'F') ? c - 'A' + 10
+                                                                           : -1;
+        if (v < 0 || ++digits > 2) {
+            return len;
+        }
+        b = (uint8_t)(b << 4 | v);
+    }
+    if (digits) {
+        buf[n++] = b;
+    }
+    return n;
+}
+
+static int load_file(corpus_t *c, const char *spec) {
+    char layout[8] = "bayer";
+    int line = 1280;
+
+    strncpy(c->name, spec, sizeof(c->name) - 1);
+    char *colon = strchr(c->name, ':');
+    if (colon) {
+        *colon = 0;
+        sscanf(colon + 1, "%7[a-z]:%d", layout, &line);
+    }
+    c->layout = (strcmp(layout, "yuv") == 0) ? LOCO_YUV422 : LOCO_BAYER8;
+    c->line = (uint16_t)line;
+
+    FILE *f = fopen(c->name, "rb");
+    if (!f) {
+        CHECK(0, "can't open %s", c->name);
+        return -1;
+    }
+    fseek(f, 0, SEEK_END);
+    c->len = (uint32_t)ftell(f);
+    fseek(f, 0, SEEK_SET);
+    c->data = malloc(c->len ? c->len : 1);
+    if (!c->data || fread(c->data, 1, c->len, f) != c->len) {
+        CHECK(0, "can't read %s", c->name);
+        fclose(f);
+        return -1;
+    }
+    fclose(f);
+    c->len = unhex(c->data, c->len);
+    return 0;
+}
+
+/*
+ * host/gen-test.c's ramps: bands 16 rows high of red, green, blue and their
+ * mixes rising along the row, as RGB888
+ */
+static void gen_ramps(corpus_t *c, int width, int height) {
+    snprintf(c->name, sizeof(c->name), "gen-test ramps %dx%d RGB", width, height);
+    c->len = width * height * 3;
+    c->data = calloc(c->len, 1);
+    c->layout = LOCO_BAYER8;
+    c->line = width * 3;
+    for (int row = 0; row < height; row++) {
+        uint8_t *data = c->data + row * width * 3;
+        for (int i = 0; i < width * 3; i += 3) {
+            static const uint8_t bands[7] = {1, 2, 4, 5, 6, 3, 7}; // colours lit in each band
+            uint8_t lit = bands[(row / 16 < 6) ? row / 16 : 6];
+            for (int p = 0; p < 3; p++) {
+                if (lit & (1 << p)) {
+                    data[i + p] = i / 3;
+                }
+            }
+        }
+    }
+}
+
+/*
+ * A Bayer RAW8 frame: a smooth scene per colour plane with sensor noise
+ */
+static void gen_bayer(corpus_t *c, int width, int height) {
+    snprintf(c->name, sizeof(c->name), "Bayer gradient %dx%d + noise", width, height);
+    c->len = width * height;
+    c->data = malloc(c->len);
+    c->layout = LOCO_BAYER8;
+    c->line = width;
+    for (int y = 0; y < height; y++) {
+        for (int x = 0; x < width; x++) {
+            int plane = ((y & 1) << 1) | (x & 1);
+            int v = 40 + plane * 20 + x / 16 + y / 4 + rand() % 7;
+            c->data[y * width + x] = (uint8_t)(v > 255 ? 255 : v);
+        }
+    }
+}
+
+static void gen_fill(corpus_t *c, const char *name, uint32_t len, int noise) {
+    snprintf(c->name, sizeof(c->name), "%s %u bytes", name, len);
+    c->len = len;
+    c->data = malloc(len);
+    c->layout = LOCO_BAYER8;
+    c->line = 1024;
+    for (uint32_t i = 0; i < len; i++) {
+        c->data[i] = noise ? (uint8_t)rand() : 0x80;
+    }
+}
+
+static void report(const corpus_t *c) {
+    printf("%s: %u bytes\n", c->name, c->len);
+    printf("  %-13s %8s %7s %9s %9s %8s %9s %9s %9s\n", "codec", "bytes", "ratio", "enc MB/s", "dec MB/s",
+           "RAM", "enc c/B", "dec c/B", "enc ms");
+
+    for (size_t k = 0; k < NUM_CODECS; k++) {
+        result_t r = {0};
+        if (bench(c, &codecs[k], &r) < 0) {
+            printf("  %-13s can't code this file\n", codecs[k].name);
+            continue;
+        }
+        printf("  %-13s %8u %6.1f%% %9.1f %9.1f %8u %9.1f %9.1f %9.0f%s\n", codecs[k].name, r.coded,
+               100.0 * r.coded / c->len, r.enc_ms > 0 ? c->len / r.enc_ms / 1e3 : 0.0,
+               r.dec_ms > 0 ? c->len / r.dec_ms / 1e3 : 0.0, r.memory, (double)r.enc_cycles / c->len,
+               (double)r.dec_cycles / c->len, 1e3 * r.enc_cycles / MCU_HZ, r.ok ? "" : "  MISMATCH");
+    }
+}
+
+void usage(const char *pgm) {
+    const char *name = (pgm) ? pgm : "usage";
+
+    fprintf(stderr, "%s [-i file[:bayer|yuv[:line_bytes]]]... [-s seed]\n", name);
+    exit(1);
+}
+
+int main(int argc, char **argv) {
+    static corpus_t corpus[MAX_CORPUS];
+    int count = 0;
+    int i = 1;
+
+    while (i < argc) {
+        if (argv[i][0] != '-' || argv[i][2] != 0 || i + 1 >= argc) {
+            usage(argv[0]);
+        }
+        switch (argv[i][1]) {
+        case 'i':
+            if (count < MAX_CORPUS - 4 && load_file(&corpus[count], argv[i + 1]) == 0) {
+                count++;
+            }
+            break;
+        case 's':
+            srand((unsigned)atoi(argv[i + 1]));
+            break;
+        default:
+            usage(argv[0]);
+        }
+        i += 2;
+    }
+
+    if (count == 0) {
+        if (load_file(&corpus[count], "host/jlc.jpeg") == 0) {
+            count++;
+        }
+        if (load_file(&corpus[count], "host/img1.yuv422:yuv:2560") == 0) {
+            count++;
+        }
+    }
+    gen_ramps(&corpus[count++], 320, 120);
+    gen_bayer(&corpus[count++], 1280, 96);
+    gen_fill(&corpus[count++], "flat", 65536, 0);
+    gen_fill(&corpus[count++], "noise", 65536, 1);
+
+    printf("RAM is what the MCU holds to code, c/B and ms are estimated M0+ cycles a raw byte and coding time at "
+           "%d MHz\n\n",
+           MCU_HZ / 1000000);
+    for (int k = 0; k < count; k++) {
+        report(&corpus[k]);
+        free(corpus[k].data);
+    }
+
+    printf("%s\n", failures ? "FAIL" : "PASS");
+    return failures ? 1 : 0;
+}
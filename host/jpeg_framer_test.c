@@ -0,0 +1,265 @@
+/*
+ * jpeg_framer_test.c
+ *
+ * Feeds the JPEG framer synthetic FIFO contents, a JPEG with padding and
+ * stale data around it, in chunks of every size from 1 byte up, and checks
+ * it passes on exactly the bytes from SOI to the first EOI:
+ *  - SOI and EOI split across chunks
+ *  - FF 00 stuffing, fill bytes and a stale FFD8 inside the JPEG
+ *  - no SOI at all, and a JPEG cut off before its EOI
+ *  - a failing sink stops the framer with its error
+ *  - a burst FIFO with several JPEGs, each framed by a new framer starting
+ *    where the last one stopped
+ *
+ * Build from the repository root:
+ *   gcc -O2 -ICore/Inc/drivers/arducam -o host/jpeg_framer_test host/jpeg_framer_test.c \
+ *       Core/Src/drivers/arducam/jpeg_framer.c
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "jpeg_framer.h"
+
+#define MAX_NAME_LEN 64
+#define MAX_FIFO 8192
+
+static int failures;
+
+#define CHECK(cond, ...)                                                                                           \
+    do {                                                                                                           \
+        if (!(cond)) {                                                                                             \
+            fprintf(stderr, "FAIL %s:%d: ", __FILE__, __LINE__);                                                   \
+            fprintf(stderr, __VA_ARGS__);                                                                          \
+            fprintf(stderr, "\n");                                                                                 \
+            failures++;                                                                                            \
+        }                                                                                                          \
+    } while (0)
+
+typedef struct {
+    uint8_t data[MAX_FIFO];
+    uint32_t len;
+    uint32_t fail_at; // sink fails once this many bytes were taken, 0 never
+} capture_t;
+
+static int capture_sink(const uint8_t *data, uint32_t len, void *arg) {
+    capture_t *out = (capture_t *)arg;
+
+    if (out->fail_at && out->len + len >= out->fail_at) {
+        return -5;
+    }
+    memcpy(out->data + out->len, data, len);
+    out->len += len;
+    return 0;
+}
+
+/*
+ * Builds a FIFO image: pre bytes of padding, a JPEG of body bytes, then post
+ * bytes of stale data holding another SOI/EOI pair. Returns the FIFO length
+ * and the JPEG's offset and length.
+ */
+static uint32_t build_fifo(uint8_t *fifo, uint32_t pre, uint32_t body, uint32_t post, uint32_t *jpeg_off,
+                           uint32_t *jpeg_len) {
+    uint32_t n = 0;
+
+    for (uint32_t i = 0; i < pre; i++) {
+        fifo[n++] = (i % 7 == 6) ? 0xff : (uint8_t)(rand() % 0xd0); // FF without D8 after it
+    }
+    *jpeg_off = n;
+    fifo[n++] = 0xff;
+    fifo[n++] = 0xd8;
+    for (uint32_t i = 0; i < body; i++) {
+        uint8_t b = (uint8_t)rand();
+        if (b == 0xff) {
+            fifo[n++] = 0xff;
+            b = (i & 1) ? 0x00 : 0xd8; // stuffing, or a stray SOI the framer must pass on
+        }
+        fifo[n++] = b;
+    }
+    fifo[n++] = 0xff; // fill byte before EOI
+    fifo[n++] = 0xff;
+    fifo[n++] = 0xd9;
+    *jpeg_len = n - *jpeg_off;
+    for (uint32_t i = 0; i < post; i++) {
+        fifo[n++] = (i == post / 2) ? 0xd8 : (i == post / 2 - 1) ? 0xff : (uint8_t)rand();
+    }
+    return n;
+}
+
+static int frame(const uint8_t *fifo, uint32_t len, uint32_t chunk, capture_t *out, jpeg_framer_t *framer,
+                 uint32_t *consumed) {
+    int ret = 0;
+    uint32_t i;
+
+    jpeg_framer_init(framer);
+    out->len = 0;
+    for (i = 0; i < len && !jpeg_framer_done(framer); i += chunk) {
+        uint32_t n = (len - i < chunk) ? len - i : chunk;
+        ret = jpeg_framer_feed(framer, fifo + i, n, capture_sink, out);
+        if (ret < 0) {
+            break;
+        }
+    }
+    *consumed = (i < len) ? i : len;
+    return ret;
+}
+
+static void test_chunks(uint32_t pre, uint32_t body, uint32_t post) {
+    static uint8_t fifo[MAX_FIFO];
+    static capture_t out;
+    jpeg_framer_t framer;
+    uint32_t jpeg_off, jpeg_len, consumed;
+    uint32_t len = build_fifo(fifo, pre, body, post, &jpeg_off, &jpeg_len);
+    int bad = 0;
+
+    for (uint32_t chunk = 1; chunk <= len; chunk += (chunk < 40) ? 1 : 97) {
+        int ret = frame(fifo, len, chunk, &out, &framer, &consumed);
+        bad += ret != 0;
+        bad += !jpeg_framer_done(&framer);
+        bad += out.len != jpeg_len || framer.length != jpeg_len;
+        bad += memcmp(out.data, fifo + jpeg_off, jpeg_len) != 0;
+        bad += consumed > ((jpeg_off + jpeg_len + chunk - 1) / chunk) * chunk; // read past the EOI chunk
+        if (bad) {
+            CHECK(0, "pre %u body %u: %u byte chunks framed %u bytes, JPEG is %u at %u", pre, body, chunk, out.len,
+                  jpeg_len, jpeg_off);
+            return;
+        }
+    }
+    printf("pre %4u body %4u post %4u: %u byte JPEG out of %u FIFO bytes, every chunking\n", pre, body, post,
+           jpeg_len, len);
+}
+
+static void test_no_jpeg(void) {
+    static uint8_t fifo[1024];
+    static capture_t out;
+    jpeg_framer_t framer;
+    uint32_t consumed;
+
+    for (uint32_t i = 0; i < sizeof(fifo); i++) {
+        fifo[i] = (i & 1) ? 0xd9 : 0xff; // EOIs and no SOI
+    }
+    frame(fifo, sizeof(fifo), 16, &out, &framer, &consumed);
+    CHECK(framer.state == JPEG_FRAMER_SEEK && out.len == 0, "no SOI: %u bytes passed on", out.len);
+}
+
+static void test_truncated(void) {
+    static uint8_t fifo[MAX_FIFO];
+    static capture_t out;
+    jpeg_framer_t framer;
+    uint32_t jpeg_off, jpeg_len, consumed;
+    uint32_t len = build_fifo(fifo, 10, 500, 0, &jpeg_off, &jpeg_len);
+
+    len -= 3; // cut off the fill byte and EOI
+    frame(fifo, len, 64, &out, &framer, &consumed);
+    CHECK(framer.state == JPEG_FRAMER_BODY, "cut off JPEG: framer state %d", framer.state);
+    CHECK(out.len == len - jpeg_off, "cut off JPEG: %u bytes passed on, %u expected", out.len, len - jpeg_off);
+}
+
+static void test_sink_error(void) {
+    static uint8_t fifo[MAX_FIFO];
+    static capture_t out;
+    jpeg_framer_t framer;
+    uint32_t jpeg_off, jpeg_len, consumed;
+    uint32_t len = build_fifo(fifo, 10, 1000, 100, &jpeg_off, &jpeg_len);
+
+    out.fail_at = 300;
+    int ret = frame(fifo, len, 64, &out, &framer, &consumed);
+    out.fail_at = 0;
+    CHECK(ret == -5, "sink error came back as %d", ret);
+    CHECK(consumed < 400, "framer went on for %u bytes after the sink failed", consumed);
+}
+
+/*
+ * Frames every JPEG of a burst FIFO the way transfer_burst_to_nand does:
+ * one pass over the FIFO, a new framer at the used offset after each EOI.
+ */
+static void test_burst(uint32_t frames, uint32_t gap) {
+    static uint8_t fifo[MAX_FIFO];
+    static capture_t out[8];
+    uint32_t jpeg_off[8], jpeg_len[8];
+    uint32_t len = 0;
+
+    for (uint32_t f = 0; f < frames; f++) {
+        uint32_t off, n;
+        len += build_fifo(fifo + len, (f == 0) ? 5 : gap, 200 + 150 * f, 0, &off, &n);
+        jpeg_off[f] = len - n;
+        jpeg_len[f] = n;
+    }
+    for (uint32_t i = 0; i < 40; i++) {
+        fifo[len++] = (uint8_t)rand(); // stale data after the burst
+    }
+
+    for (uint32_t chunk = 1; chunk <= len; chunk += (chunk < 40) ? 1 : 61) {
+        jpeg_framer_t framer;
+        uint32_t stored = 0;
+        uint32_t i;
+
+        jpeg_framer_init(&framer);
+        out[0].len = 0;
+        for (i = 0; i < len && stored < frames; i += chunk) {
+            uint32_t n = (len - i < chunk) ? len - i : chunk;
+            uint32_t offset = 0;
+
+            while (offset < n && stored < frames) {
+                jpeg_framer_feed(&framer, fifo + i + offset, n - offset, capture_sink, &out[stored]);
+                offset += framer.used;
+                if (jpeg_framer_done(&framer)) {
+                    stored++;
+                    jpeg_framer_init(&framer);
+                    out[stored].len = 0;
+                }
+            }
+        }
+        int bad = stored != frames;
+        for (uint32_t f = 0; f < stored && !bad; f++) {
+            bad = out[f].len != jpeg_len[f] || memcmp(out[f].data, fifo + jpeg_off[f], jpeg_len[f]) != 0;
+        }
+        bad |= i > ((jpeg_off[frames - 1] + jpeg_len[frames - 1] + chunk - 1) / chunk) * chunk;
+        if (bad) {
+            CHECK(0, "burst of %u, gap %u: %u byte chunks framed %u JPEGs", frames, gap, chunk, stored);
+            return;
+        }
+    }
+    printf("burst %u frames gap %4u: %u FIFO bytes, every chunking\n", frames, gap, len);
+}
+
+void usage(const char *pgm) {
+    const char *name = (pgm) ? pgm : "usage";
+
+    fprintf(stderr, "%s [-s seed]\n", name);
+    exit(1);
+}
+
+int main(int argc, char **argv) {
+    int i = 1;
+
+    while (i < argc) {
+        if (argv[i][0] != '-' || argv[i][2] != 0 || i + 1 >= argc) {
+            usage(argv[0]);
+        }
+        switch (argv[i][1]) {
+        case 's':
+            srand((unsigned)atoi(argv[i + 1]));
+            break;
+        default:
+            usage(argv[0]);
+        }
+        i += 2;
+    }
+
+    test_chunks(0, 0, 0);
+    test_chunks(0, 300, 50);
+    test_chunks(1, 300, 50);
+    test_chunks(37, 2000, 700);
+    test_chunks(255, 4000, 2048);
+    test_no_jpeg();
+    test_truncated();
+    test_sink_error();
+    test_burst(2, 0);
+    test_burst(3, 1);
+    test_burst(7, 64);
+
+    printf("%s\n", failures ? "FAIL" : "PASS");
+    return failures ? 1 : 0;
+}
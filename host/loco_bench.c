@@ -0,0 +1,344 @@
+/*
+ * loco_bench.c
+ *
+ * Codes a RAW capture with the LOCO coder the way the firmware stores it, a
+ * FIFO chunk at a time, decodes it again a NAND page at a time and checks
+ * the round trip. The ratio is compared with the streaming RLE coder the
+ * firmware falls back to for lines too long for the LOCO ring.
+ *
+ * Also round trips synthetic images of both layouts in chunks of many
+ * sizes, and with -d decodes a LOCO coded file pulled off the NAND.
+ *
+ * Build from the repository root:
+ *   gcc -O2 -ICore/Inc/drivers/compression -o host/loco_bench host/loco_bench.c \
+ *       Core/Src/drivers/compression/loco.c Core/Src/drivers/compression/rle_stream.c
+ *   host/loco_bench -i host/img1.yuv422 -l yuv -w 1280
+ *   host/loco_bench -d capture.loco -o capture.raw
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+
+#include "loco.h"
+#include "rle_stream.h"
+
+#define MAX_NAME_LEN 64
+#define FIFO_CHUNK 256  // CAMERA_CHUNK_SIZE in command_handler.c
+#define NAND_PAGE 2048  // PAGE_DATA_SIZE
+#define SYNTH_LINE 96
+#define SYNTH_LINES 40
+
+static int failures;
+
+#define CHECK(cond, ...)                                                                                           \
+    do {                                                                                                           \
+        if (!(cond)) {                                                                                             \
+            fprintf(stderr, "FAIL %s:%d: ", __FILE__, __LINE__);                                                   \
+            fprintf(stderr, __VA_ARGS__);                                                                          \
+            fprintf(stderr, "\n");                                                                                 \
+            failures++;                                                                                            \
+        }                                                                                                          \
+    } while (0)
+
+typedef struct {
+    uint8_t *data;
+    uint32_t len;
+    uint32_t size;
+} buffer_t;
+
+static int buffer_sink(const uint8_t *data, uint32_t len, void *arg) {
+    buffer_t *out = (buffer_t *)arg;
+
+    if (out->len + len > out->size) {
+        return -7;
+    }
+    memcpy(out->data + out->len, data, len);
+    out->len += len;
+    return 0;
+}
+
+static double now_ms(void) {
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e3 + ts.tv_nsec / 1e6;
+}
+
+static loco_t coder;
+
+static int encode(const uint8_t *in, uint32_t len, loco_layout_t layout, uint16_t line, uint32_t chunk,
+                  buffer_t *out) {
+    int ret;
+
+    out->len = 0;
+    if (loco_encoder_init(&coder, layout, line, buffer_sink, out) < 0) {
+        return -1;
+    }
+    for (uint32_t i = 0; i < len; i += chunk) {
+        uint32_t n = (len - i < chunk) ? len - i : chunk;
+        if ((ret = loco_encode(&coder, in + i, n)) < 0) {
+            return ret;
+        }
+    }
+    ret = loco_encoder_finish(&coder);
+    CHECK(coder.out_bytes == out->len && coder.in_bytes == len, "coder counted %u in, %u out", coder.in_bytes,
+          coder.out_bytes);
+    return ret;
+}
+
+static int decode(const uint8_t *in, uint32_t len, uint32_t chunk, buffer_t *out) {
+    int ret = 0;
+
+    out->len = 0;
+    loco_decoder_init(&coder, buffer_sink, out);
+    for (uint32_t i = 0; i < len && ret == 0; i += chunk) {
+        uint32_t n = (len - i < chunk) ? len - i : chunk;
+        ret = loco_decode(&coder, in + i, n);
+    }
+    return ret ? ret : loco_decoder_finish(&coder);
+}
+
+static uint32_t rle_size(const uint8_t *in, uint32_t len, buffer_t *out) {
+    static rle_stream_t s;
+
+    out->len = 0;
+    rle_stream_init(&s, buffer_sink, out);
+    for (uint32_t i = 0; i < len; i += FIFO_CHUNK) {
+        rle_stream_feed(&s, in + i, (len - i < FIFO_CHUNK) ? len - i : FIFO_CHUNK);
+    }
+    rle_stream_finish(&s);
+    return out->len;
+}
+
+/*
+ * Captures dumped over the UART, like host/img1.yuv422, are hex text. Turns
+ * them into the FIFO bytes in place, returns the byte count, or len if the
+ * file is binary.
+ */
+static uint32_t unhex(uint8_t *buf, uint32_t len) {
+    uint32_t n = 0;
+    int digits = 0;
+    uint8_t b = 0;
+
+    for (uint32_t i = 0; i < len; i++) {
+        uint8_t c = buf[i];
+        if (c == ' ' || c == '\n' || c == '\r') {
+            if (digits) {
+                buf[n++] = b;
+            }
+            digits = 0;
+            b = 0;
+            continue;
+        }
+        int v = (c >= '0' && c <= '9') ? c - '0' : (c >= 'a' && c <= 'f') ? c - 'a' + 10
+                                                  : (c >= 'A' && c <= 'F') ? c - 'A' + 10
+                                                                           : -1;
+        if (v < 0 || ++digits > 2) {
+            return len;
+        }
+        b = (uint8_t)(b << 4 | v);
+    }
+    if (digits) {
+        buf[n++] = b;
+    }
+    return n;
+}
+
+static uint8_t *read_file(const char *name, uint32_t *len) {
+    FILE *f = fopen(name, "rb");
+    if (!f) {
+        return NULL;
+    }
+    fseek(f, 0, SEEK_END);
+    *len = (uint32_t)ftell(f);
+    fseek(f, 0, SEEK_SET);
+    uint8_t *data = malloc(*len ? *len : 1);
+    if (data && fread(data, 1, *len, f) != *len) {
+        free(data);
+        data = NULL;
+    }
+    fclose(f);
+    return data;
+}
+
+static void bench_image(const char *name, loco_layout_t layout, uint16_t line) {
+    uint32_t len;
+    uint8_t *image = read_file(name, &len);
+    if (!image) {
+        CHECK(0, "can't read %s", name);
+        return;
+    }
+    uint32_t file_len = len;
+    len = unhex(image, len);
+    if (len != file_len) {
+        printf("%s: %u bytes of hex text\n", name, file_len);
+    }
+
+    // worst case is an escape, 3 bytes a byte
+    uint32_t bound = len * 3 + 64;
+    buffer_t coded = {.data = malloc(bound), .size = bound};
+    buffer_t decoded = {.data = malloc(len), .size = len};
+    buffer_t rle = {.data = malloc(bound), .size = bound};
+
+    double t0 = now_ms();
+    int ret = encode(image, len, layout, line, FIFO_CHUNK, &coded);
+    double t1 = now_ms();
+    CHECK(ret == 0, "%s: coding failed, %d", name, ret);
+    ret = decode(coded.data, coded.len, NAND_PAGE, &decoded);
+    double t2 = now_ms();
+    CHECK(ret == 0 && decoded.len == len && memcmp(decoded.data, image, len) == 0,
+          "%s: round trip gave %u bytes, ret %d", name, decoded.len, ret);
+    uint32_t rle_len = rle_size(image, len, &rle);
+
+    printf("%s: %u bytes, %s, %u byte lines\n", name, len, layout == LOCO_BAYER8 ? "Bayer" : "YUV422", line);
+    printf("  LOCO: %u bytes (%.1f%%, %.2f bits a byte), %.1f ms coding, %.1f ms decoding, %zu bytes of state\n",
+           coded.len, 100.0 * coded.len / len, 8.0 * coded.len / len, t1 - t0, t2 - t1, sizeof(loco_t));
+    printf("  RLE:  %u bytes (%.1f%%)\n", rle_len, 100.0 * rle_len / len);
+
+    free(image);
+    free(coded.data);
+    free(decoded.data);
+    free(rle.data);
+}
+
+/*
+ * Smooth gradients with noise, edges and flat patches, so every context
+ * and both escapes and long runs of small errors are exercised
+ */
+static void build_synth(uint8_t *buf, uint32_t line, uint32_t lines) {
+    for (uint32_t y = 0; y < lines; y++) {
+        for (uint32_t x = 0; x < line; x++) {
+            uint8_t v = (uint8_t)(x * 2 + y * 3 + (x & 1) * 60 + rand() % 5);
+            if ((x / 16 + y / 8) % 3 == 0) {
+                v = (uint8_t)rand(); // noise
+            } else if (y > lines / 2 && x < line / 3) {
+                v = 0x80; // flat
+            }
+            buf[y * line + x] = v;
+        }
+    }
+}
+
+static void test_chunks(void) {
+    static uint8_t synth[SYNTH_LINE * SYNTH_LINES];
+    static uint8_t coded_buf[sizeof(synth) * 3 + 64], decoded_buf[sizeof(synth)];
+    buffer_t coded = {.data = coded_buf, .size = sizeof(coded_buf)};
+    buffer_t decoded = {.data = decoded_buf, .size = sizeof(decoded_buf)};
+    const loco_layout_t layouts[] = {LOCO_BAYER8, LOCO_YUV422};
+    uint32_t len = sizeof(synth);
+    int bad = 0;
+
+    build_synth(synth, SYNTH_LINE, SYNTH_LINES);
+    for (int l = 0; l < 2; l++) {
+        for (uint32_t chunk = 1; chunk <= len && !bad; chunk += (chunk < 40) ? 1 : 257) {
+            int ret = encode(synth, len, layouts[l], SYNTH_LINE, chunk, &coded);
+            CHECK(ret == 0, "layout %d, %u byte chunks: coding failed, %d", l, chunk, ret);
+            ret = decode(coded.data, coded.len, chunk, &decoded);
+            bad = ret != 0 || decoded.len != len || memcmp(decoded.data, synth, len) != 0;
+            CHECK(!bad, "layout %d, %u byte chunks: %u bytes back of %u, ret %d", l, chunk, decoded.len, len, ret);
+        }
+    }
+
+    // every byte error, each as the first and the last code of a stream
+    for (int v = 0; v < 256; v++) {
+        uint8_t two[8] = {0, 0, 0, 0, 0, 0, 0, (uint8_t)v};
+        encode(two, sizeof(two), LOCO_BAYER8, 4, 3, &coded);
+        CHECK(decode(coded.data, coded.len, 1, &decoded) == 0 && decoded.len == sizeof(two) &&
+                  memcmp(decoded.data, two, sizeof(two)) == 0,
+              "byte %02x did not round trip", v);
+    }
+
+    CHECK(loco_encoder_init(&coder, LOCO_BAYER8, LOCO_HISTORY, buffer_sink, &coded) < 0, "too long a line");
+    CHECK(decode((const uint8_t *)"LX", 2, 2, &decoded) < 0, "bad magic");
+    encode(synth, len, LOCO_YUV422, SYNTH_LINE, 64, &coded);
+    CHECK(decode(coded.data, 3, 64, &decoded) < 0, "stream cut off in its header");
+    CHECK(decode(coded.data, coded.len - 3, 64, &decoded) < 0 || decoded.len < len, "cut off stream");
+    printf("synthetic %u bytes: every chunking of both layouts round trips\n", len);
+}
+
+static int decode_file(const char *in_name, const char *out_name) {
+    uint32_t len;
+    uint8_t *in = read_file(in_name, &len);
+    if (!in) {
+        fprintf(stderr, "can't read %s\n", in_name);
+        return 1;
+    }
+    // a LOCO stream is at least 1 bit a byte
+    buffer_t out = {.data = malloc(len * 8), .size = len * 8};
+    int ret = decode(in, len, NAND_PAGE, &out);
+    if (ret < 0) {
+        fprintf(stderr, "%s: not a LOCO stream, or cut off (%d)\n", in_name, ret);
+        return 1;
+    }
+    FILE *f = fopen(out_name, "wb");
+    if (!f || fwrite(out.data, 1, out.len, f) != out.len) {
+        fprintf(stderr, "can't write %s\n", out_name);
+        return 1;
+    }
+    fclose(f);
+    printf("%s: %u bytes decoded to %u, %u byte lines\n", in_name, len, out.len, coder.line);
+    return 0;
+}
+
+void usage(const char *pgm) {
+    const char *name = (pgm) ? pgm : "usage";
+
+    fprintf(stderr, "%s [-i raw -l bayer|yuv -w line_bytes] [-s seed]\n", name);
+    fprintf(stderr, "%s -d loco -o raw\n", name);
+    exit(1);
+}
+
+int main(int argc, char **argv) {
+    char in_name[MAX_NAME_LEN * 4] = "";
+    char coded_name[MAX_NAME_LEN * 4] = "";
+    char out_name[MAX_NAME_LEN * 4] = "";
+    loco_layout_t layout = LOCO_BAYER8;
+    int line = 1280;
+    int i = 1;
+
+    while (i < argc) {
+        if (argv[i][0] != '-' || argv[i][2] != 0 || i + 1 >= argc) {
+            usage(argv[0]);
+        }
+        switch (argv[i][1]) {
+        case 'i':
+            strncpy(in_name, argv[i + 1], sizeof(in_name) - 1);
+            break;
+        case 'd':
+            strncpy(coded_name, argv[i + 1], sizeof(coded_name) - 1);
+            break;
+        case 'o':
+            strncpy(out_name, argv[i + 1], sizeof(out_name) - 1);
+            break;
+        case 'l':
+            layout = (strcmp(argv[i + 1], "yuv") == 0) ? LOCO_YUV422 : LOCO_BAYER8;
+            break;
+        case 'w':
+            line = atoi(argv[i + 1]);
+            break;
+        case 's':
+            srand((unsigned)atoi(argv[i + 1]));
+            break;
+        default:
+            usage(argv[0]);
+        }
+        i += 2;
+    }
+
+    if (coded_name[0]) {
+        if (!out_name[0]) {
+            usage(argv[0]);
+        }
+        return decode_file(coded_name, out_name);
+    }
+
+    test_chunks();
+    if (in_name[0]) {
+        bench_image(in_name, layout, (uint16_t)line);
+    }
+
+    printf("%s\n", failures ? "FAIL" : "PASS");
+    return failures ? 1 : 0;
+}
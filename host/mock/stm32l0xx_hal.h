@@ -0,0 +1,93 @@
+/*
+ * stm32l0xx_hal.h
+ *
+ * Minimal stand-in for the STM32 HAL so driver sources can be compiled into
+ * the host tools. Only the types and calls the NAND, bit-bang SPI and SCCB
+ * drivers use are here, the host tool that links a driver provides the
+ * functions.
+ */
+#ifndef HOST_MOCK_STM32L0XX_HAL_H_
+#define HOST_MOCK_STM32L0XX_HAL_H_
+
+#include <stdint.h>
+#include <stddef.h>
+
+typedef enum { HAL_OK = 0, HAL_ERROR = 1, HAL_BUSY = 2, HAL_TIMEOUT = 3 } HAL_StatusTypeDef;
+
+typedef struct {
+    int channel;
+} DMA_HandleTypeDef;
+
+typedef struct {
+    int id;
+    DMA_HandleTypeDef *hdmatx;
+    DMA_HandleTypeDef *hdmarx;
+} SPI_HandleTypeDef;
+
+typedef struct {
+    int id;
+} I2C_HandleTypeDef;
+
+#define I2C_MEMADD_SIZE_8BIT 0x00000001U
+#define I2C_MEMADD_SIZE_16BIT 0x00000002U
+
+typedef struct {
+    volatile uint32_t IDR;
+    volatile uint32_t BSRR;
+    volatile uint32_t BRR;
+} GPIO_TypeDef;
+
+typedef enum { GPIO_PIN_RESET = 0, GPIO_PIN_SET } GPIO_PinState;
+
+extern GPIO_TypeDef mock_gpioa;
+extern GPIO_TypeDef mock_gpiob;
+#define GPIOA (&mock_gpioa)
+#define GPIOB (&mock_gpiob)
+
+#define GPIO_PIN_0 ((uint16_t)0x0001)
+#define GPIO_PIN_1 ((uint16_t)0x0002)
+#define GPIO_PIN_2 ((uint16_t)0x0004)
+#define GPIO_PIN_3 ((uint16_t)0x0008)
+#define GPIO_PIN_4 ((uint16_t)0x0010)
+#define GPIO_PIN_6 ((uint16_t)0x0040)
+#define GPIO_PIN_7 ((uint16_t)0x0080)
+#define GPIO_PIN_12 ((uint16_t)0x1000)
+
+typedef struct {
+    int id;
+} TIM_HandleTypeDef;
+
+#define __HAL_TIM_SET_COUNTER(htim, cnt) mock_tim_set_counter((htim), (cnt))
+#define __HAL_TIM_GET_COUNTER(htim) mock_tim_get_counter(htim)
+void mock_tim_set_counter(TIM_HandleTypeDef *htim, uint32_t cnt);
+uint32_t mock_tim_get_counter(TIM_HandleTypeDef *htim);
+
+extern uint32_t SystemCoreClock;
+
+#define __NOP() mock_nop()
+void mock_nop(void);
+
+uint32_t HAL_GetTick(void);
+void HAL_Delay(uint32_t Delay);
+void HAL_GPIO_WritePin(GPIO_TypeDef *GPIOx, uint16_t GPIO_Pin, GPIO_PinState PinState);
+
+HAL_StatusTypeDef HAL_SPI_Transmit(SPI_HandleTypeDef *hspi, uint8_t *pData, uint16_t Size, uint32_t Timeout);
+HAL_StatusTypeDef HAL_SPI_Receive(SPI_HandleTypeDef *hspi, uint8_t *pData, uint16_t Size, uint32_t Timeout);
+HAL_StatusTypeDef HAL_SPI_Transmit_DMA(SPI_HandleTypeDef *hspi, uint8_t *pData, uint16_t Size);
+HAL_StatusTypeDef HAL_SPI_Receive_DMA(SPI_HandleTypeDef *hspi, uint8_t *pData, uint16_t Size);
+HAL_StatusTypeDef HAL_SPI_TransmitReceive_DMA(SPI_HandleTypeDef *hspi, uint8_t *pTxData, uint8_t *pRxData,
+                                              uint16_t Size);
+HAL_StatusTypeDef HAL_SPI_Abort(SPI_HandleTypeDef *hspi);
+
+HAL_StatusTypeDef HAL_I2C_Mem_Write(I2C_HandleTypeDef *hi2c, uint16_t DevAddress, uint16_t MemAddress,
+                                    uint16_t MemAddSize, uint8_t *pData, uint16_t Size, uint32_t Timeout);
+HAL_StatusTypeDef HAL_I2C_Mem_Read(I2C_HandleTypeDef *hi2c, uint16_t DevAddress, uint16_t MemAddress,
+                                   uint16_t MemAddSize, uint8_t *pData, uint16_t Size, uint32_t Timeout);
+
+/* Completion callbacks, called by the mock when a DMA transfer ends */
+void HAL_SPI_TxCpltCallback(SPI_HandleTypeDef *hspi);
+void HAL_SPI_RxCpltCallback(SPI_HandleTypeDef *hspi);
+void HAL_SPI_TxRxCpltCallback(SPI_HandleTypeDef *hspi);
+void HAL_SPI_ErrorCallback(SPI_HandleTypeDef *hspi);
+
+#endif /* HOST_MOCK_STM32L0XX_HAL_H_ */
@@ -0,0 +1,674 @@
+/*
+ * nand_dma_test.c
+ *
+ * Runs nand_spi.c and the NAND low level driver against a mock of the HAL
+ * SPI/DMA calls and a simulated MT29F2G01ABAGD, to check the asynchronous
+ * page operations:
+ *  - nCS stays low for the whole DMA transfer and is high again when the
+ *    completion callback runs
+ *  - no command reaches the device while it is busy
+ *  - the data lands where it should, in both directions
+ *  - the CPU is free while page data moves and while the page programs, and
+ *    a new NAND call first finishes the operation in flight
+ *  - PROGRAM EXECUTE is not sent from the DMA interrupt
+ *  - a failed program finished by another NAND call is still reported
+ *
+ * Time is simulated. DMA transfers complete when the simulated clock passes
+ * their end, from HAL_GetTick, HAL_Delay or the test's own CPU work, which is
+ * when the mock raises the completion interrupt.
+ *
+ * Build from the repository root:
+ *   gcc -O2 -Wall -Wextra -Ihost/mock -ICore/Inc/drivers/nand_flash -o host/nand_dma_test host/nand_dma_test.c \
+ *       Core/Src/drivers/nand_flash/nand_spi.c Core/Src/drivers/nand_flash/nand_m79a_lld.c
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "nand_m79a_lld.h"
+
+#define MAX_NAME_LEN 64
+
+#define SIM_BLOCKS 8
+#define SIM_PAGE_SIZE (PAGE_DATA_SIZE + PAGE_SPARE_SIZE)
+#define TEST_BLOCK 3
+
+/* Simulation parameters, all times in us */
+static double spi_mhz = 8.0; /* hspi2: 32 MHz SYSCLK / 4 */
+static double call_us = 2.0; /* per HAL call */
+static double t_rd = 70.0;
+static double t_prog = 300.0;
+static double t_ers = 3000.0;
+static int pages = 16;
+static double cam_us = 20.0; /* per camera byte bit-banged off the FIFO */
+
+static double now;
+static int failures;
+
+#define CHECK(cond, ...)                                                                                           \
+    do {                                                                                                           \
+        if (!(cond)) {                                                                                             \
+            fprintf(stderr, "FAIL %s:%d: ", __FILE__, __LINE__);                                                   \
+            fprintf(stderr, __VA_ARGS__);                                                                          \
+            fprintf(stderr, "\n");                                                                                 \
+            failures++;                                                                                            \
+        }                                                                                                          \
+    } while (0)
+
+/******************************************************************************
+ *                              Simulated NAND
+ *****************************************************************************/
+
+static struct {
+    uint8_t array[SIM_BLOCKS * NUM_PAGES_PER_BLOCK][SIM_PAGE_SIZE];
+    uint8_t cache[SIM_PAGE_SIZE];
+    double oip_until;
+    int wel;
+    int pf;           /* P_FAIL of the last program */
+    int fail_program; /* make the next programs fail */
+    int cs_low;
+    uint8_t cmd[4]; /* command and address bytes of the open transaction */
+    int cmd_len;
+    int data_pos; /* data bytes moved in the open transaction */
+    int busy_violations;
+} dev;
+
+static int header_len(uint8_t cmd) {
+    switch (cmd) {
+    case SPI_NAND_GET_FEATURES:
+    case SPI_NAND_READ_ID:
+        return 2;
+    case SPI_NAND_SET_FEATURES: /* the value is the third byte */
+    case SPI_NAND_PROGRAM_LOAD_X1:
+    case SPI_NAND_PROGRAM_LOAD_RANDOM_X1:
+        return 3;
+    case SPI_NAND_READ_CACHE_X1:
+    case SPI_NAND_PAGE_READ:
+    case SPI_NAND_PROGRAM_EXEC:
+    case SPI_NAND_BLOCK_ERASE:
+        return 4;
+    default:
+        return 1;
+    }
+}
+
+static uint32_t dev_row(void) { return ((uint32_t)dev.cmd[1] << 16) | ((uint32_t)dev.cmd[2] << 8) | dev.cmd[3]; }
+
+static uint32_t dev_col(void) { return (((uint32_t)dev.cmd[1] << 8) | dev.cmd[2]) & 0xfff; }
+
+static uint8_t *dev_page(uint32_t row) {
+    if (row >= SIM_BLOCKS * NUM_PAGES_PER_BLOCK) {
+        fprintf(stderr, "row %u is outside the simulated blocks\n", row);
+        exit(2);
+    }
+    return dev.array[row];
+}
+
+static void dev_tx(const uint8_t *buf, uint16_t len) {
+    for (uint16_t i = 0; i < len; i++) {
+        if (dev.cmd_len == 0 || dev.cmd_len < header_len(dev.cmd[0])) {
+            dev.cmd[dev.cmd_len++] = buf[i];
+            if (dev.cmd_len == 1 && now < dev.oip_until && dev.cmd[0] != SPI_NAND_GET_FEATURES) {
+                dev.busy_violations++;
+            }
+            continue;
+        }
+        uint32_t col = dev_col();
+        if (dev.cmd[0] == SPI_NAND_PROGRAM_LOAD_X1 && dev.data_pos == 0) {
+            memset(dev.cache, 0xff, sizeof(dev.cache));
+        }
+        if (dev.cmd[0] == SPI_NAND_PROGRAM_LOAD_X1 || dev.cmd[0] == SPI_NAND_PROGRAM_LOAD_RANDOM_X1) {
+            if (col + dev.data_pos < SIM_PAGE_SIZE) {
+                dev.cache[col + dev.data_pos] = buf[i];
+            }
+        }
+        dev.data_pos++;
+    }
+}
+
+static void dev_rx(uint8_t *buf, uint16_t len) {
+    for (uint16_t i = 0; i < len; i++) {
+        uint8_t b = 0xff;
+        switch (dev.cmd[0]) {
+        case SPI_NAND_GET_FEATURES:
+            b = (now < dev.oip_until ? NAND_OIP : 0) | (dev.wel ? NAND_WEL : 0) | (dev.pf ? NAND_PF : 0);
+            break;
+        case SPI_NAND_READ_ID:
+            b = dev.data_pos == 0 ? NAND_ID_MANUFACTURER : NAND_ID_DEVICE;
+            break;
+        case SPI_NAND_READ_CACHE_X1: {
+            uint32_t col = dev_col();
+            if (col + dev.data_pos < SIM_PAGE_SIZE) {
+                b = dev.cache[col + dev.data_pos];
+            }
+            break;
+        }
+        default:
+            break;
+        }
+        buf[i] = b;
+        dev.data_pos++;
+    }
+}
+
+/* Commands take effect when nCS goes high */
+static void dev_end_transaction(void) {
+    if (dev.cmd_len == 0) {
+        return;
+    }
+    switch (dev.cmd[0]) {
+    case SPI_NAND_RESET:
+        dev.wel = 0;
+        dev.pf = 0;
+        dev.oip_until = now + 10;
+        break;
+    case SPI_NAND_WRITE_ENABLE:
+        dev.wel = 1;
+        break;
+    case SPI_NAND_WRITE_DISABLE:
+        dev.wel = 0;
+        break;
+    case SPI_NAND_PAGE_READ:
+        memcpy(dev.cache, dev_page(dev_row()), SIM_PAGE_SIZE);
+        dev.oip_until = now + t_rd;
+        break;
+    case SPI_NAND_PROGRAM_EXEC:
+        dev.pf = dev.fail_program;
+        if (dev.wel && !dev.fail_program) {
+            uint8_t *page = dev_page(dev_row());
+            for (int i = 0; i < SIM_PAGE_SIZE; i++) {
+                page[i] &= dev.cache[i];
+            }
+            dev.oip_until = now + t_prog;
+        }
+        dev.wel = 0;
+        break;
+    case SPI_NAND_BLOCK_ERASE:
+        if (dev.wel) {
+            uint32_t row = dev_row() & ~0x3fu;
+            for (int i = 0; i < NUM_PAGES_PER_BLOCK; i++) {
+                memset(dev_page(row + i), 0xff, SIM_PAGE_SIZE);
+            }
+            dev.oip_until = now + t_ers;
+        }
+        dev.wel = 0;
+        break;
+    default:
+        break;
+    }
+}
+
+/******************************************************************************
+ *                              HAL SPI/DMA mock
+ *****************************************************************************/
+
+GPIO_TypeDef mock_gpiob;
+
+static SPI_HandleTypeDef hspi;
+static DMA_HandleTypeDef hdma_rx = {.channel = 4};
+static DMA_HandleTypeDef hdma_tx = {.channel = 5};
+
+/* How a transfer ends, as in the HAL */
+typedef enum {
+    DMA_TX,   /* HAL_SPI_Transmit_DMA, HAL_SPI_TxCpltCallback */
+    DMA_RX,   /* HAL_SPI_Receive_DMA, HAL_SPI_RxCpltCallback even in 2-line master mode */
+    DMA_TX_RX /* HAL_SPI_TransmitReceive_DMA, HAL_SPI_TxRxCpltCallback */
+} dma_kind_t;
+
+static struct {
+    int pending;
+    dma_kind_t kind;
+    uint8_t *buf;
+    uint16_t len;
+    double done_at;
+} dma;
+
+static int cs_low_in_callback;
+static int obc_callbacks; /* completions that went to the OBC's HAL_SPI_RxCpltCallback */
+
+static double byte_us(void) { return 8.0 / spi_mhz; }
+
+/* Raises the DMA completion interrupt once the transfer is due */
+static void mock_irq(void) {
+    if (!dma.pending || now < dma.done_at) {
+        return;
+    }
+    CHECK(dev.cs_low, "DMA transfer ran with nCS high");
+    if (dma.kind == DMA_TX) {
+        dev_tx(dma.buf, dma.len);
+    } else {
+        dev_rx(dma.buf, dma.len); /* the device ignores MOSI while it shifts data out */
+    }
+    dma.pending = 0;
+    switch (dma.kind) {
+    case DMA_TX:
+        HAL_SPI_TxCpltCallback(&hspi);
+        break;
+    case DMA_RX:
+        HAL_SPI_RxCpltCallback(&hspi);
+        break;
+    case DMA_TX_RX:
+        HAL_SPI_TxRxCpltCallback(&hspi);
+        break;
+    }
+}
+
+/* Stands in for main.c's, which flags a command from the OBC on hspi1 */
+void HAL_SPI_RxCpltCallback(SPI_HandleTypeDef *h) {
+    if (h == &hspi) {
+        obc_callbacks++;
+    }
+}
+
+static void advance(double us) {
+    now += us;
+    mock_irq();
+}
+
+uint32_t HAL_GetTick(void) {
+    advance(1.0); // every poll costs some time
+    return (uint32_t)(now / 1000.0);
+}
+
+void HAL_Delay(uint32_t Delay) { advance(Delay * 1000.0); }
+
+void HAL_GPIO_WritePin(GPIO_TypeDef *GPIOx, uint16_t GPIO_Pin, GPIO_PinState PinState) {
+    if (GPIOx != GPIOB || GPIO_Pin != NAND_NCS_PIN) {
+        return;
+    }
+    if (PinState == GPIO_PIN_RESET) {
+        dev.cs_low = 1;
+        dev.cmd_len = 0;
+        dev.data_pos = 0;
+    } else if (dev.cs_low) {
+        CHECK(!dma.pending, "nCS released during a DMA transfer");
+        dev.cs_low = 0;
+        dev_end_transaction();
+    }
+}
+
+HAL_StatusTypeDef HAL_SPI_Transmit(SPI_HandleTypeDef *h, uint8_t *pData, uint16_t Size, uint32_t Timeout) {
+    (void)h;
+    (void)Timeout;
+    if (dma.pending) {
+        return HAL_BUSY;
+    }
+    CHECK(dev.cs_low, "transmit with nCS high");
+    dev_tx(pData, Size);
+    advance(call_us + Size * byte_us());
+    return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_SPI_Receive(SPI_HandleTypeDef *h, uint8_t *pData, uint16_t Size, uint32_t Timeout) {
+    (void)h;
+    (void)Timeout;
+    if (dma.pending) {
+        return HAL_BUSY;
+    }
+    CHECK(dev.cs_low, "receive with nCS high");
+    dev_rx(pData, Size);
+    advance(call_us + Size * byte_us());
+    return HAL_OK;
+}
+
+static HAL_StatusTypeDef start_dma(SPI_HandleTypeDef *h, uint8_t *pData, uint16_t Size, dma_kind_t kind) {
+    if (dma.pending) {
+        return HAL_BUSY;
+    }
+    if (!h->hdmarx || !h->hdmatx) {
+        return HAL_ERROR;
+    }
+    dma.pending = 1;
+    dma.kind = kind;
+    dma.buf = pData;
+    dma.len = Size;
+    dma.done_at = now + call_us + Size * byte_us();
+    return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_SPI_Transmit_DMA(SPI_HandleTypeDef *h, uint8_t *pData, uint16_t Size) {
+    return start_dma(h, pData, Size, DMA_TX);
+}
+
+HAL_StatusTypeDef HAL_SPI_Receive_DMA(SPI_HandleTypeDef *h, uint8_t *pData, uint16_t Size) {
+    return start_dma(h, pData, Size, DMA_RX);
+}
+
+HAL_StatusTypeDef HAL_SPI_TransmitReceive_DMA(SPI_HandleTypeDef *h, uint8_t *pTxData, uint8_t *pRxData,
+                                              uint16_t Size) {
+    CHECK(pTxData != NULL, "TransmitReceive without a TX buffer");
+    return start_dma(h, pRxData, Size, DMA_TX_RX);
+}
+
+HAL_StatusTypeDef HAL_SPI_Abort(SPI_HandleTypeDef *h) {
+    (void)h;
+    dma.pending = 0;
+    return HAL_OK;
+}
+
+/******************************************************************************
+ *                                  Tests
+ *****************************************************************************/
+
+static uint8_t pattern(int page, int i) { return (uint8_t)(page * 37 + i * 11 + (i >> 8)); }
+
+static void fill(uint8_t *buf, int page) {
+    for (int i = 0; i < PAGE_DATA_SIZE; i++) {
+        buf[i] = pattern(page, i);
+    }
+}
+
+static int check(const uint8_t *buf, int page, const char *what) {
+    for (int i = 0; i < PAGE_DATA_SIZE; i++) {
+        if (buf[i] != pattern(page, i)) {
+            CHECK(0, "%s: page %d byte %d is %02x, expected %02x", what, page, i, buf[i], pattern(page, i));
+            return -1;
+        }
+    }
+    return 0;
+}
+
+static int callbacks;
+
+static void done_cb(NAND_SPI_ReturnType status, void *arg) {
+    CHECK(status == SPI_OK, "callback status %d", status);
+    if (dev.cs_low) {
+        cs_low_in_callback++;
+    }
+    callbacks++;
+    (*(int *)arg)++;
+}
+
+/* Does CPU work in 10 us slices until the DMA transfer ends, returns the us spent */
+static double cpu_work_while_busy(void) {
+    double spent = 0;
+    while (NAND_Async_Busy()) {
+        if (spent > 1e6) {
+            CHECK(0, "DMA transfer never completed");
+            break;
+        }
+        advance(10.0);
+        spent += 10.0;
+    }
+    return spent;
+}
+
+/* Same, then starts the program and works until the device is done with it as well */
+static double cpu_work_while_programming(void) {
+    double spent = cpu_work_while_busy();
+    CHECK(now >= dev.oip_until, "program started from the DMA interrupt");
+    CHECK(NAND_Async_Execute(), "program not started after the load");
+    CHECK(now < dev.oip_until, "program not running in the background after the load");
+    while (now < dev.oip_until) {
+        advance(10.0);
+        spent += 10.0;
+    }
+    return spent;
+}
+
+static void test_async_program(double *bus_us, double *free_us) {
+    static uint8_t buf[2][PAGE_DATA_SIZE];
+    PhysicalAddrs addr = {.block = TEST_BLOCK};
+
+    CHECK(NAND_Block_Erase(&addr) == Ret_Success, "erase block %d", TEST_BLOCK);
+
+    *bus_us = 0;
+    *free_us = 0;
+    fill(buf[0], 0);
+    for (int i = 0; i < pages; i++) {
+        int loaded = 0;
+        addr.page = i;
+
+        double start = now;
+        CHECK(NAND_Page_Program_Async(&addr, PAGE_DATA_SIZE, buf[i & 1], done_cb, &loaded) == Ret_Success,
+              "start program of page %d", i);
+
+        // Prepare the next page while this one goes out
+        if (i + 1 < pages) {
+            fill(buf[(i + 1) & 1], i + 1);
+        }
+        *free_us += cpu_work_while_programming();
+        CHECK(loaded == 1, "page %d load callback ran %d times", i, loaded);
+        CHECK(NAND_Async_Complete() == Ret_Success, "program page %d", i);
+        *bus_us += now - start;
+    }
+
+    for (int i = 0; i < pages; i++) {
+        check(dev.array[TEST_BLOCK * NUM_PAGES_PER_BLOCK + i], i, "flash array after async program");
+    }
+}
+
+static void test_async_read(void) {
+    static uint8_t buf[PAGE_DATA_SIZE];
+    PhysicalAddrs addr = {.block = TEST_BLOCK};
+
+    for (int i = 0; i < pages; i++) {
+        int filled = 0;
+        addr.page = i;
+        memset(buf, 0, sizeof(buf));
+        CHECK(NAND_Page_Read_Async(&addr, PAGE_DATA_SIZE, buf, done_cb, &filled) == Ret_Success,
+              "start read of page %d", i);
+        cpu_work_while_busy();
+        CHECK(filled == 1, "page %d read callback ran %d times", i, filled);
+        CHECK(NAND_Async_Complete() == Ret_Success, "read page %d", i);
+        check(buf, i, "async read");
+    }
+}
+
+static void test_async_program_spare(void) {
+    static uint8_t buf[PAGE_DATA_SIZE];
+    uint8_t spare[12];
+    PhysicalAddrs addr = {.block = TEST_BLOCK, .page = pages + 1};
+
+    fill(buf, addr.page);
+    for (int i = 0; i < (int)sizeof(spare); i++) {
+        spare[i] = 0xa0 + i;
+    }
+    CHECK(NAND_Page_Program_Spare_Async(&addr, PAGE_DATA_SIZE, buf, 4, sizeof(spare), spare, NULL, NULL) ==
+              Ret_Success,
+          "start program with spare");
+    memset(spare, 0, sizeof(spare)); // the driver must not need it any more
+    cpu_work_while_programming();
+    CHECK(NAND_Async_Complete() == Ret_Success, "program with spare");
+
+    uint8_t *page = dev.array[TEST_BLOCK * NUM_PAGES_PER_BLOCK + addr.page];
+    check(page, addr.page, "data programmed with spare");
+    CHECK(page[PAGE_DATA_SIZE] == 0xff, "bad block marker left alone");
+    for (int i = 0; i < 12; i++) {
+        CHECK(page[PAGE_DATA_SIZE + 4 + i] == 0xa0 + i, "spare byte %d is %02x", i, page[PAGE_DATA_SIZE + 4 + i]);
+    }
+}
+
+/* A blocking call while an operation is in flight finishes that one first */
+static void test_implicit_complete(void) {
+    static uint8_t a[PAGE_DATA_SIZE], b[PAGE_DATA_SIZE];
+    PhysicalAddrs pa = {.block = TEST_BLOCK, .page = 1};
+    PhysicalAddrs pb = {.block = TEST_BLOCK, .page = 2};
+    int filled = 0;
+
+    CHECK(NAND_Page_Read_Async(&pa, PAGE_DATA_SIZE, a, done_cb, &filled) == Ret_Success, "start read");
+    CHECK(NAND_Page_Read(&pb, PAGE_DATA_SIZE, b) == Ret_Success, "blocking read behind async read");
+    CHECK(filled == 1, "async read finished before the blocking one");
+    check(a, 1, "async read before blocking read");
+    check(b, 2, "blocking read after async read");
+    CHECK(!NAND_Async_Busy(), "nothing in flight");
+
+    // A program started asynchronously is executed before the next command
+    static uint8_t w[PAGE_DATA_SIZE];
+    PhysicalAddrs pw = {.block = TEST_BLOCK, .page = pages};
+    fill(w, pages);
+    CHECK(NAND_Page_Program_Async(&pw, PAGE_DATA_SIZE, w, NULL, NULL) == Ret_Success, "start program");
+    CHECK(NAND_Page_Read(&pw, PAGE_DATA_SIZE, b) == Ret_Success, "read back behind async program");
+    check(b, pages, "read back behind async program");
+}
+
+/* A program that fails while another NAND call finishes it is reported by the next wait */
+static void test_sticky_failure(void) {
+    static uint8_t w[PAGE_DATA_SIZE], r[PAGE_DATA_SIZE];
+    PhysicalAddrs pw = {.block = TEST_BLOCK, .page = pages + 2};
+    PhysicalAddrs pr = {.block = TEST_BLOCK, .page = 1};
+
+    fill(w, pw.page);
+    dev.fail_program = 1;
+    CHECK(NAND_Page_Program_Async(&pw, PAGE_DATA_SIZE, w, NULL, NULL) == Ret_Success, "start failing program");
+    cpu_work_while_busy();
+    CHECK(NAND_Page_Read(&pr, PAGE_DATA_SIZE, r) == Ret_Success, "read behind failing program");
+    dev.fail_program = 0;
+    check(r, 1, "read behind failing program");
+    CHECK(NAND_Async_Complete() == Ret_WriteFailed, "failed program not reported");
+    CHECK(NAND_Async_Complete() == Ret_Success, "failure reported twice");
+}
+
+/* Without linked DMA channels the asynchronous calls finish before returning */
+static void test_no_dma(void) {
+    static uint8_t buf[PAGE_DATA_SIZE];
+    PhysicalAddrs addr = {.block = TEST_BLOCK, .page = 3};
+    int filled = 0;
+
+    hspi.hdmarx = NULL;
+    hspi.hdmatx = NULL;
+    CHECK(NAND_Page_Read_Async(&addr, PAGE_DATA_SIZE, buf, done_cb, &filled) == Ret_Success, "start read");
+    CHECK(!NAND_Async_Busy(), "read without DMA finished");
+    CHECK(filled == 1, "callback without DMA");
+    CHECK(NAND_Async_Complete() == Ret_Success, "complete without DMA");
+    check(buf, 3, "read without DMA");
+    hspi.hdmarx = &hdma_rx;
+    hspi.hdmatx = &hdma_tx;
+}
+
+/*
+ * Capture of pages camera bytes: serially with a blocking program per page,
+ * then with the page being programmed while the next one is read off the
+ * camera, the way NANDfs_write runs, with two page buffers and with one that
+ * is reused once its data is loaded. Returns the times through serial,
+ * pipelined and single.
+ */
+static void test_capture_pipeline(double *serial, double *pipelined, double *single) {
+    static uint8_t buf[2][PAGE_DATA_SIZE];
+    PhysicalAddrs addr = {.block = TEST_BLOCK + 1};
+    uint8_t meta[12] = {0};
+
+    CHECK(NAND_Block_Erase(&addr) == Ret_Success, "erase block %d", addr.block);
+    double start = now;
+    for (int i = 0; i < pages; i++) {
+        addr.page = i;
+        fill(buf[0], i);
+        advance(PAGE_DATA_SIZE * cam_us);
+        CHECK(NAND_Page_Program_Spare(&addr, PAGE_DATA_SIZE, buf[0], 4, sizeof(meta), meta) == Ret_Success,
+              "serial program of page %d", i);
+    }
+    *serial = now - start;
+
+    addr.block = TEST_BLOCK + 2;
+    CHECK(NAND_Block_Erase(&addr) == Ret_Success, "erase block %d", addr.block);
+    start = now;
+    for (int i = 0; i < pages; i++) {
+        addr.page = i;
+        fill(buf[i & 1], i);
+        for (int c = 0; c < PAGE_DATA_SIZE; c += 256) {
+            advance(256 * cam_us);
+            NAND_Async_Execute(); // as NANDfs_write does for each chunk
+        }
+        CHECK(NAND_Async_Complete() == Ret_Success, "pipelined program before page %d", i);
+        CHECK(NAND_Page_Program_Spare_Async(&addr, PAGE_DATA_SIZE, buf[i & 1], 4, sizeof(meta), meta, NULL, NULL) ==
+                  Ret_Success,
+              "start pipelined program of page %d", i);
+    }
+    CHECK(NAND_Async_Complete() == Ret_Success, "last pipelined program");
+    *pipelined = now - start;
+
+    for (int i = 0; i < pages; i++) {
+        check(dev.array[(TEST_BLOCK + 2) * NUM_PAGES_PER_BLOCK + i], i, "pipelined capture");
+    }
+
+    addr.block = TEST_BLOCK + 3;
+    CHECK(NAND_Block_Erase(&addr) == Ret_Success, "erase block %d", addr.block);
+    start = now;
+    for (int i = 0; i < pages; i++) {
+        addr.page = i;
+        fill(buf[0], i);
+        for (int c = 0; c < PAGE_DATA_SIZE; c += 256) {
+            advance(256 * cam_us);
+            NAND_Async_Execute();
+        }
+        CHECK(NAND_Async_Complete() == Ret_Success, "single buffer program before page %d", i);
+        CHECK(NAND_Page_Program_Spare_Async(&addr, PAGE_DATA_SIZE, buf[0], 4, sizeof(meta), meta, NULL, NULL) ==
+                  Ret_Success,
+              "start single buffer program of page %d", i);
+        while (!NAND_Async_Execute()) { // as _write_page does before the buffer is filled again
+            advance(call_us);
+        }
+    }
+    CHECK(NAND_Async_Complete() == Ret_Success, "last single buffer program");
+    *single = now - start;
+
+    for (int i = 0; i < pages; i++) {
+        check(dev.array[(TEST_BLOCK + 3) * NUM_PAGES_PER_BLOCK + i], i, "single buffer capture");
+    }
+}
+
+void usage(const char *pgm) {
+    const char *name = (pgm) ? pgm : "usage";
+
+    fprintf(stderr, "%s [-n pages] [-s spi_mhz] [-c camera_us_per_byte]\n", name);
+    exit(1);
+}
+
+int main(int argc, char **argv) {
+    int i = 1;
+
+    while (i < argc) {
+        if (argv[i][0] != '-' || argv[i][2] != 0 || i + 1 >= argc) {
+            usage(argv[0]);
+        }
+        double val = atof(argv[i + 1]);
+        switch (argv[i][1]) {
+        case 'n':
+            pages = (int)val;
+            break;
+        case 's':
+            spi_mhz = val;
+            break;
+        case 'c':
+            cam_us = val;
+            break;
+        default:
+            usage(argv[0]);
+        }
+        i += 2;
+    }
+    if (pages <= 0 || pages + 1 >= NUM_PAGES_PER_BLOCK || spi_mhz <= 0) {
+        usage(argv[0]);
+    }
+
+    memset(dev.array, 0xff, sizeof(dev.array));
+    hspi.hdmarx = &hdma_rx;
+    hspi.hdmatx = &hdma_tx;
+    NAND_SPI_Init(&hspi);
+    CHECK(NAND_Init() == Ret_Success, "NAND_Init");
+
+    double bus_us, free_us;
+    test_async_program(&bus_us, &free_us);
+    test_async_read();
+    test_async_program_spare();
+    test_implicit_complete();
+    test_sticky_failure();
+    test_no_dma();
+
+    double serial, pipelined, single;
+    test_capture_pipeline(&serial, &pipelined, &single);
+
+    CHECK(dev.busy_violations == 0, "%d commands sent while the device was busy", dev.busy_violations);
+    CHECK(cs_low_in_callback == 0, "nCS still low in %d callbacks", cs_low_in_callback);
+    CHECK(obc_callbacks == 0, "%d NAND transfers ended in the OBC's receive callback", obc_callbacks);
+
+    printf("%d pages programmed, SPI %.1f MHz: %.0f us/page, %.0f us/page free for the CPU\n", pages, spi_mhz,
+           bus_us / pages, free_us / pages);
+    printf("capture at %.0f us/camera byte: serial %.1f ms, pipelined %.1f ms, %.0f us/page saved, "
+           "one buffer %.1f ms, %.0f us/page saved\n",
+           cam_us, serial / 1000, pipelined / 1000, (serial - pipelined) / pages, single / 1000,
+           (serial - single) / pages);
+    printf("%d callbacks, %s\n", callbacks, failures ? "FAIL" : "PASS");
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,307 @@
+/*
+ * nand_read_bench.c
+ *
+ * Runs the NAND low level driver against a simulated MT29F2G01ABAGD and
+ * compares the time to read consecutive pages with NAND_Page_Read against the
+ * cache read sequence in NAND_Page_Read_Sequential, and reading the pages in
+ * CHUNK_SIZE pieces the way NANDfs_core_read serves the decoder. Every page
+ * read is checked against the data the simulated array holds for that row.
+ *
+ * Build from the repository root:
+ *   gcc -O2 -Ihost/mock -ICore/Inc/drivers/nand_flash -o host/nand_read_bench \
+ *       host/nand_read_bench.c Core/Src/drivers/nand_flash/nand_m79a_lld.c
+ *
+ * The default tRD allows for on-die ECC. Override the timings with the AC
+ * characteristics of the part in use.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "nand_m79a_lld.h"
+
+#define MAX_NAME_LEN 64
+
+/* Simulation parameters, all times in us */
+static double spi_mhz = 8.0;  /* hspi2: 32 MHz SYSCLK / 4 */
+static double cs_us = 2.0;    /* per transaction: CS toggling and HAL call overhead */
+static double t_rd = 70.0;    /* array to data register */
+static double t_rcbsy = 4.0;  /* data register to cache register */
+static int pages = 64 * 8;
+
+#define CHUNK_SIZE 64 /* CODEC_IN_SIZE in nandfs.c */
+static int page_loads; /* PAGE READ commands sent */
+
+/* Simulated device */
+static double now;
+static struct {
+    double oip_until;   /* OIP clears */
+    double array_until; /* pending array load finishes, CRBSY clears */
+    int pending;        /* an array load into the data register is running */
+    int load_to_cache;  /* PAGE READ: the pending load also fills the cache */
+    uint32_t pending_row;
+    uint32_t data_row;
+    uint32_t cache_row;
+} dev;
+
+static uint8_t page_byte(uint32_t row, uint32_t col) { return (uint8_t)(row * 31 + col * 7 + (col >> 8)); }
+
+static double max(double a, double b) { return a > b ? a : b; }
+
+static void dev_update(void) {
+    if (dev.pending && now >= dev.array_until) {
+        dev.data_row = dev.pending_row;
+        if (dev.load_to_cache) {
+            dev.cache_row = dev.pending_row;
+        }
+        dev.pending = 0;
+    }
+}
+
+/* Finishes the pending array load no matter the time; the host cannot see it
+ * before the OIP wait that follows. */
+static double dev_finish_load(void) {
+    double done = max(now, dev.array_until);
+    if (dev.pending) {
+        dev.data_row = dev.pending_row;
+        if (dev.load_to_cache) {
+            dev.cache_row = dev.pending_row;
+        }
+        dev.pending = 0;
+    }
+    return done;
+}
+
+static uint32_t row_of(const uint8_t *b) { return ((uint32_t)b[1] << 16) | ((uint32_t)b[2] << 8) | b[3]; }
+
+/* Handles one chip select assertion: tx bytes out, then rx bytes in */
+static void dev_transaction(const uint8_t *tx, uint16_t txlen, uint8_t *rx, uint16_t rxlen) {
+    dev_update();
+
+    switch (tx[0]) {
+    case SPI_NAND_GET_FEATURES:
+        if (rx && rxlen) {
+            uint8_t status = 0;
+            if (tx[1] == SPI_NAND_STATUS_REG_ADDR) {
+                if (now < dev.oip_until) {
+                    status |= NAND_OIP;
+                }
+                if (dev.pending) {
+                    status |= NAND_CRBSY;
+                }
+            }
+            rx[0] = status;
+        }
+        break;
+    case SPI_NAND_PAGE_READ:
+        page_loads++;
+        dev.pending = 1;
+        dev.load_to_cache = 1;
+        dev.pending_row = row_of(tx);
+        dev.array_until = now + t_rd;
+        dev.oip_until = dev.array_until;
+        break;
+    case SPI_NAND_READ_PAGE_CACHE_RANDOM: {
+        double start = dev_finish_load();
+        dev.cache_row = dev.data_row;
+        dev.oip_until = start + t_rcbsy;
+        dev.pending = 1;
+        dev.load_to_cache = 0;
+        dev.pending_row = row_of(tx);
+        dev.array_until = dev.oip_until + t_rd;
+        break;
+    }
+    case SPI_NAND_READ_PAGE_CACHE_LAST: {
+        double start = dev_finish_load();
+        dev.cache_row = dev.data_row;
+        dev.oip_until = start + t_rcbsy;
+        break;
+    }
+    case SPI_NAND_READ_CACHE_X1: {
+        uint32_t col = (((uint32_t)tx[1] << 8) | tx[2]) & 0xfff;
+        for (uint16_t i = 0; i < rxlen; i++) {
+            rx[i] = (col + i < PAGE_DATA_SIZE) ? page_byte(dev.cache_row, col + i) : 0xff;
+        }
+        break;
+    }
+    default:
+        break;
+    }
+
+    now += cs_us + (txlen + rxlen) * 8.0 / spi_mhz;
+}
+
+/* nand_spi.c replacements */
+void NAND_SPI_Init(SPI_HandleTypeDef *hspi) { (void)hspi; }
+
+void NAND_Wait(uint8_t milliseconds) { now += milliseconds * 1000.0; }
+
+NAND_SPI_ReturnType NAND_SPI_Send(SPI_Params *data_send) {
+    dev_transaction(data_send->buffer, data_send->length, NULL, 0);
+    return SPI_OK;
+}
+
+NAND_SPI_ReturnType NAND_SPI_SendReceive(SPI_Params *data_send, SPI_Params *data_recv) {
+    dev_transaction(data_send->buffer, data_send->length, data_recv->buffer, data_recv->length);
+    return SPI_OK;
+}
+
+NAND_SPI_ReturnType NAND_SPI_Receive(SPI_Params *data_recv) {
+    now += cs_us + data_recv->length * 8.0 / spi_mhz;
+    return SPI_OK;
+}
+
+NAND_SPI_ReturnType NAND_SPI_Send_Command_Data(SPI_Params *cmd_send, SPI_Params *data_send) {
+    now += cs_us + (cmd_send->length + data_send->length) * 8.0 / spi_mhz;
+    return SPI_OK;
+}
+
+NAND_SPI_ReturnType NAND_SPI_SendReceive_DMA(SPI_Params *data_send, SPI_Params *data_recv, NAND_SPI_Callback done,
+                                             void *arg) {
+    NAND_SPI_ReturnType ret = NAND_SPI_SendReceive(data_send, data_recv);
+    if (done) {
+        done(ret, arg);
+    }
+    return ret;
+}
+
+NAND_SPI_ReturnType NAND_SPI_Send_Command_Data_DMA(SPI_Params *cmd_send, SPI_Params *data_send,
+                                                   NAND_SPI_Callback done, void *arg) {
+    NAND_SPI_ReturnType ret = NAND_SPI_Send_Command_Data(cmd_send, data_send);
+    if (done) {
+        done(ret, arg);
+    }
+    return ret;
+}
+
+bool NAND_SPI_Busy(void) { return false; }
+
+NAND_SPI_ReturnType NAND_SPI_Wait_DMA(void) { return SPI_OK; }
+
+void __nand_spi_cs_low(void) {}
+void __nand_spi_cs_high(void) {}
+
+static void next_page(PhysicalAddrs *addr) {
+    if (++addr->page >= NUM_PAGES_PER_BLOCK) {
+        addr->page = 0;
+        addr->block++;
+    }
+}
+
+static int check_page(PhysicalAddrs *addr, uint8_t *buf) {
+    uint32_t row = ((uint32_t)addr->block << 6) | addr->page;
+    for (uint32_t i = 0; i < PAGE_DATA_SIZE; i++) {
+        if (buf[i] != page_byte(row, i)) {
+            fprintf(stderr, "mismatch at block %d page %d byte %u\n", addr->block, addr->page, i);
+            return -1;
+        }
+    }
+    return 0;
+}
+
+/*
+ * Reads the page in CHUNK_SIZE pieces. Like NANDfs_core_read, only the piece
+ * that ends the page starts the load of the next one.
+ */
+static NAND_ReturnType read_chunks(PhysicalAddrs *addr, PhysicalAddrs *next, uint8_t *buf) {
+    NAND_ReturnType ret = Ret_Success;
+
+    for (uint16_t col = 0; col < PAGE_DATA_SIZE && ret == Ret_Success; col += CHUNK_SIZE) {
+        addr->column = col;
+        ret = NAND_Page_Read_Sequential(addr, (col + CHUNK_SIZE == PAGE_DATA_SIZE) ? next : NULL, CHUNK_SIZE,
+                                        buf + col);
+    }
+    addr->column = 0;
+    return ret;
+}
+
+/* mode 0: NAND_Page_Read, 1: NAND_Page_Read_Sequential, 2: in CHUNK_SIZE pieces */
+static int run(int mode, double *elapsed, int *loads) {
+    static uint8_t buf[PAGE_DATA_SIZE];
+    PhysicalAddrs addr = {.block = 3};
+
+    memset(&dev, 0, sizeof(dev));
+    now = 0;
+    page_loads = 0;
+    for (int i = 0; i < pages; i++) {
+        PhysicalAddrs next = addr;
+        next_page(&next);
+        NAND_ReturnType ret;
+        if (mode == 2) {
+            ret = read_chunks(&addr, (i + 1 < pages) ? &next : NULL, buf);
+        } else if (mode == 1) {
+            ret = NAND_Page_Read_Sequential(&addr, (i + 1 < pages) ? &next : NULL, PAGE_DATA_SIZE, buf);
+        } else {
+            ret = NAND_Page_Read(&addr, PAGE_DATA_SIZE, buf);
+        }
+        if (ret != Ret_Success) {
+            fprintf(stderr, "read failed at block %d page %d: %d\n", addr.block, addr.page, ret);
+            return -1;
+        }
+        if (check_page(&addr, buf)) {
+            return -1;
+        }
+        addr = next;
+    }
+    *elapsed = now;
+    *loads = page_loads;
+    return 0;
+}
+
+void usage(const char *pgm) {
+    const char *name = (pgm) ? pgm : "usage";
+
+    fprintf(stderr, "%s [-n pages] [-s spi_mhz] [-o cs_overhead_us] [-r tRD_us] [-c tRCBSY_us]\n", name);
+    exit(1);
+}
+
+int main(int argc, char **argv) {
+    double blocking, pipelined, chunked;
+    int loads[3];
+    int i = 1;
+
+    while (i < argc) {
+        if (argv[i][0] != '-' || argv[i][2] != 0 || i + 1 >= argc) {
+            usage(argv[0]);
+        }
+        double val = atof(argv[i + 1]);
+        switch (argv[i][1]) {
+        case 'n':
+            pages = (int)val;
+            break;
+        case 's':
+            spi_mhz = val;
+            break;
+        case 'o':
+            cs_us = val;
+            break;
+        case 'r':
+            t_rd = val;
+            break;
+        case 'c':
+            t_rcbsy = val;
+            break;
+        default:
+            usage(argv[0]);
+        }
+        i += 2;
+    }
+    if (pages <= 0 || spi_mhz <= 0) {
+        usage(argv[0]);
+    }
+
+    if (run(0, &blocking, &loads[0]) || run(1, &pipelined, &loads[1]) || run(2, &chunked, &loads[2])) {
+        return 1;
+    }
+
+    printf("%d pages, SPI %.1f MHz, tRD %.0f us, tRCBSY %.0f us\n", pages, spi_mhz, t_rd, t_rcbsy);
+    printf("NAND_Page_Read:            %9.0f us, %7.1f us/page, %6.0f KB/s\n", blocking, blocking / pages,
+           pages * 2.0 * 1e6 / blocking);
+    printf("NAND_Page_Read_Sequential: %9.0f us, %7.1f us/page, %6.0f KB/s\n", pipelined, pipelined / pages,
+           pages * 2.0 * 1e6 / pipelined);
+    printf("%d byte reads:            %9.0f us, %7.1f us/page, %6.0f KB/s, %d PAGE READs\n", CHUNK_SIZE, chunked,
+           chunked / pages, pages * 2.0 * 1e6 / chunked, loads[2]);
+    printf("speedup %.2fx\n", blocking / pipelined);
+    return 0;
+}
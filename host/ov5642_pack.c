@@ -0,0 +1,193 @@
+/*
+ * ov5642_pack.c
+ *
+ * Generates Core/Inc/drivers/arducam/ov5642_regs_packed.h, the run encoded
+ * copies of the OV5642 register tables in ov5642_regs.h that the firmware
+ * loads with sccb_write_packed(). Run it after changing a table:
+ *
+ *   gcc -O2 -Ihost/mock -ICore/Inc/drivers/i2c -ICore/Inc/drivers/arducam -o host/ov5642_pack \
+ *       host/ov5642_pack.c
+ *   host/ov5642_pack -o Core/Inc/drivers/arducam/ov5642_regs_packed.h
+ *
+ * -c checks the header is up to date instead of writing it.
+ */
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "stm32l0xx_hal.h"
+#include "sccb_table.h"
+#include "ov5642_regs.h"
+
+#define MAX_NAME_LEN 64
+#define MAX_PACKED 4096
+#define MAX_HEADER (64 * 1024)
+
+typedef struct {
+    const char *name;
+    const struct sensor_reg *table;
+} table_t;
+
+// Every table the firmware loads
+static const table_t tables[] = {
+    {"OV5642_QVGA_Preview", OV5642_QVGA_Preview},
+    {"OV5642_JPEG_Capture_QSXGA", OV5642_JPEG_Capture_QSXGA},
+    {"OV5642_JPEG_Finish", OV5642_JPEG_Finish},
+    {"ov5642_320x240", ov5642_320x240},
+    {"ov5642_640x480", ov5642_640x480},
+    {"ov5642_1024x768", ov5642_1024x768},
+    {"ov5642_1280x960", ov5642_1280x960},
+    {"ov5642_2592x1944", ov5642_2592x1944},
+    {"OV5642_RAW_Init_start", OV5642_RAW_Init_start},
+    {"OV5642_RAW_Init_finish", OV5642_RAW_Init_finish},
+};
+
+static char header[MAX_HEADER];
+static size_t header_len;
+
+__attribute__((format(printf, 1, 2))) static void emit(const char *fmt, ...) {
+    va_list ap;
+
+    va_start(ap, fmt);
+    header_len += vsnprintf(header + header_len, sizeof(header) - header_len, fmt, ap);
+    va_end(ap);
+    if (header_len >= sizeof(header)) {
+        fprintf(stderr, "header too long\n");
+        exit(1);
+    }
+}
+
+/*
+ * Encodes a table, returns the packed length. Runs are split exactly where
+ * sccb_write_table splits them, capped at SCCB_PACKED_RUN_MAX.
+ */
+static int pack(const struct sensor_reg *table, uint8_t *out, int *entries) {
+    const struct sensor_reg *curr = table;
+    int len = 0;
+    int page = -1; // page of the previous run's start
+
+    *entries = 0;
+    while (curr->reg != REG_LIST_END) {
+        if (curr->reg == REG_DELAY) {
+            if (curr->val > SCCB_PACKED_DELAY_MAX) {
+                fprintf(stderr, "delay of %u ms is too long\n", curr->val);
+                exit(1);
+            }
+            out[len++] = SCCB_PACKED_DELAY | (curr->val >> 8);
+            out[len++] = curr->val & 0xff;
+            curr++;
+            (*entries)++;
+            continue;
+        }
+        int n = 0;
+        while (n < SCCB_PACKED_RUN_MAX && curr[n].reg < REG_DELAY && curr[n].reg == curr[0].reg + n) {
+            n++;
+        }
+        if (curr->reg >> 8 == page) {
+            out[len++] = SCCB_PACKED_PAGE | n;
+            out[len++] = curr->reg & 0xff;
+        } else {
+            out[len++] = n;
+            out[len++] = curr->reg >> 8;
+            out[len++] = curr->reg & 0xff;
+        }
+        page = curr->reg >> 8;
+        for (int i = 0; i < n; i++) {
+            out[len++] = (uint8_t)curr[i].val;
+        }
+        curr += n;
+        *entries += n;
+        if (len > MAX_PACKED - SCCB_PACKED_RUN_MAX - 4) {
+            fprintf(stderr, "table too long\n");
+            exit(1);
+        }
+    }
+    out[len++] = SCCB_PACKED_END;
+    return len;
+}
+
+static void generate(void) {
+    static uint8_t packed[MAX_PACKED];
+    int total_old = 0, total_new = 0;
+
+    emit("/*\n * ov5642_regs_packed.h\n *\n");
+    emit(" * Generated by host/ov5642_pack from ov5642_regs.h, do not edit.\n");
+    emit(" * Run encoded for sccb_write_packed(), the format is in sccb_table.h.\n */\n");
+    emit("#ifndef OV5642_REGS_PACKED_H\n#define OV5642_REGS_PACKED_H\n\n#include <stdint.h>\n");
+    for (size_t t = 0; t < sizeof(tables) / sizeof(tables[0]); t++) {
+        int entries;
+        int len = pack(tables[t].table, packed, &entries);
+        int old = (entries + 1) * (int)sizeof(struct sensor_reg);
+
+        emit("\n// %d entries, %d bytes as sensor_reg\n", entries, old);
+        emit("const uint8_t %s_packed[%d] = {", tables[t].name, len);
+        for (int i = 0; i < len; i++) {
+            emit("%s0x%02x,", (i % 16) ? " " : "\n    ", packed[i]);
+        }
+        emit("\n};\n");
+        total_old += old;
+        total_new += len;
+    }
+    emit("\n// %d bytes, %d as sensor_reg\n\n#endif /* OV5642_REGS_PACKED_H */\n", total_new, total_old);
+}
+
+void usage(const char *pgm) {
+    const char *name = (pgm) ? pgm : "usage";
+
+    fprintf(stderr, "%s [-o header] [-c header]\n", name);
+    exit(1);
+}
+
+int main(int argc, char **argv) {
+    char out_name[MAX_NAME_LEN * 4] = "";
+    int check = 0;
+    int i = 1;
+
+    while (i < argc) {
+        if (argv[i][0] != '-' || argv[i][2] != 0 || i + 1 >= argc) {
+            usage(argv[0]);
+        }
+        switch (argv[i][1]) {
+        case 'c':
+            check = 1;
+            /* fall through */
+        case 'o':
+            strncpy(out_name, argv[i + 1], sizeof(out_name) - 1);
+            break;
+        default:
+            usage(argv[0]);
+        }
+        i += 2;
+    }
+
+    generate();
+    if (!out_name[0]) {
+        fwrite(header, 1, header_len, stdout);
+        return 0;
+    }
+
+    if (check) {
+        static char current[MAX_HEADER];
+        FILE *f = fopen(out_name, "rb");
+        size_t n = f ? fread(current, 1, sizeof(current), f) : 0;
+        if (f) {
+            fclose(f);
+        }
+        if (n != header_len || memcmp(current, header, n) != 0) {
+            printf("%s is out of date\nFAIL\n", out_name);
+            return 1;
+        }
+        printf("%s is up to date\nPASS\n", out_name);
+        return 0;
+    }
+
+    FILE *f = fopen(out_name, "wb");
+    if (!f || fwrite(header, 1, header_len, f) != header_len) {
+        fprintf(stderr, "can't write %s\n", out_name);
+        return 1;
+    }
+    fclose(f);
+    return 0;
+}
@@ -0,0 +1,267 @@
+/*
+ * rle_stream_bench.c
+ *
+ * Codes a RAW capture with the streaming RLE coder the way the firmware
+ * stores it, a FIFO chunk at a time, decodes it again a NAND page at a time
+ * and checks the round trip. The ratio is compared with RLE_Compress on the
+ * whole image, which needs the image and its output in RAM at once.
+ *
+ * Also round trips synthetic data full of runs and marker candidates in
+ * chunks of every size from 1 byte up.
+ *
+ * Build from the repository root:
+ *   gcc -O2 -ICore/Inc/drivers/compression -o host/rle_stream_bench host/rle_stream_bench.c \
+ *       Core/Src/drivers/compression/rle_stream.c Core/Src/drivers/compression/rle.c
+ *   host/rle_stream_bench -i host/img1.yuv422
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+
+#include "rle.h"
+#include "rle_stream.h"
+
+#define MAX_NAME_LEN 64
+#define FIFO_CHUNK 256  // CAMERA_CHUNK_SIZE in command_handler.c
+#define NAND_PAGE 2048  // PAGE_DATA_SIZE
+#define MAX_SYNTH 20000
+
+static int failures;
+
+#define CHECK(cond, ...)                                                                                           \
+    do {                                                                                                           \
+        if (!(cond)) {                                                                                             \
+            fprintf(stderr, "FAIL %s:%d: ", __FILE__, __LINE__);                                                   \
+            fprintf(stderr, __VA_ARGS__);                                                                          \
+            fprintf(stderr, "\n");                                                                                 \
+            failures++;                                                                                            \
+        }                                                                                                          \
+    } while (0)
+
+typedef struct {
+    uint8_t *data;
+    uint32_t len;
+    uint32_t size;
+    uint32_t calls;
+} buffer_t;
+
+static int buffer_sink(const uint8_t *data, uint32_t len, void *arg) {
+    buffer_t *out = (buffer_t *)arg;
+
+    if (out->len + len > out->size) {
+        return -7;
+    }
+    memcpy(out->data + out->len, data, len);
+    out->len += len;
+    out->calls++;
+    return 0;
+}
+
+static double now_ms(void) {
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e3 + ts.tv_nsec / 1e6;
+}
+
+static void encode(const uint8_t *in, uint32_t len, uint32_t chunk, buffer_t *out) {
+    static rle_stream_t s;
+
+    out->len = 0;
+    rle_stream_init(&s, buffer_sink, out);
+    for (uint32_t i = 0; i < len; i += chunk) {
+        uint32_t n = (len - i < chunk) ? len - i : chunk;
+        CHECK(rle_stream_feed(&s, in + i, n) == 0, "coding failed at %u", i);
+    }
+    CHECK(rle_stream_finish(&s) == 0, "finish failed");
+    CHECK(s.out_bytes == out->len && s.in_bytes == len, "coder counted %u in, %u out", s.in_bytes, s.out_bytes);
+}
+
+static int decode(const uint8_t *in, uint32_t len, uint32_t chunk, buffer_t *out) {
+    static rle_decoder_t d;
+    int ret = 0;
+
+    out->len = 0;
+    rle_decoder_init(&d, buffer_sink, out);
+    for (uint32_t i = 0; i < len && ret == 0; i += chunk) {
+        uint32_t n = (len - i < chunk) ? len - i : chunk;
+        ret = rle_decoder_feed(&d, in + i, n);
+    }
+    return ret ? ret : rle_decoder_finish(&d);
+}
+
+/*
+ * Captures dumped over the UART, like host/img1.yuv422, are hex text. Turns
+ * them into the FIFO bytes in place, returns the byte count, or len if the
+ * file is binary.
+ */
+static uint32_t unhex(uint8_t *buf, uint32_t len) {
+    uint32_t n = 0;
+    int digits = 0;
+    uint8_t b = 0;
+
+    for (uint32_t i = 0; i < len; i++) {
+        uint8_t c = buf[i];
+        if (c == ' ' || c == '\n' || c == '\r') {
+            if (digits) {
+                buf[n++] = b;
+            }
+            digits = 0;
+            b = 0;
+            continue;
+        }
+        int v = (c >= '0' && c <= '9') ? c - '0' : (c >= 'a' && c <= 'f') ? c - 'a' + 10
+                                                  : (c >= 'A' && c <= 'F') ? c - 'A' + 10
+                                                                           : -1;
+        if (v < 0 || ++digits > 2) {
+            return len;
+        }
+        b = (uint8_t)(b << 4 | v);
+    }
+    if (digits) {
+        buf[n++] = b;
+    }
+    return n;
+}
+
+static void bench_image(const char *name) {
+    FILE *f = fopen(name, "rb");
+    if (!f) {
+        CHECK(0, "can't open %s", name);
+        return;
+    }
+    fseek(f, 0, SEEK_END);
+    uint32_t len = (uint32_t)ftell(f);
+    fseek(f, 0, SEEK_SET);
+
+    uint32_t bound = (len * 104 + 50) / 100 + 384;
+    uint8_t *image = malloc(len);
+    buffer_t coded = {.data = malloc(bound), .size = bound};
+    buffer_t decoded = {.data = malloc(len), .size = len};
+    uint8_t *whole = malloc(bound);
+    if (!image || !coded.data || !decoded.data || !whole || fread(image, 1, len, f) != len) {
+        CHECK(0, "can't read %s", name);
+        fclose(f);
+        return;
+    }
+    fclose(f);
+    uint32_t file_len = len;
+    len = unhex(image, len);
+    if (len != file_len) {
+        printf("%s: %u bytes of hex text\n", name, file_len);
+    }
+
+    double t0 = now_ms();
+    int whole_len = RLE_Compress(image, whole, len);
+    double t1 = now_ms();
+    encode(image, len, FIFO_CHUNK, &coded);
+    double t2 = now_ms();
+    int ret = decode(coded.data, coded.len, NAND_PAGE, &decoded);
+    double t3 = now_ms();
+
+    CHECK(ret == 0 && decoded.len == len && memcmp(decoded.data, image, len) == 0,
+          "%s: round trip gave %u bytes, ret %d", name, decoded.len, ret);
+    printf("%s: %u bytes\n", name, len);
+    printf("  RLE_Compress whole image: %d bytes (%.1f%%), %.1f ms, %u bytes of RAM\n", whole_len,
+           100.0 * whole_len / len, t1 - t0, len + bound);
+    printf("  stream, %d byte chunks:  %u bytes (%.1f%%), %.1f ms, %zu bytes of state, %u sink calls\n", FIFO_CHUNK,
+           coded.len, 100.0 * coded.len / len, t2 - t1, sizeof(rle_stream_t), coded.calls);
+    printf("  stream decode, %d byte pages: %.1f ms, %zu bytes of state\n", NAND_PAGE, t3 - t2,
+           sizeof(rle_decoder_t));
+
+    free(image);
+    free(coded.data);
+    free(decoded.data);
+    free(whole);
+}
+
+/*
+ * Runs of every length around the code boundaries (3/4, 128/129, 32768),
+ * noise and long stretches of a single byte so the marker moves
+ */
+static uint32_t build_synth(uint8_t *buf) {
+    static const uint32_t runs[] = {1, 2, 3, 4, 5, 127, 128, 129, 130, 300, 4000, 1, 1, 2};
+    uint32_t n = 0;
+
+    for (int pass = 0; pass < 3; pass++) {
+        for (size_t r = 0; r < sizeof(runs) / sizeof(runs[0]); r++) {
+            uint8_t b = (uint8_t)(rand() % 4 + pass * 80); // the least common byte, the marker, moves
+            for (uint32_t i = 0; i < runs[r]; i++) {
+                buf[n++] = b;
+            }
+        }
+        for (int i = 0; i < 500; i++) {
+            buf[n++] = (uint8_t)rand();
+        }
+    }
+    return n;
+}
+
+static void test_chunks(void) {
+    static uint8_t synth[MAX_SYNTH];
+    static uint8_t coded_buf[MAX_SYNTH * 2], decoded_buf[MAX_SYNTH];
+    buffer_t coded = {.data = coded_buf, .size = sizeof(coded_buf)};
+    buffer_t decoded = {.data = decoded_buf, .size = sizeof(decoded_buf)};
+    uint32_t len = build_synth(synth);
+    int bad = 0;
+
+    for (uint32_t chunk = 1; chunk <= len && !bad; chunk += (chunk < 40) ? 1 : 331) {
+        encode(synth, len, chunk, &coded);
+        int ret = decode(coded.data, coded.len, chunk, &decoded);
+        bad = ret != 0 || decoded.len != len || memcmp(decoded.data, synth, len) != 0;
+        CHECK(!bad, "%u byte chunks: %u bytes back of %u, ret %d", chunk, decoded.len, len, ret);
+    }
+
+    // a run longer than one code holds
+    static uint8_t flat[70000];
+    static uint8_t flat_coded[64], flat_decoded[sizeof(flat)];
+    buffer_t fc = {.data = flat_coded, .size = sizeof(flat_coded)};
+    buffer_t fd = {.data = flat_decoded, .size = sizeof(flat_decoded)};
+    memset(flat, 0x55, sizeof(flat));
+    encode(flat, sizeof(flat), 1000, &fc);
+    CHECK(decode(fc.data, fc.len, 7, &fd) == 0 && fd.len == sizeof(flat) && memcmp(fd.data, flat, fd.len) == 0,
+          "70000 byte run did not round trip");
+
+    // a stream cut inside a code
+    CHECK(decode(coded.data, 3, 3, &decoded) <= 0, "cut off stream");
+    printf("synthetic %u bytes: every chunking round trips, 70000 byte run in %u bytes\n", len, fc.len);
+}
+
+void usage(const char *pgm) {
+    const char *name = (pgm) ? pgm : "usage";
+
+    fprintf(stderr, "%s [-i raw] [-s seed]\n", name);
+    exit(1);
+}
+
+int main(int argc, char **argv) {
+    char in_name[MAX_NAME_LEN * 4] = "";
+    int i = 1;
+
+    while (i < argc) {
+        if (argv[i][0] != '-' || argv[i][2] != 0 || i + 1 >= argc) {
+            usage(argv[0]);
+        }
+        switch (argv[i][1]) {
+        case 'i':
+            strncpy(in_name, argv[i + 1], sizeof(in_name) - 1);
+            break;
+        case 's':
+            srand((unsigned)atoi(argv[i + 1]));
+            break;
+        default:
+            usage(argv[0]);
+        }
+        i += 2;
+    }
+
+    test_chunks();
+    if (in_name[0]) {
+        bench_image(in_name);
+    }
+
+    printf("%s\n", failures ? "FAIL" : "PASS");
+    return failures ? 1 : 0;
+}
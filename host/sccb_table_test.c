@@ -0,0 +1,460 @@
+/*
+ * sccb_table_test.c
+ *
+ * Replays the run encoded OV5642 register tables through the SCCB table
+ * loader against a mock I2C bus holding one register file per sensor, and
+ * the sensor_reg tables they come from the old way, one register per write
+ * followed by HAL_Delay(1) and one sensor after the other. Checks:
+ *  - both ways leave every sensor with the same registers
+ *  - every packed table writes what its sensor_reg table does, in the
+ *    same writes
+ *  - no register is written while a sensor is still in software reset
+ *  - runs are split at SCCB_BURST_MAX, repeated and out of order registers
+ *  - failed writes are counted
+ *  - the register shadow skips unchanged registers and answers reads, but
+ *    not after a reset, a failed write or for registers the sensor changes
+ * and reports the I2C transactions and simulated time of each.
+ *
+ * Build from the repository root:
+ *   gcc -O2 -Ihost/mock -ICore/Inc/drivers/i2c -ICore/Inc/drivers/arducam -o host/sccb_table_test \
+ *       host/sccb_table_test.c Core/Src/drivers/i2c/sccb_table.c
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "stm32l0xx_hal.h"
+#include "sccb_table.h"
+#include "ov5642_regs.h"
+#include "ov5642_regs_packed.h"
+
+#define MAX_NAME_LEN 64
+#define VIS_SENSOR 0x3C
+#define NIR_SENSOR 0x3E
+#define HAL_CALL_US 25 // HAL_I2C_Mem_Write set up and polling around the bytes
+
+static int failures;
+
+#define CHECK(cond, ...)                                                                                           \
+    do {                                                                                                           \
+        if (!(cond)) {                                                                                             \
+            fprintf(stderr, "FAIL %s:%d: ", __FILE__, __LINE__);                                                   \
+            fprintf(stderr, __VA_ARGS__);                                                                          \
+            fprintf(stderr, "\n");                                                                                 \
+            failures++;                                                                                            \
+        }                                                                                                          \
+    } while (0)
+
+/*
+ * Mock I2C bus, time is kept in microseconds
+ */
+typedef struct {
+    uint8_t addr;
+    uint8_t regs[0x10000];
+    double reset_until; // writes before this are lost in the software reset
+    uint32_t early;     // bytes written while in reset
+} mock_sensor_t;
+
+static mock_sensor_t mock_sensors[2];
+static double mock_us;
+static double bus_khz = 100;
+static uint32_t mock_transactions;
+static uint32_t mock_reads;
+static uint8_t mock_fail_addr; // writes to this address fail, 0 none
+static int mock_resets;        // software resets make the sensor deaf for a while
+
+static mock_sensor_t *_mock_sensor(uint16_t dev) {
+    for (int i = 0; i < 2; i++) {
+        if (mock_sensors[i].addr == dev >> 1) {
+            return &mock_sensors[i];
+        }
+    }
+    return NULL;
+}
+
+HAL_StatusTypeDef HAL_I2C_Mem_Write(I2C_HandleTypeDef *hi2c, uint16_t DevAddress, uint16_t MemAddress,
+                                    uint16_t MemAddSize, uint8_t *pData, uint16_t Size, uint32_t Timeout) {
+    mock_sensor_t *s = _mock_sensor(DevAddress);
+    double bit_us = 1000.0 / bus_khz;
+
+    (void)hi2c;
+    (void)Timeout;
+    mock_transactions++;
+    // start, device address, register address, data, stop
+    mock_us += HAL_CALL_US + bit_us * (2 + 9 * (1 + (MemAddSize == I2C_MEMADD_SIZE_16BIT ? 2 : 1) + Size));
+    if (!s || s->addr == mock_fail_addr) {
+        return HAL_ERROR;
+    }
+    for (uint16_t i = 0; i < Size; i++) {
+        uint16_t reg = MemAddress + i;
+        if (mock_us < s->reset_until) {
+            s->early++;
+            continue;
+        }
+        s->regs[reg] = pData[i];
+        if (mock_resets && reg == REG_SYS_CTL0 && (pData[i] & 0x80)) {
+            s->reset_until = mock_us + OV5642_RESET_SETTLE_MS * 1000.0;
+        }
+    }
+    return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_I2C_Mem_Read(I2C_HandleTypeDef *hi2c, uint16_t DevAddress, uint16_t MemAddress,
+                                   uint16_t MemAddSize, uint8_t *pData, uint16_t Size, uint32_t Timeout) {
+    mock_sensor_t *s = _mock_sensor(DevAddress);
+
+    (void)hi2c;
+    (void)MemAddSize;
+    (void)Timeout;
+    mock_reads++;
+    if (!s || s->addr == mock_fail_addr) {
+        return HAL_ERROR;
+    }
+    for (uint16_t i = 0; i < Size; i++) {
+        pData[i] = s->regs[(uint16_t)(MemAddress + i)];
+    }
+    return HAL_OK;
+}
+
+// HAL_Delay waits out the tick it is called in as well
+void HAL_Delay(uint32_t Delay) { mock_us += Delay * 1000.0 + 500.0; }
+
+uint32_t HAL_GetTick(void) { return (uint32_t)(mock_us / 1000.0); }
+
+static void mock_clock_reset(void) {
+    mock_us = 0;
+    mock_transactions = 0;
+    mock_reads = 0;
+}
+
+/*
+ * Starts a replay from the given register files, or from blank sensors
+ * that were just powered up and so have nothing in the register shadow.
+ * Only the table loader is held to the reset settling time, the old loader
+ * never waited for it.
+ */
+static void mock_reset(const mock_sensor_t *from, int resets) {
+    if (from) {
+        memcpy(mock_sensors, from, sizeof(mock_sensors));
+    } else {
+        memset(mock_sensors, 0, sizeof(mock_sensors));
+        sccb_shadow_invalidate(VIS_SENSOR);
+        sccb_shadow_invalidate(NIR_SENSOR);
+    }
+    for (int i = 0; i < 2; i++) {
+        mock_sensors[i].reset_until = 0;
+        mock_sensors[i].early = 0;
+    }
+    mock_sensors[0].addr = VIS_SENSOR;
+    mock_sensors[1].addr = NIR_SENSOR;
+    mock_clock_reset();
+    mock_fail_addr = 0;
+    mock_resets = resets;
+}
+
+/*
+ * The old loader: one write per register and HAL_Delay(1) after each
+ */
+static I2C_HandleTypeDef hi2c2;
+
+static void legacy_write(uint16_t reg, uint8_t val, uint8_t sensor) {
+    HAL_I2C_Mem_Write(&hi2c2, sensor << 1, reg, I2C_MEMADD_SIZE_16BIT, &val, 1, 100);
+    HAL_Delay(1);
+}
+
+static void legacy_write_table(const struct sensor_reg *reglist, uint8_t sensor) {
+    for (const struct sensor_reg *curr = reglist; curr->reg != REG_LIST_END; curr++) {
+        if (curr->reg != REG_DELAY) {
+            legacy_write(curr->reg, (uint8_t)curr->val, sensor);
+        }
+    }
+}
+
+/*
+ * program_sensor(JPEG) and arducam_set_resolution before and after
+ */
+static void legacy_program_jpeg(uint8_t sensor) {
+    legacy_write(REG_SYS_CTL0, 0x82, sensor);
+    legacy_write_table(OV5642_QVGA_Preview, sensor);
+    HAL_Delay(100);
+    HAL_Delay(100);
+    legacy_write_table(OV5642_JPEG_Capture_QSXGA, sensor);
+    legacy_write_table(ov5642_320x240, sensor);
+    HAL_Delay(100);
+    legacy_write_table(OV5642_JPEG_Finish, sensor);
+}
+
+static void legacy_set_resolution(const struct sensor_reg *window, uint8_t sensor) {
+    legacy_write_table(window, sensor);
+    HAL_Delay(1000);
+}
+
+static void program_jpeg(const uint8_t *sensors, int count) {
+    sccb_write_packed(&hi2c2, OV5642_QVGA_Preview_packed, sensors, count, NULL);
+    sccb_write_packed(&hi2c2, OV5642_JPEG_Capture_QSXGA_packed, sensors, count, NULL);
+    sccb_write_packed(&hi2c2, ov5642_320x240_packed, sensors, count, NULL);
+    sccb_write_packed(&hi2c2, OV5642_JPEG_Finish_packed, sensors, count, NULL);
+}
+
+static void set_resolution(const uint8_t *window, const uint8_t *sensors, int count) {
+    sccb_stats_t stats;
+
+    sccb_write_packed(&hi2c2, window, sensors, count, &stats);
+    if (stats.writes) {
+        HAL_Delay(OV5642_MODE_SETTLE_MS);
+    }
+}
+
+typedef struct {
+    uint32_t transactions;
+    double ms;
+} replay_t;
+
+static void compare(const char *name, replay_t *old, replay_t *new, mock_sensor_t *legacy_state) {
+    for (int i = 0; i < 2; i++) {
+        CHECK(memcmp(mock_sensors[i].regs, legacy_state[i].regs, sizeof(mock_sensors[i].regs)) == 0,
+              "%s: sensor 0x%x registers differ from the one at a time load", name, mock_sensors[i].addr);
+        CHECK(mock_sensors[i].early == 0, "%s: %u bytes written to sensor 0x%x during its reset", name,
+              mock_sensors[i].early, mock_sensors[i].addr);
+    }
+    printf("%-20s old %5u writes %8.1f ms, table loader %4u writes %7.1f ms", name, old->transactions, old->ms,
+           new->transactions, new->ms);
+    printf(new->ms > 0 ? ", %.1fx\n" : "\n", old->ms / new->ms);
+}
+
+static void test_replay(void) {
+    static mock_sensor_t legacy_state[2], programmed[2];
+    const uint8_t both[] = {VIS_SENSOR, NIR_SENSOR};
+    replay_t old, new;
+
+    // Boot programming of both sensors
+    mock_reset(NULL, 0);
+    legacy_program_jpeg(VIS_SENSOR);
+    legacy_program_jpeg(NIR_SENSOR);
+    old = (replay_t){mock_transactions, mock_us / 1000.0};
+    memcpy(legacy_state, mock_sensors, sizeof(mock_sensors));
+
+    mock_reset(NULL, 1);
+    program_jpeg(both, 2);
+    new = (replay_t){mock_transactions, mock_us / 1000.0};
+    compare("program JPEG x2", &old, &new, legacy_state);
+    memcpy(programmed, legacy_state, sizeof(programmed));
+
+    // Resolution changes one after the other, then the last one again, which
+    // the shadow turns into no traffic at all
+    const struct sensor_reg *windows[] = {ov5642_640x480,  ov5642_1024x768, ov5642_1280x960,
+                                          ov5642_2592x1944, ov5642_640x480,  ov5642_640x480};
+    const uint8_t *packed[] = {ov5642_640x480_packed,   ov5642_1024x768_packed, ov5642_1280x960_packed,
+                               ov5642_2592x1944_packed, ov5642_640x480_packed,  ov5642_640x480_packed};
+    const char *names[] = {"resolution 640 x2",  "resolution 1024 x2", "resolution 1280 x2",
+                           "resolution 2592 x2", "resolution 640 x2",  "same again x2"};
+    static mock_sensor_t legacy_steps[6][2], new_steps[2];
+    replay_t old_steps[6];
+
+    mock_reset(programmed, 0);
+    for (int w = 0; w < 6; w++) {
+        mock_clock_reset();
+        legacy_set_resolution(windows[w], VIS_SENSOR);
+        legacy_set_resolution(windows[w], NIR_SENSOR);
+        old_steps[w] = (replay_t){mock_transactions, mock_us / 1000.0};
+        memcpy(legacy_steps[w], mock_sensors, sizeof(mock_sensors));
+    }
+    mock_reset(programmed, 1); // the shadow still holds what program_jpeg wrote
+    for (int w = 0; w < 6; w++) {
+        mock_clock_reset();
+        set_resolution(packed[w], both, 2);
+        new = (replay_t){mock_transactions, mock_us / 1000.0};
+        memcpy(new_steps, mock_sensors, sizeof(new_steps));
+        compare(names[w], &old_steps[w], &new, legacy_steps[w]);
+        memcpy(mock_sensors, new_steps, sizeof(new_steps));
+    }
+    CHECK(new.transactions == 0 && new.ms == 0, "same resolution again: %u writes, %.1f ms", new.transactions,
+          new.ms);
+
+    // RAW init of one sensor, its table has a reset in it too
+    mock_reset(NULL, 0);
+    legacy_write_table(OV5642_RAW_Init_start, VIS_SENSOR);
+    legacy_write_table(OV5642_RAW_Init_finish, VIS_SENSOR);
+    old = (replay_t){mock_transactions, mock_us / 1000.0};
+    memcpy(legacy_state, mock_sensors, sizeof(mock_sensors));
+    mock_reset(NULL, 1);
+    sccb_write_packed(&hi2c2, OV5642_RAW_Init_start_packed, both, 1, NULL);
+    sccb_write_packed(&hi2c2, OV5642_RAW_Init_finish_packed, both, 1, NULL);
+    new = (replay_t){mock_transactions, mock_us / 1000.0};
+    compare("RAW init x1", &old, &new, legacy_state);
+}
+
+static void test_packed(void) {
+    static mock_sensor_t from_table[2];
+    const struct {
+        const struct sensor_reg *table;
+        const uint8_t *packed;
+        size_t packed_len;
+    } tables[] = {
+        {OV5642_QVGA_Preview, OV5642_QVGA_Preview_packed, sizeof(OV5642_QVGA_Preview_packed)},
+        {OV5642_JPEG_Capture_QSXGA, OV5642_JPEG_Capture_QSXGA_packed, sizeof(OV5642_JPEG_Capture_QSXGA_packed)},
+        {OV5642_JPEG_Finish, OV5642_JPEG_Finish_packed, sizeof(OV5642_JPEG_Finish_packed)},
+        {ov5642_320x240, ov5642_320x240_packed, sizeof(ov5642_320x240_packed)},
+        {ov5642_640x480, ov5642_640x480_packed, sizeof(ov5642_640x480_packed)},
+        {ov5642_1024x768, ov5642_1024x768_packed, sizeof(ov5642_1024x768_packed)},
+        {ov5642_1280x960, ov5642_1280x960_packed, sizeof(ov5642_1280x960_packed)},
+        {ov5642_2592x1944, ov5642_2592x1944_packed, sizeof(ov5642_2592x1944_packed)},
+        {OV5642_RAW_Init_start, OV5642_RAW_Init_start_packed, sizeof(OV5642_RAW_Init_start_packed)},
+        {OV5642_RAW_Init_finish, OV5642_RAW_Init_finish_packed, sizeof(OV5642_RAW_Init_finish_packed)},
+    };
+    const uint8_t vis = VIS_SENSOR;
+    size_t struct_bytes = 0, packed_bytes = 0;
+
+    for (size_t t = 0; t < sizeof(tables) / sizeof(tables[0]); t++) {
+        sccb_stats_t table_stats, packed_stats;
+        size_t entries = 1;
+
+        mock_reset(NULL, 1);
+        sccb_write_table(&hi2c2, tables[t].table, &vis, 1, &table_stats);
+        double table_us = mock_us;
+        memcpy(from_table, mock_sensors, sizeof(from_table));
+
+        mock_reset(NULL, 1);
+        sccb_write_packed(&hi2c2, tables[t].packed, &vis, 1, &packed_stats);
+        CHECK(memcmp(mock_sensors[0].regs, from_table[0].regs, sizeof(from_table[0].regs)) == 0,
+              "packed: table %zu writes different registers", t);
+        CHECK(packed_stats.writes == table_stats.writes && mock_us == table_us,
+              "packed: table %zu takes %u writes, %.0f us, %u and %.0f us unpacked", t, packed_stats.writes,
+              mock_us, table_stats.writes, table_us);
+        for (const struct sensor_reg *curr = tables[t].table; curr->reg != REG_LIST_END; curr++) {
+            entries++;
+        }
+        struct_bytes += entries * sizeof(struct sensor_reg);
+        packed_bytes += tables[t].packed_len;
+    }
+    printf("register tables: %zu bytes packed, %zu as sensor_reg\n", packed_bytes, struct_bytes);
+}
+
+static void test_runs(void) {
+    static struct sensor_reg table[128];
+    const uint8_t vis = VIS_SENSOR;
+    int n = 0;
+
+    for (int i = 0; i < 70; i++) { // 70 consecutive registers take three writes
+        table[n++] = (struct sensor_reg){0x5000 + i, (uint16_t)i};
+    }
+    table[n++] = (struct sensor_reg){0x5045, 0xaa}; // repeats the last register
+    table[n++] = (struct sensor_reg){0x5044, 0xbb}; // goes backwards
+    table[n++] = (struct sensor_reg){REG_DELAY, 7};
+    table[n++] = (struct sensor_reg){0x5046, 0xcc}; // consecutive, but after the delay
+    table[n++] = (struct sensor_reg){REG_LIST_END, 0xff};
+
+    mock_reset(NULL, 1);
+    int ret = sccb_write_table(&hi2c2, table, &vis, 1, NULL);
+    CHECK(ret == 0, "runs: write table returned %d", ret);
+    CHECK(mock_transactions == 6, "runs: %u writes, 6 expected", mock_transactions);
+    CHECK(mock_us > 7000.0, "runs: the delay entry was not waited, %.0f us", mock_us);
+    for (int i = 0; i < 0x44; i++) {
+        CHECK(mock_sensors[0].regs[0x5000 + i] == i, "runs: register 0x%x is 0x%x", 0x5000 + i,
+              mock_sensors[0].regs[0x5000 + i]);
+    }
+    CHECK(mock_sensors[0].regs[0x5044] == 0xbb && mock_sensors[0].regs[0x5045] == 0xaa &&
+              mock_sensors[0].regs[0x5046] == 0xcc,
+          "runs: repeated registers written out of order");
+}
+
+static void test_errors(void) {
+    const uint8_t both[] = {VIS_SENSOR, NIR_SENSOR};
+
+    sccb_stats_t stats;
+
+    mock_reset(NULL, 1);
+    mock_fail_addr = NIR_SENSOR;
+    int ret = sccb_write_table(&hi2c2, ov5642_1280x960, both, 2, &stats);
+    CHECK(ret == -1, "errors: write table returned %d", ret);
+    CHECK(stats.failed == stats.writes / 2, "errors: %u failed writes reported, NIR got %u", stats.failed,
+          stats.writes / 2);
+    CHECK(mock_sensors[0].regs[REG_DVPHO_HI] == 0x5, "errors: VIS was not written");
+
+    // Nothing was learned about NIR, the same table goes out to it again
+    mock_fail_addr = 0;
+    mock_clock_reset();
+    sccb_write_table(&hi2c2, ov5642_1280x960, both, 2, &stats);
+    CHECK(stats.failed == 0 && mock_transactions == stats.writes && stats.writes > 0,
+          "errors: %u writes after the failure, all should go to NIR", stats.writes);
+    CHECK(mock_sensors[1].regs[REG_DVPHO_HI] == 0x5, "errors: NIR was not written after the failure");
+}
+
+static void test_shadow(void) {
+    const uint8_t vis = VIS_SENSOR;
+    uint8_t val = 0;
+
+    mock_reset(NULL, 0);
+    CHECK(sccb_write_reg(&hi2c2, VIS_SENSOR, 0x5583, 0x40) == 1, "shadow: first write skipped");
+    CHECK(sccb_write_reg(&hi2c2, VIS_SENSOR, 0x5583, 0x40) == 0, "shadow: unchanged write went out");
+    CHECK(sccb_write_reg(&hi2c2, VIS_SENSOR, 0x5583, 0x50) == 1, "shadow: changed write skipped");
+    CHECK(sccb_write_reg(&hi2c2, NIR_SENSOR, 0x5583, 0x50) == 1, "shadow: NIR write taken from VIS shadow");
+
+    mock_clock_reset();
+    sccb_read_reg(&hi2c2, VIS_SENSOR, 0x5583, &val);
+    CHECK(val == 0x50 && mock_reads == 0, "shadow: read 0x%x with %u bus reads", val, mock_reads);
+    sccb_read_reg(&hi2c2, VIS_SENSOR, OV5642_CHIPID_HIGH, &val);
+    CHECK(mock_reads == 1, "shadow: register never written was not read from the sensor");
+
+    // AEC moves the exposure by itself, it is always read and written
+    sccb_write_reg(&hi2c2, VIS_SENSOR, 0x3501, 0x10);
+    mock_sensors[0].regs[0x3501] = 0x44;
+    sccb_read_reg(&hi2c2, VIS_SENSOR, 0x3501, &val);
+    CHECK(val == 0x44, "shadow: exposure read 0x%x from the shadow", val);
+    CHECK(sccb_write_reg(&hi2c2, VIS_SENSOR, 0x3501, 0x10) == 1, "shadow: exposure write skipped");
+
+    // A software reset forgets everything
+    const struct sensor_reg reset[] = {{REG_SYS_CTL0, 0x82}, {REG_LIST_END, 0xff}};
+    sccb_write_table(&hi2c2, reset, &vis, 1, NULL);
+    CHECK(sccb_write_reg(&hi2c2, VIS_SENSOR, 0x5583, 0x50) == 1, "shadow: write skipped after a reset");
+    CHECK(sccb_write_reg(&hi2c2, NIR_SENSOR, 0x5583, 0x50) == 0, "shadow: VIS reset dropped the NIR shadow");
+
+    // Only the changed middle of a run goes out
+    const struct sensor_reg run[] = {{0x5680, 1}, {0x5681, 2}, {0x5682, 3}, {0x5683, 4}, {REG_LIST_END, 0xff}};
+    const struct sensor_reg mid[] = {{0x5680, 1}, {0x5681, 9}, {0x5682, 9}, {0x5683, 4}, {REG_LIST_END, 0xff}};
+    sccb_stats_t stats;
+    sccb_write_table(&hi2c2, run, &vis, 1, NULL);
+    sccb_write_table(&hi2c2, mid, &vis, 1, &stats);
+    CHECK(stats.writes == 1 && stats.skipped == 2, "shadow: %u writes, %u skipped for a 2 register change",
+          stats.writes, stats.skipped);
+    CHECK(mock_sensors[0].regs[0x5681] == 9 && mock_sensors[0].regs[0x5682] == 9, "shadow: change not written");
+}
+
+void usage(const char *pgm) {
+    const char *name = (pgm) ? pgm : "usage";
+
+    fprintf(stderr, "%s [-k bus_khz]\n", name);
+    exit(1);
+}
+
+int main(int argc, char **argv) {
+    int i = 1;
+
+    while (i < argc) {
+        if (argv[i][0] != '-' || argv[i][2] != 0 || i + 1 >= argc) {
+            usage(argv[0]);
+        }
+        switch (argv[i][1]) {
+        case 'k':
+            bus_khz = atof(argv[i + 1]);
+            if (bus_khz <= 0) {
+                usage(argv[0]);
+            }
+            break;
+        default:
+            usage(argv[0]);
+        }
+        i += 2;
+    }
+
+    printf("I2C at %.0f kHz, up to %d bytes per write\n", bus_khz, SCCB_BURST_MAX);
+    test_replay();
+    test_packed();
+    test_runs();
+    test_errors();
+    test_shadow();
+
+    printf("%s\n", failures ? "FAIL" : "PASS");
+    return failures ? 1 : 0;
+}
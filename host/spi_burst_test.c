@@ -0,0 +1,412 @@
+/*
+ * spi_burst_test.c
+ *
+ * Runs the bit-bang SPI driver against a simulated Arducam, register file and
+ * FIFO, and checks:
+ *  - the burst reader gets the same bytes as the byte-at-a-time reader, MSB
+ *    first, for any chunking of the reads
+ *  - one clock per bit, MISO sampled while the clock is high
+ *  - register writes and reads land in the right register, also when the
+ *    data is clocked in by the burst reader
+ *  - bursts start out at the register timing
+ *  - the loop calibration runs with both chip selects high
+ *  - each sensor's timing profile gives at least the half periods asked for,
+ *    with the fewest delay loops that do, and never a clock above
+ *    SPI_BURST_MAX_HZ
+ *
+ * The driver source is included here with its pin access macros pointing at
+ * the simulation. The reference reader below is spi_read_burst as it is in
+ * the driver, with the same register writes routed to the simulation.
+ *
+ * Time is counted in simulated SYSCLK cycles, a fixed cost per pin access and
+ * per delay loop, which is also what the mock TIM2 counter reads back.
+ *
+ * Build from the repository root:
+ *   gcc -O2 -Ihost/mock -ICore/Inc/drivers/spi -o host/spi_burst_test host/spi_burst_test.c
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+
+#define MAX_NAME_LEN 64
+
+/* Simulated cost of each step, in SYSCLK cycles */
+#define PIN_WRITE_CYCLES 2
+#define PIN_READ_CYCLES 3
+#define DELAY_LOOP_CYCLES 4
+#define TIMER_READ_CYCLES 4
+
+#define SENSOR 0x3C       /* VIS, on NSS1 */
+#define OTHER_SENSOR 0x3E /* NIR, on NSS2 */
+#define BURST_ADDR 0x3C   /* burst FIFO read */
+
+static void sim_clk(int level);
+static void sim_mosi(int level);
+static uint32_t sim_miso(void);
+
+#define BB_PORTS()
+#define BB_CLK_HIGH() sim_clk(1)
+#define BB_CLK_LOW() sim_clk(0)
+#define BB_MOSI(bit) sim_mosi(bit)
+#define BB_MISO() sim_miso()
+#include "../Core/Src/drivers/spi/spi_bitbang.c"
+
+static int failures;
+
+#define CHECK(cond, ...)                                                                                           \
+    do {                                                                                                           \
+        if (!(cond)) {                                                                                             \
+            fprintf(stderr, "FAIL %s:%d: ", __FILE__, __LINE__);                                                   \
+            fprintf(stderr, __VA_ARGS__);                                                                          \
+            fprintf(stderr, "\n");                                                                                 \
+            failures++;                                                                                            \
+        }                                                                                                          \
+    } while (0)
+
+GPIO_TypeDef mock_gpioa;
+GPIO_TypeDef mock_gpiob;
+TIM_HandleTypeDef htim2;
+uint32_t SystemCoreClock = 32000000;
+
+/*
+ * Simulated sensor. The first byte after CS goes low is the address, bit 7
+ * set for a write. A write stores the second byte, a read shifts the register
+ * out, and BURST_ADDR shifts out fifo[] until CS goes high. Bits go out MSB
+ * first, the next one on each falling edge.
+ */
+static uint8_t regs[128];
+static uint8_t *fifo;
+static uint32_t fifo_len;
+static uint32_t bit_pos;
+static uint8_t shift_in;
+static int addr_valid;
+static uint8_t addr;
+
+static int clk;
+static int mosi;
+static int cs_low;
+static uint64_t cycles;
+static uint64_t timer_base;
+static uint64_t last_rise;
+static uint64_t min_period;
+static uint32_t rises;
+static uint32_t rises_cs_high;
+static uint32_t bad_samples;
+static uint32_t timer_restarts;
+
+static void sim_reset(uint8_t *data, uint32_t len) {
+    fifo = data;
+    fifo_len = len;
+    last_rise = 0;
+    min_period = UINT64_MAX;
+    rises = 0;
+    rises_cs_high = 0;
+    bad_samples = 0;
+    timer_restarts = 0;
+}
+
+static void sim_clk(int level) {
+    cycles += PIN_WRITE_CYCLES;
+    if (level && !clk) {
+        if (rises && cycles - last_rise < min_period) {
+            min_period = cycles - last_rise;
+        }
+        last_rise = cycles;
+        rises++;
+        if (!cs_low) {
+            rises_cs_high++;
+        } else {
+            shift_in = (uint8_t)((shift_in << 1) | mosi);
+            if (bit_pos == 7) {
+                addr = shift_in;
+                addr_valid = 1;
+            } else if (bit_pos == 15 && (addr & 0x80) && addr != (BURST_ADDR | 0x80)) {
+                regs[addr & 0x7f] = shift_in;
+            }
+        }
+    } else if (!level && clk && cs_low) {
+        bit_pos++;
+    }
+    clk = level;
+}
+
+static void sim_mosi(int level) {
+    cycles += PIN_WRITE_CYCLES;
+    mosi = level ? 1 : 0;
+}
+
+static uint32_t sim_miso(void) {
+    uint32_t n = bit_pos;
+
+    cycles += PIN_READ_CYCLES;
+    if (!clk) {
+        bad_samples++;
+    }
+    if (!cs_low || !addr_valid || n < 8) {
+        return 0;
+    }
+    n -= 8;
+    if (addr == BURST_ADDR) {
+        return (fifo && n / 8 < fifo_len) ? (fifo[n / 8] >> (7 - n % 8)) & 1 : 0;
+    }
+    if (!(addr & 0x80) && n < 8) {
+        return (regs[addr] >> (7 - n)) & 1;
+    }
+    return 0;
+}
+
+void mock_tim_set_counter(TIM_HandleTypeDef *htim, uint32_t cnt) {
+    (void)htim;
+    timer_base = cycles - cnt;
+    timer_restarts++;
+}
+
+uint32_t mock_tim_get_counter(TIM_HandleTypeDef *htim) {
+    (void)htim;
+    cycles += TIMER_READ_CYCLES;
+    return (uint32_t)(cycles - timer_base);
+}
+
+void mock_nop(void) { cycles += DELAY_LOOP_CYCLES; }
+
+void HAL_GPIO_WritePin(GPIO_TypeDef *GPIOx, uint16_t GPIO_Pin, GPIO_PinState PinState) {
+    if (GPIOx == NSS1_Port && (GPIO_Pin == NSS1_Pin || GPIO_Pin == NSS2_Pin)) {
+        cs_low = PinState == GPIO_PIN_RESET;
+        bit_pos = 0;
+        addr_valid = 0;
+    }
+}
+
+/* spi_read_burst, register writes replaced by the simulation */
+static uint8_t reference_read_burst(uint8_t sensor) {
+    uint8_t rec[8];
+    (void)sensor;
+    for (int i = 0; i < 8; i++) {
+        sim_mosi(0); // MOSI_Port->BRR = MOSI_Pin
+        delay_us(SPI_DELAY);
+        sim_clk(1); // CLK_Port->BSRR = CLK_Pin
+        if (sim_miso()) {
+            rec[i] = 1;
+        } else {
+            rec[i] = 0;
+        }
+        delay_us(SPI_DELAY);
+        sim_clk(0); // CLK_Port->BRR = CLK_Pin
+    }
+    return parse_bits(rec);
+}
+
+/* Shortest clock period of a burst read with the sensor's profile */
+static uint64_t burst_period(uint8_t sensor) {
+    uint8_t buf[64];
+
+    sim_reset(NULL, 0);
+    spi_read_burst_buf(sensor, buf, sizeof(buf));
+    return min_period;
+}
+
+/*
+ * Checks a burst read clocks with half periods of at least half_cycles, and
+ * that one delay loop less would not
+ */
+static void check_burst_timing(uint8_t sensor, uint32_t half_cycles, const char *what) {
+    spi_profile_t *profile = _profile(sensor);
+    uint64_t period = burst_period(sensor);
+
+    CHECK(period >= 2 * half_cycles, "%s: %llu cycle clock, %u needed", what, (unsigned long long)period,
+          2 * half_cycles);
+    if (profile->burst_loops) {
+        profile->burst_loops--;
+        CHECK(burst_period(sensor) < 2 * half_cycles, "%s: %u delay loops is more than needed", what,
+              profile->burst_loops + 1);
+        profile->burst_loops++;
+    }
+}
+
+static void test_defaults(void) {
+    spi_timing_t timing;
+
+    spi_get_timing(OTHER_SENSOR, &timing);
+    CHECK(timing.burst_half_cycles == SPI_REG_HALF_CYCLES, "default burst half period %u, register timing is %u",
+          timing.burst_half_cycles, SPI_REG_HALF_CYCLES);
+    check_burst_timing(OTHER_SENSOR, SPI_REG_HALF_CYCLES, "uncalibrated");
+}
+
+static void test_calibration(uint32_t sysclk) {
+    spi_timing_t timing = {.reg_half_cycles = SPI_REG_HALF_CYCLES, .burst_half_cycles = 0};
+    char what[MAX_NAME_LEN];
+
+    SystemCoreClock = sysclk;
+    profiles[0].timing = timing;
+    profiles[1].timing = timing;
+    bb_calibrated = false;
+    sim_reset(NULL, 0);
+    spi_init_burst(SENSOR);
+    spi_deinit_burst(SENSOR);
+    CHECK(rises_cs_high == 2 * BB_CAL_BYTES * 8, "%u clocks with CS high, expected calibration runs only",
+          rises_cs_high);
+
+    snprintf(what, sizeof(what), "%u MHz default", sysclk / 1000000);
+    check_burst_timing(SENSOR, SPI_BURST_MIN_HALF_CYCLES, what);
+    printf("%3u MHz SYSCLK: %u delay loops, %llu cycle clock (%u minimum)\n", sysclk / 1000000,
+           profiles[0].burst_loops, (unsigned long long)burst_period(SENSOR), sysclk / SPI_BURST_MAX_HZ);
+}
+
+static void test_profiles(void) {
+    spi_timing_t vis = {.reg_half_cycles = 20, .burst_half_cycles = 6};
+    spi_timing_t nir, got;
+
+    spi_get_timing(OTHER_SENSOR, &nir);
+    uint64_t nir_period = burst_period(OTHER_SENSOR);
+
+    spi_set_timing(SENSOR, &vis);
+    spi_get_timing(SENSOR, &got);
+    CHECK(got.reg_half_cycles == vis.reg_half_cycles && got.burst_half_cycles == vis.burst_half_cycles,
+          "timing read back as %u/%u", got.reg_half_cycles, got.burst_half_cycles);
+    check_burst_timing(SENSOR, vis.burst_half_cycles, "VIS burst");
+    CHECK(burst_period(OTHER_SENSOR) == nir_period, "setting VIS changed the NIR clock");
+
+    sim_reset(NULL, 0);
+    write_spi_reg(1, 0x5a, SENSOR);
+    uint64_t reg_period = min_period;
+    CHECK(reg_period >= 2 * vis.reg_half_cycles, "register write: %llu cycle clock, %u needed",
+          (unsigned long long)reg_period, 2 * vis.reg_half_cycles);
+    printf("VIS reg %u burst %u: %llu cycle register clock, %llu cycle burst clock, NIR %llu\n",
+           vis.reg_half_cycles, vis.burst_half_cycles, (unsigned long long)reg_period,
+           (unsigned long long)burst_period(SENSOR), (unsigned long long)nir_period);
+
+    spi_timing_t fast = {0, 0};
+    spi_set_timing(SENSOR, &fast);
+    spi_get_timing(SENSOR, &got);
+    CHECK(got.reg_half_cycles == SPI_BURST_MIN_HALF_CYCLES && got.burst_half_cycles == SPI_BURST_MIN_HALF_CYCLES,
+          "timing under the minimum read back as %u/%u", got.reg_half_cycles, got.burst_half_cycles);
+
+    spi_set_timing(SENSOR, &nir);
+}
+
+static void test_registers(void) {
+    static const uint16_t halves[] = {SPI_REG_HALF_CYCLES, 8, 2};
+    spi_timing_t saved, timing;
+
+    spi_get_timing(SENSOR, &saved);
+    for (size_t h = 0; h < sizeof(halves) / sizeof(halves[0]); h++) {
+        timing.reg_half_cycles = halves[h];
+        timing.burst_half_cycles = halves[sizeof(halves) / sizeof(halves[0]) - 1 - h];
+        spi_set_timing(SENSOR, &timing);
+
+        int bad = 0;
+        for (int i = 0; i < 256; i++) {
+            uint8_t reg = (uint8_t)(rand() & 0x7f);
+            uint8_t val = (uint8_t)rand();
+            if (reg == BURST_ADDR) {
+                continue;
+            }
+            sim_reset(NULL, 0);
+            write_spi_reg(reg, val, SENSOR);
+            bad += regs[reg] != val;
+            bad += read_spi_reg(reg, SENSOR) != val;
+            bad += read_spi_reg_burst(reg, SENSOR) != val;
+            bad += bad_samples != 0;
+        }
+        CHECK(bad == 0, "register half period %u: %d bad accesses", halves[h], bad);
+    }
+    spi_set_timing(SENSOR, &saved);
+}
+
+static void test_bit_order(uint32_t len, const uint32_t *chunks, int nchunks) {
+    uint8_t *data = malloc(len);
+    uint8_t *ref = malloc(len);
+    uint8_t *got = malloc(len);
+
+    for (uint32_t i = 0; i < len; i++) {
+        data[i] = (uint8_t)rand();
+    }
+    data[0] = 0x80; // lone MSB and LSB catch a reversed bit order
+    if (len > 1) {
+        data[1] = 0x01;
+    }
+
+    sim_reset(data, len);
+    spi_init_burst(SENSOR);
+    uint64_t start = cycles;
+    for (uint32_t i = 0; i < len; i++) {
+        ref[i] = reference_read_burst(SENSOR);
+    }
+    uint64_t ref_cycles = cycles - start;
+    uint32_t ref_restarts = timer_restarts;
+    spi_deinit_burst(SENSOR);
+    CHECK(memcmp(ref, data, len) == 0, "reference reader does not match the FIFO");
+
+    for (int c = 0; c < nchunks; c++) {
+        sim_reset(data, len);
+        spi_init_burst(SENSOR);
+        rises = 0;
+        memset(got, 0, len);
+        start = cycles;
+        for (uint32_t i = 0; i < len; i += chunks[c]) {
+            uint32_t n = (len - i < chunks[c]) ? len - i : chunks[c];
+            spi_read_burst_buf(SENSOR, got + i, n);
+        }
+        uint64_t buf_cycles = cycles - start;
+        spi_deinit_burst(SENSOR);
+
+        int same = memcmp(got, ref, len) == 0;
+        CHECK(same, "%u byte chunks: burst reader does not match spi_read_burst", chunks[c]);
+        CHECK(rises == len * 8, "%u byte chunks: %u clocks for %u bytes", chunks[c], rises, len);
+        CHECK(bad_samples == 0, "%u byte chunks: %u samples with the clock low", chunks[c], bad_samples);
+        CHECK(timer_restarts == 0, "%u byte chunks: TIM2 restarted %u times", chunks[c], timer_restarts);
+        printf("%4u byte chunks: %u bytes %s, %.1f cycles/byte vs %.1f for spi_read_burst (%u TIM2 restarts)\n",
+               chunks[c], len, same ? "match" : "differ", (double)buf_cycles / len, (double)ref_cycles / len,
+               ref_restarts);
+    }
+
+    free(data);
+    free(ref);
+    free(got);
+}
+
+void usage(const char *pgm) {
+    const char *name = (pgm) ? pgm : "usage";
+
+    fprintf(stderr, "%s [-n bytes] [-s seed]\n", name);
+    exit(1);
+}
+
+int main(int argc, char **argv) {
+    uint32_t len = 4096;
+    uint32_t chunks[] = {1, 3, 32, 256, 4096};
+    int i = 1;
+
+    while (i < argc) {
+        if (argv[i][0] != '-' || argv[i][2] != 0 || i + 1 >= argc) {
+            usage(argv[0]);
+        }
+        long val = atol(argv[i + 1]);
+        switch (argv[i][1]) {
+        case 'n':
+            len = (uint32_t)val;
+            break;
+        case 's':
+            srand((unsigned)val);
+            break;
+        default:
+            usage(argv[0]);
+        }
+        i += 2;
+    }
+    if (len == 0) {
+        usage(argv[0]);
+    }
+
+    test_defaults();
+    test_calibration(200000000);
+    test_calibration(80000000);
+    test_calibration(32000000); // the board's SYSCLK, left calibrated for the tests below
+    test_profiles();
+    test_registers();
+    test_bit_order(len, chunks, sizeof(chunks) / sizeof(chunks[0]));
+
+    printf("%s\n", failures ? "FAIL" : "PASS");
+    return failures ? 1 : 0;
+}